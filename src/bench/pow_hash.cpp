@@ -0,0 +1,147 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/Lyra2Z/Lyra2.h"
+#include "crypto/Lyra2Z/Lyra2Z.h"
+#include "crypto/scrypt.h"
+
+#include <vector>
+
+/* Number of nonces hashed per iteration */
+static const int NONCES = 100;
+/* Rows of the LYRA2VAR matrix: the first height it was used at */
+static const uint64_t LYRA2VAR_ROWS = 500;
+/* 1024 scrypt rounds, the smallest scratchpad (SCRYPT_SCRATCHPAD_SIZE) */
+static const unsigned char SCRYPT_NFACTOR = 9;
+
+static void SetNonce(std::vector<char>& header, uint32_t nNonce)
+{
+    scrypt_le32enc(&header[76], nNonce);
+}
+
+// The *_Alloc benchmarks allocate the scratch memory for every hash (the old behaviour);
+// the *_Ctx ones reuse one context, as the miner and GetPoWHash now do.
+
+static void Lyra2Z_Alloc(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < NONCES; i++) {
+            SetNonce(header, nNonce++);
+            lyra2z_hash(&header[0], hash);
+        }
+    }
+}
+
+static void Lyra2Z_Ctx(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < NONCES; i++) {
+            SetNonce(header, nNonce++);
+            lyra2z_hash_ctx(&ctx, &header[0], hash);
+        }
+    }
+    LYRA2_ctx_free(&ctx);
+}
+
+// Lyra2Z_Ctx runs the sponge implementation picked for this CPU; this is the plain C one
+static void Lyra2Z_Ctx_Generic(benchmark::State& state)
+{
+    spongeSelectImpl(SPONGE_IMPL_GENERIC);
+    Lyra2Z_Ctx(state);
+    spongeAutoDetect();
+}
+
+// NONCES hashes LYRA2_MAX_LANES at a time with interleaved sponges, as the miner does
+static void Lyra2Z_Batch(benchmark::State& state)
+{
+    std::vector<std::vector<char> > headers(LYRA2_MAX_LANES, std::vector<char>(80, 0));
+    char hashes[LYRA2_MAX_LANES][32];
+    const char *input[LYRA2_MAX_LANES];
+    char *output[LYRA2_MAX_LANES];
+    for (size_t l = 0; l < LYRA2_MAX_LANES; l++) {
+        input[l] = &headers[l][0];
+        output[l] = hashes[l];
+    }
+    uint32_t nNonce = 0;
+    LYRA2_CTX ctx[LYRA2_MAX_LANES];
+    for (size_t l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_init(&ctx[l]);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < NONCES; i += LYRA2_MAX_LANES) {
+            for (size_t l = 0; l < LYRA2_MAX_LANES; l++)
+                SetNonce(headers[l], nNonce++);
+            lyra2z_hash_batch_ctx(ctx, input, output, LYRA2_MAX_LANES);
+        }
+    }
+    for (size_t l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_free(&ctx[l]);
+}
+
+static void Lyra2Var_Alloc(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        SetNonce(header, nNonce++);
+        LYRA2(hash, 32, &header[0], 80, &header[0], 80, 2, LYRA2VAR_ROWS, 256);
+    }
+}
+
+static void Lyra2Var_Ctx(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    while (state.KeepRunning()) {
+        SetNonce(header, nNonce++);
+        LYRA2_ctx(&ctx, hash, 32, &header[0], 80, &header[0], 80, 2, LYRA2VAR_ROWS, 256);
+    }
+    LYRA2_ctx_free(&ctx);
+}
+
+static void Scrypt_Alloc(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        SetNonce(header, nNonce++);
+        scrypt_N_1_1_256(&header[0], hash, SCRYPT_NFACTOR);
+    }
+}
+
+static void Scrypt_Ctx(benchmark::State& state)
+{
+    std::vector<char> header(80, 0);
+    char hash[32];
+    uint32_t nNonce = 0;
+    SCRYPT_CTX ctx;
+    scrypt_ctx_init(&ctx);
+    while (state.KeepRunning()) {
+        SetNonce(header, nNonce++);
+        scrypt_N_1_1_256_ctx(&ctx, &header[0], hash, SCRYPT_NFACTOR);
+    }
+    scrypt_ctx_free(&ctx);
+}
+
+BENCHMARK(Lyra2Z_Alloc);
+BENCHMARK(Lyra2Z_Ctx);
+BENCHMARK(Lyra2Z_Ctx_Generic);
+BENCHMARK(Lyra2Z_Batch);
+BENCHMARK(Lyra2Var_Alloc);
+BENCHMARK(Lyra2Var_Ctx);
+BENCHMARK(Scrypt_Alloc);
+BENCHMARK(Scrypt_Ctx);
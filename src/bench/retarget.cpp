@@ -0,0 +1,70 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "pow.h"
+#include "uint256.h"
+
+#include <vector>
+
+/* Mainnet retarget parameters, see GetNextWorkRequired */
+static const uint32_t SPACING = 120;
+static const uint32_t PAST_BLOCKS_MIN = 36;
+static const uint32_t PAST_BLOCKS_MAX = 1008;
+/* Chain length: every tip past PAST_BLOCKS_MAX averages the whole window */
+static const int CHAIN_LENGTH = 3 * PAST_BLOCKS_MAX;
+
+struct RetargetChain
+{
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+
+    RetargetChain() : hashes(CHAIN_LENGTH), blocks(CHAIN_LENGTH)
+    {
+        uint32_t nTime = 1475020800;
+        arith_uint256 bnTarget = arith_uint256().SetCompact(0x1d0e7ac9);
+        for (int i = 0; i < CHAIN_LENGTH; i++) {
+            hashes[i] = ArithToUint256(arith_uint256(i + 1));
+            CBlockIndex &block = blocks[i];
+            block.phashBlock = &hashes[i];
+            block.pprev = i > 0 ? &blocks[i - 1] : NULL;
+            block.nHeight = i;
+            // Block times around the target spacing, so no tip leaves the window early
+            nTime += SPACING - 30 + (i * 37) % 61;
+            block.nTime = nTime;
+            // Small target drift, as with the per-block retarget
+            if (i % 2)
+                bnTarget += bnTarget >> 7;
+            else
+                bnTarget -= bnTarget >> 7;
+            block.nBits = bnTarget.GetCompact();
+        }
+    }
+};
+
+// Each iteration retargets a new tip, as for headers arriving during sync
+static void Retarget(benchmark::State& state)
+{
+    RetargetChain chain;
+    int nTip = PAST_BLOCKS_MAX;
+    while (state.KeepRunning()) {
+        BorisRidiculouslyNamedDifficultyFunction(&chain.blocks[nTip], SPACING, PAST_BLOCKS_MIN, PAST_BLOCKS_MAX);
+        if (++nTip == CHAIN_LENGTH)
+            nTip = PAST_BLOCKS_MAX;
+    }
+}
+
+// The same tip again, as for header check, block check and block templates
+static void Retarget_SameTip(benchmark::State& state)
+{
+    RetargetChain chain;
+    while (state.KeepRunning()) {
+        BorisRidiculouslyNamedDifficultyFunction(&chain.blocks[CHAIN_LENGTH - 1], SPACING, PAST_BLOCKS_MIN, PAST_BLOCKS_MAX);
+    }
+}
+
+BENCHMARK(Retarget);
+BENCHMARK(Retarget_SameTip);
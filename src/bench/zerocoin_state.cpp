@@ -0,0 +1,107 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "main.h"
+#include "txdb.h"
+#include "uint256.h"
+#include "zerocoin.h"
+#include "zerocoin_params.h"
+
+#include <vector>
+
+/* About the size of the mainnet index: a few mints every tenth block, spends after the serial check fix */
+static const int CHAIN_LENGTH = 100000;
+static const int MINT_INTERVAL = 10;
+static const int MINTS_PER_BLOCK = 3;
+static const int SPEND_INTERVAL = 20;
+
+// Modulus sized value, distinct for every n
+static CBigNum BenchCoinValue(int n)
+{
+    CBigNum value(ArithToUint256(arith_uint256(n + 1) * arith_uint256(0x9e3779b97f4a7c15ULL)));
+    return (value << 768) + CBigNum(n);
+}
+
+struct ZerocoinChain
+{
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    CChain chain;
+    CBlockTreeDB *pblocktreeSaved;
+
+    ZerocoinChain() : hashes(CHAIN_LENGTH), blocks(CHAIN_LENGTH)
+    {
+        pblocktreeSaved = pblocktree;
+        pblocktree = new CBlockTreeDB(1 << 24, true, true);
+
+        CZerocoinState *zcState = CZerocoinState::GetZerocoinState();
+        int nCoin = 0;
+        for (int i = 0; i < CHAIN_LENGTH; i++) {
+            hashes[i] = ArithToUint256(arith_uint256(i + 1));
+            CBlockIndex &block = blocks[i];
+            block.phashBlock = &hashes[i];
+            block.pprev = i > 0 ? &blocks[i - 1] : NULL;
+            block.nHeight = i;
+
+            CZerocoinBlockData data;
+            if (i % MINT_INTERVAL == 0) {
+                CZerocoinGroupChange &group = data.groups[std::make_pair(1 + i % 4, 1 + i / 1000)];
+                for (int j = 0; j < MINTS_PER_BLOCK; j++)
+                    group.pubCoins.push_back(BenchCoinValue(nCoin++));
+                group.nMints = MINTS_PER_BLOCK;
+                group.accumulatorValue = BenchCoinValue(2 * CHAIN_LENGTH + i);
+            }
+            if (i > ZC_CHECK_BUG_FIXED_AT_BLOCK && i % SPEND_INTERVAL == 0)
+                data.spentSerials.insert(BenchCoinValue(CHAIN_LENGTH + i));
+            if (!data.IsNull())
+                zcState->SetBlockData(&block, data);
+        }
+        chain.SetTip(&blocks[CHAIN_LENGTH - 1]);
+
+        // Write the data as FlushStateToDisk does so that the rebuild reads it from the database
+        std::vector<std::pair<const CBlockIndex*, CZerocoinBlockDataCache::DataPtr> > vDirty;
+        zcState->TakeDirtyBlockData(vDirty);
+        std::vector<std::pair<const CBlockIndex*, const CZerocoinBlockData*> > vData;
+        for (size_t i = 0; i < vDirty.size(); i++)
+            vData.push_back(std::make_pair(vDirty[i].first, vDirty[i].second.get()));
+        pblocktree->WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0,
+                                   std::vector<const CBlockIndex*>(), vData);
+        zcState->Reset();
+    }
+
+    ~ZerocoinChain()
+    {
+        CZerocoinState::GetZerocoinState()->Reset();
+        delete pblocktree;
+        pblocktree = pblocktreeSaved;
+    }
+};
+
+// Rebuild of the zerocoin state at startup
+static void Zerocoin_BuildStateFromIndex(benchmark::State& state)
+{
+    ZerocoinChain chain;
+    while (state.KeepRunning()) {
+        ZerocoinBuildStateFromIndex(&chain.chain);
+    }
+}
+
+// Ordering of the mints of a block with many of them
+static void Zerocoin_SortMints(benchmark::State& state)
+{
+    std::vector<std::pair<int, CBigNum> > mints;
+    for (int i = 0; i < 500; i++)
+        mints.push_back(std::make_pair(1, BenchCoinValue(i)));
+    while (state.KeepRunning()) {
+        CZerocoinTxInfo info;
+        info.mints = mints;
+        info.Complete();
+    }
+}
+
+BENCHMARK(Zerocoin_BuildStateFromIndex);
+BENCHMARK(Zerocoin_SortMints);
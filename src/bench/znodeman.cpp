@@ -0,0 +1,125 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "main.h"
+#include "pubkey.h"
+#include "script/standard.h"
+#include "uint256.h"
+#include "znode.h"
+#include "znodeman.h"
+
+#include <vector>
+
+/* A large Enode list, and enough blocks that every height of NewBlock misses the rank cache */
+static const int ENODE_COUNT = 5000;
+static const int CHAIN_LENGTH = 200;
+
+// Compressed key shaped, distinct for every n
+static CPubKey BenchPubKey(int n)
+{
+    uint256 x = ArithToUint256(arith_uint256(n + 1) * arith_uint256(0x9e3779b97f4a7c15ULL));
+    std::vector<unsigned char> vch(1, 0x02);
+    vch.insert(vch.end(), x.begin(), x.end());
+    return CPubKey(vch);
+}
+
+struct EnodeList
+{
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    std::vector<CTxIn> vins;
+    std::vector<CPubKey> pubKeys;
+    std::vector<CScript> payees;
+
+    EnodeList() : hashes(CHAIN_LENGTH), blocks(CHAIN_LENGTH)
+    {
+        for (int i = 0; i < CHAIN_LENGTH; i++) {
+            hashes[i] = ArithToUint256(arith_uint256(i + 1) * arith_uint256(0x9e3779b97f4a7c15ULL));
+            blocks[i].phashBlock = &hashes[i];
+            blocks[i].pprev = i > 0 ? &blocks[i - 1] : NULL;
+            blocks[i].nHeight = i;
+        }
+        {
+            LOCK(cs_main);
+            chainActive.SetTip(&blocks[CHAIN_LENGTH - 1]);
+        }
+
+        mnodeman.Clear();
+        for (int i = 0; i < ENODE_COUNT; i++) {
+            CTxIn vin(ArithToUint256(arith_uint256(i + 1) * arith_uint256(0x2545f4914f6cdd1dULL)), i % 4);
+            CPubKey pubKeyCollateral = BenchPubKey(2 * i);
+            CPubKey pubKeyEnode = BenchPubKey(2 * i + 1);
+            CEnode mn(CService(), vin, pubKeyCollateral, pubKeyEnode, PROTOCOL_VERSION);
+            // Old enough to be paid, last paid at spread out heights
+            mn.sigTime -= 30 * 24 * 60 * 60;
+            mn.nCacheCollateralBlock = -2 * ENODE_COUNT;
+            mn.nBlockLastPaid = i % (ENODE_COUNT / 3);
+            mnodeman.Add(mn);
+            vins.push_back(vin);
+            pubKeys.push_back(pubKeyEnode);
+            payees.push_back(GetScriptForDestination(pubKeyCollateral.GetID()));
+        }
+        mnodeman.UpdatedBlockTip(&blocks[CHAIN_LENGTH - 1]);
+    }
+
+    ~EnodeList()
+    {
+        mnodeman.Clear();
+        LOCK(cs_main);
+        chainActive.SetTip(NULL);
+    }
+};
+
+// Payment vote checks: many votes ranked against the same few blocks
+static void Enode_Rank(benchmark::State& state)
+{
+    EnodeList list;
+    int i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetEnodeRank(list.vins[i % ENODE_COUNT], CHAIN_LENGTH - 1 - i % 4, 0, false);
+        i += 7;
+    }
+}
+
+// First rank at a block: all the Enodes are scored and sorted
+static void Enode_Rank_NewBlock(benchmark::State& state)
+{
+    EnodeList list;
+    int i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetEnodeRank(list.vins[i % ENODE_COUNT], i % CHAIN_LENGTH, 0, false);
+        i++;
+    }
+}
+
+// Lookups done for every ping, broadcast and vote
+static void Enode_Find(benchmark::State& state)
+{
+    EnodeList list;
+    int i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.Has(list.vins[i % ENODE_COUNT]);
+        mnodeman.GetEnodeInfo(list.pubKeys[i % ENODE_COUNT]);
+        mnodeman.Find(list.payees[i % ENODE_COUNT]);
+        i += 7;
+    }
+}
+
+// Payee of every block template and of every payment vote we cast
+static void Enode_NextInQueue(benchmark::State& state)
+{
+    EnodeList list;
+    int nCount;
+    while (state.KeepRunning()) {
+        mnodeman.GetNextEnodeInQueueForPayment(CHAIN_LENGTH - 1, true, nCount);
+    }
+}
+
+BENCHMARK(Enode_Find);
+BENCHMARK(Enode_NextInQueue);
+BENCHMARK(Enode_Rank);
+BENCHMARK(Enode_Rank_NewBlock);
@@ -9,6 +9,7 @@
 #include "arith_uint256.h"
 #include "primitives/block.h"
 #include "pow.h"
+#include "streams.h"
 #include "tinyformat.h"
 #include "uint256.h"
 #include "libzerocoin/bitcoin_bignum/bignum.h"
@@ -148,6 +149,52 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   96,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    BLOCK_HAVE_ZEROCOIN      =  256, //!< zerocoin mints or spends of the block are in the block tree database
+
+    BLOCK_HAVE_POWHASH       =  512, //!< verified proof-of-work hash is stored with the block index entry
+};
+
+/** Changes made by the mints of a block to one coin group (denomination and id) */
+class CZerocoinGroupChange
+{
+public:
+    //! Public coin values minted, ordered by serialized value of public coin
+    std::vector<CBigNum> pubCoins;
+
+    //! Accumulator value after the mints of the block
+    CBigNum accumulatorValue;
+
+    //! Number of such mints in the block
+    int nMints;
+
+    CZerocoinGroupChange() : nMints(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(pubCoins);
+        READWRITE(accumulatorValue);
+        READWRITE(nMints);
+    }
+};
+
+/**
+ * Zerocoin mints and spends of a block. They are only needed for a few blocks at a
+ * time, so they are kept in the block tree database rather than in CBlockIndex, which
+ * has BLOCK_HAVE_ZEROCOIN set instead.
+ */
+class CZerocoinBlockData
+{
+public:
+    //! Maps <denomination,id> to the changes made to that coin group
+    std::map<std::pair<int,int>, CZerocoinGroupChange> groups;
+
+    //! Values of coin serials spent in this block
+    std::set<CBigNum> spentSerials;
+
+    bool IsNull() const { return groups.empty() && spentSerials.empty(); }
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -201,20 +248,12 @@ public:
     unsigned int nBits;
     unsigned int nNonce;
 
+    //! Proof-of-work hash of the block header, null until it has been verified
+    uint256 powHash;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
 
-    //! Public coin values of mints in this block, ordered by serialized value of public coin
-    //! Maps <denomination,id> to vector of public coins
-    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
-
-    //! Accumulator updates. Contains only changes made by mints in this block
-    //! Maps <denomination, id> to <accumulator value (CBigNum), number of such mints in this block>
-    map<pair<int,int>, pair<CBigNum,int>> accumulatorChanges;
-	
-    //! Values of coin serials spent in this block
-	set<CBigNum> spentSerials;
-
     void SetNull()
     {
         phashBlock = NULL;
@@ -235,10 +274,7 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
-
-        mintedPubCoins.clear();
-        accumulatorChanges.clear();
-        spentSerials.clear();
+        powHash        = uint256();
     }
 
     CBlockIndex()
@@ -293,8 +329,12 @@ public:
         return *phashBlock;
     }
 
-    uint256 GetBlockPoWHash() const
+    //! Returns the verified PoW hash if known, otherwise computes it from the header.
+    //! Pass fRecompute to always recompute it (e.g. to check the stored value).
+    uint256 GetBlockPoWHash(bool fRecompute = false) const
     {
+        if (!fRecompute && !powHash.IsNull())
+            return powHash;
         return GetBlockHeader().GetPoWHash(nHeight);
     }
 
@@ -369,6 +409,12 @@ public:
     uint256 hashPrev;
     int nDiskBlockVersion;
 
+    //! Zerocoin data of entries written before it moved to CZerocoinBlockData, always written empty.
+    //! Maps <denomination,id> to vector of public coins and to <accumulator value, number of mints>
+    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
+    map<pair<int,int>, pair<CBigNum,int>> accumulatorChanges;
+    set<CBigNum> spentSerials;
+
     CDiskBlockIndex() {
         hashPrev = uint256();
         // value doesn't really matter but we won't leave it uninitialized
@@ -411,9 +457,21 @@ public:
             READWRITE(spentSerials);
 	    }
 
+        if (!(nType & SER_GETHASH) && (nStatus & BLOCK_HAVE_POWHASH)) {
+            // Older clients rewriting the entry keep the flag but drop the hash
+            if (ser_action.ForRead() && AtEnd(s))
+                nStatus &= ~BLOCK_HAVE_POWHASH;
+            else
+                READWRITE(powHash);
+        }
+
         nDiskBlockVersion = nVersion;
     }
 
+    static bool AtEnd(const CDataStream& s) { return s.empty(); }
+    template <typename Stream>
+    static bool AtEnd(const Stream&) { return false; }
+
     uint256 GetBlockHash() const
     {
         CBlockHeader block;
@@ -25,63 +25,75 @@
 #include "Sponge.h"
 
 /**
- * Executes Lyra2 based on the G function from Blake2b. This version supports salts and passwords
- * whose combined length is smaller than the size of the memory matrix, (i.e., (nRows x nCols x b) bits,
- * where "b" is the underlying sponge's bitrate). In this implementation, the "basil" is composed by all
- * integer parameters (treated as type "unsigned int") in the order they are provided, plus the value
- * of nCols, (i.e., basil = kLen || pwdlen || saltlen || timeCost || nRows || nCols).
- *
- * @param K The derived key to be output by the algorithm
- * @param kLen Desired key length
- * @param pwd User password
- * @param pwdlen Password length
- * @param salt Salt
- * @param saltlen Salt length
- * @param timeCost Parameter to determine the processing time (T)
- * @param nRows Number or rows of the memory matrix (R)
- * @param nCols Number of columns of the memory matrix (C)
- *
- * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+ * Initializes an empty context. No memory is allocated until the first LYRA2_ctx() call.
  */
-int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
-
-    //============================= Basic variables ============================//
-    int64_t row = 2; //index of row to be processed
-    int64_t prev = 1; //index of prev (last row ever computed/modified)
-    int64_t rowa = 0; //index of row* (a previous row, deterministically picked during Setup and randomly picked while Wandering)
-    int64_t tau; //Time Loop iterator
-    int64_t step = 1; //Visitation step (used during Setup and Wandering phases)
-    int64_t window = 2; //Visitation window (used to define which rows can be revisited during Setup)
-    int64_t gap = 1; //Modifier to the step, assuming the values 1 or -1
-    int64_t i; //auxiliary iteration counter
-    //==========================================================================/
-
-    //========== Initializing the Memory Matrix and pointers to it =============//
-    //Tries to allocate enough space for the whole memory matrix
+void LYRA2_ctx_init(LYRA2_CTX *ctx) {
+    memset(ctx, 0, sizeof (LYRA2_CTX));
+}
 
+/**
+ * Releases the memory held by a context and leaves it empty (reusable).
+ */
+void LYRA2_ctx_free(LYRA2_CTX *ctx) {
+    free(ctx->pAlloc);
+    free(ctx->memMatrix);
+    LYRA2_ctx_init(ctx);
+}
 
+/**
+ * Makes sure ctx holds a nRows x nCols memory matrix, growing the allocations if needed,
+ * and lays out the row pointers for these parameters.
+ *
+ * @return 0 on success; -1 if there is not enough memory (ctx is left empty)
+ */
+static int LYRA2_ctx_reserve(LYRA2_CTX *ctx, uint64_t nRows, uint64_t nCols) {
     const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
-    const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
+    const uint64_t nMatrixBytes = (uint64_t) nRows * (uint64_t) ROW_LEN_INT64 * 8;
+    int64_t i;
 
-    i = (int64_t) ((int64_t) nRows * (int64_t) ROW_LEN_BYTES);
-    uint64_t *wholeMatrix = malloc(i);
-    if (wholeMatrix == NULL) {
-      return -1;
+    if (ctx->nRows == nRows && ctx->nCols == nCols && ctx->memMatrix != NULL) {
+      return 0;
     }
-    memset(wholeMatrix, 0, i);
 
-    //Allocates pointers to each row of the matrix
-    uint64_t **memMatrix = malloc(nRows * sizeof (uint64_t*));
-    if (memMatrix == NULL) {
-      return -1;
+    if (nMatrixBytes > ctx->nMatrixBytes) {
+      free(ctx->pAlloc);
+      //63 extra bytes to align the matrix on a cache line
+      ctx->pAlloc = malloc(nMatrixBytes + 63);
+      if (ctx->pAlloc == NULL) {
+        LYRA2_ctx_free(ctx);
+        return -1;
+      }
+      ctx->wholeMatrix = (uint64_t *) (((uintptr_t) ctx->pAlloc + 63) & ~(uintptr_t) 63);
+      ctx->nMatrixBytes = nMatrixBytes;
     }
+
+    if (nRows > ctx->nMaxRows) {
+      free(ctx->memMatrix);
+      ctx->memMatrix = malloc(nRows * sizeof (uint64_t*));
+      if (ctx->memMatrix == NULL) {
+        LYRA2_ctx_free(ctx);
+        return -1;
+      }
+      ctx->nMaxRows = nRows;
+    }
+
     //Places the pointers in the correct positions
-    uint64_t *ptrWord = wholeMatrix;
+    uint64_t *ptrWord = ctx->wholeMatrix;
     for (i = 0; i < nRows; i++) {
-      memMatrix[i] = ptrWord;
+      ctx->memMatrix[i] = ptrWord;
       ptrWord += ROW_LEN_INT64;
     }
-    //==========================================================================/
+    ctx->nRows = nRows;
+    ctx->nCols = nCols;
+    return 0;
+}
+
+/**
+ * Writes pad(pwd || salt || basil) to the start of the memory matrix, initializes the sponge state
+ * and absorbs it: the first part of the Setup phase.
+ */
+static void LYRA2_absorbInput(uint64_t *state, uint64_t *wholeMatrix, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+    uint64_t i;
 
     //============= Getting the password + salt + basil padded with 10*1 ===============//
     //OBS.:The memory matrix will temporarily hold the password: not for saving memory,
@@ -122,21 +134,66 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     //==========================================================================/
 
     //======================= Initializing the Sponge State ====================//
-    //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-    uint64_t *state = malloc(16 * sizeof (uint64_t));
-    if (state == NULL) {
-      return -1;
-    }
     initState(state);
     //==========================================================================/
 
     //================================ Setup Phase =============================//
     //Absorbing salt, password and basil: this is the only place in which the block length is hard-coded to 512 bits
-    ptrWord = wholeMatrix;
+    uint64_t *ptrWord = wholeMatrix;
     for (i = 0; i < nBlocksInput; i++) {
       absorbBlockBlake2Safe(state, ptrWord); //absorbs each block of pad(pwd || salt || basil)
       ptrWord += BLOCK_LEN_BLAKE2_SAFE_INT64; //goes to next block of pad(pwd || salt || basil)
     }
+}
+
+/**
+ * Executes Lyra2 based on the G function from Blake2b. This version supports salts and passwords
+ * whose combined length is smaller than the size of the memory matrix, (i.e., (nRows x nCols x b) bits,
+ * where "b" is the underlying sponge's bitrate). In this implementation, the "basil" is composed by all
+ * integer parameters (treated as type "unsigned int") in the order they are provided, plus the value
+ * of nCols, (i.e., basil = kLen || pwdlen || saltlen || timeCost || nRows || nCols).
+ *
+ * The memory matrix is taken from ctx, which keeps it for the next call. The matrix is not
+ * cleared between calls: every row is fully written during the Setup phase before it is read.
+ *
+ * @param ctx Scratch memory, see LYRA2_CTX
+ * @param K The derived key to be output by the algorithm
+ * @param kLen Desired key length
+ * @param pwd User password
+ * @param pwdlen Password length
+ * @param salt Salt
+ * @param saltlen Salt length
+ * @param timeCost Parameter to determine the processing time (T)
+ * @param nRows Number or rows of the memory matrix (R)
+ * @param nCols Number of columns of the memory matrix (C)
+ *
+ * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+ */
+int LYRA2_ctx(LYRA2_CTX *ctx, void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+
+    //============================= Basic variables ============================//
+    int64_t row = 2; //index of row to be processed
+    int64_t prev = 1; //index of prev (last row ever computed/modified)
+    int64_t rowa = 0; //index of row* (a previous row, deterministically picked during Setup and randomly picked while Wandering)
+    int64_t tau; //Time Loop iterator
+    int64_t step = 1; //Visitation step (used during Setup and Wandering phases)
+    int64_t window = 2; //Visitation window (used to define which rows can be revisited during Setup)
+    int64_t gap = 1; //Modifier to the step, assuming the values 1 or -1
+    //==========================================================================/
+
+    //========== Initializing the Memory Matrix and pointers to it =============//
+    if (LYRA2_ctx_reserve(ctx, nRows, nCols) != 0) {
+      return -1;
+    }
+    uint64_t *wholeMatrix = ctx->wholeMatrix;
+    uint64_t **memMatrix = ctx->memMatrix;
+    //==========================================================================/
+
+    //============= Absorbing the password + salt + basil padded with 10*1 =============//
+    //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
+    uint64_t state[16] ALIGN;
+    LYRA2_absorbInput(state, wholeMatrix, kLen, pwd, pwdlen, salt, saltlen, timeCost, nRows, nCols);
+    //==========================================================================/
 
     //Initializes M[0] and M[1]
     reducedSqueezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
@@ -200,18 +257,126 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     squeeze(state, K, kLen);
     //==========================================================================/
 
-    //========================= Freeing the memory =============================//
-    free(memMatrix);
-    free(wholeMatrix);
-
-    //Wiping out the sponge's internal state before freeing it
+    //========================= Wiping the state ===============================//
+    //Wiping out the sponge's internal state; the matrix stays in ctx for the next call
     memset(state, 0, 16 * sizeof (uint64_t));
-    free(state);
     //==========================================================================/
 
     return 0;
 }
 
+/**
+ * Executes Lyra2 on n independent inputs sharing the same parameters, each with its own context.
+ * The row visitation order of the Setup phase and the row/prev sequence of the Wandering phase
+ * only depend on the parameters, so the n sponges are advanced in lockstep and the duplexing
+ * is interleaved across them where the sponge implementation has lanes (see SpongeImpl).
+ * Produces exactly the same keys as n calls to LYRA2_ctx().
+ *
+ * @param ctx Array of n contexts
+ * @param n Number of inputs, at most LYRA2_MAX_LANES
+ * @param K Array of n derived keys
+ * @param pwd Array of n passwords
+ * @param salt Array of n salts
+ * See LYRA2_ctx() for the other parameters.
+ *
+ * @return 0 if the keys are generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+ */
+int LYRA2_ctx_batch(LYRA2_CTX ctx[], size_t n, void *K[], uint64_t kLen, const void *pwd[], uint64_t pwdlen, const void *salt[], uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+    int64_t row = 2;
+    int64_t prev = 1;
+    int64_t rowa = 0; //Setup phase row*, shared by all lanes
+    int64_t tau;
+    int64_t step = 1;
+    int64_t window = 2;
+    int64_t gap = 1;
+    size_t l;
+
+    uint64_t stateLanes[LYRA2_MAX_LANES][16] ALIGN;
+    uint64_t *state[LYRA2_MAX_LANES];
+    uint64_t *rowIn[LYRA2_MAX_LANES], *rowInOut[LYRA2_MAX_LANES], *rowOut[LYRA2_MAX_LANES];
+    uint64_t rowaLanes[LYRA2_MAX_LANES]; //Wandering phase row*, picked by each lane's state
+
+    if (n > LYRA2_MAX_LANES) {
+      return -1;
+    }
+
+    for (l = 0; l < n; l++) {
+      if (LYRA2_ctx_reserve(&ctx[l], nRows, nCols) != 0) {
+        return -1;
+      }
+      state[l] = stateLanes[l];
+      LYRA2_absorbInput(state[l], ctx[l].wholeMatrix, kLen, pwd[l], pwdlen, salt[l], saltlen, timeCost, nRows, nCols);
+
+      //Initializes M[0] and M[1]
+      reducedSqueezeRow0(state[l], ctx[l].memMatrix[0], nCols);
+      reducedDuplexRow1(state[l], ctx[l].memMatrix[0], ctx[l].memMatrix[1], nCols);
+    }
+
+    //================================ Setup Phase =============================//
+    do {
+      for (l = 0; l < n; l++) {
+        rowIn[l] = ctx[l].memMatrix[prev];
+        rowInOut[l] = ctx[l].memMatrix[rowa];
+        rowOut[l] = ctx[l].memMatrix[row];
+      }
+      reducedDuplexRowSetupBatch(n, state, rowIn, rowInOut, rowOut, nCols);
+
+      rowa = (rowa + step) & (window - 1);
+      prev = row;
+      row++;
+
+      if (rowa == 0) {
+        step = window + gap;
+        window *= 2;
+        gap = -gap;
+      }
+    } while (row < nRows);
+    //==========================================================================/
+
+    //============================ Wandering Phase =============================//
+    row = 0;
+    for (tau = 1; tau <= timeCost; tau++) {
+      step = (tau % 2 == 0) ? -1 : nRows / 2 - 1;
+      do {
+        for (l = 0; l < n; l++) {
+          rowaLanes[l] = ((uint64_t) (state[l][0])) % nRows;
+          rowIn[l] = ctx[l].memMatrix[prev];
+          rowInOut[l] = ctx[l].memMatrix[rowaLanes[l]];
+          rowOut[l] = ctx[l].memMatrix[row];
+        }
+        reducedDuplexRowBatch(n, state, rowIn, rowInOut, rowOut, nCols);
+
+        prev = row;
+        row = (row + step) % nRows;
+      } while (row != 0);
+    }
+    //==========================================================================/
+
+    //============================ Wrap-up Phase ===============================//
+    for (l = 0; l < n; l++) {
+      absorbBlock(state[l], ctx[l].memMatrix[timeCost > 0 ? rowaLanes[l] : rowa]);
+      squeeze(state[l], K[l], kLen);
+    }
+    memset(stateLanes, 0, sizeof (stateLanes));
+    //==========================================================================/
+
+    return 0;
+}
+
+/**
+ * Executes Lyra2 with a memory matrix allocated for this call only.
+ * See LYRA2_ctx() for the parameters.
+ *
+ * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+ */
+int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    int result = LYRA2_ctx(&ctx, K, kLen, pwd, pwdlen, salt, saltlen, timeCost, nRows, nCols);
+    LYRA2_ctx_free(&ctx);
+    return result;
+}
+
 int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
 
     //============================= Basic variables ============================//
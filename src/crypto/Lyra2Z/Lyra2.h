@@ -20,6 +20,7 @@
 #ifndef LYRA2_H_
 #define LYRA2_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef unsigned char byte;
@@ -37,10 +38,48 @@ typedef unsigned char byte;
         #define BLOCK_LEN_BYTES (BLOCK_LEN_INT64 * 8)    //Block length, in bytes
 #endif
 
+/**
+ * Caller-owned scratch memory for LYRA2_ctx(). The memory matrix (64-byte aligned) and
+ * its row pointers are kept between calls and only reallocated when a larger matrix
+ * is requested, so hashing repeatedly with the same parameters does not allocate.
+ * A context must not be used by two threads at the same time.
+ */
+typedef struct {
+    void *pAlloc;           //Start of the allocation holding the matrix (unaligned)
+    uint64_t *wholeMatrix;  //64-byte aligned start of the memory matrix
+    uint64_t **memMatrix;   //Pointers to each row of the memory matrix
+    uint64_t nMatrixBytes;  //Capacity of wholeMatrix, in bytes
+    uint64_t nMaxRows;      //Capacity of memMatrix, in rows
+    uint64_t nRows;         //Row layout memMatrix currently holds
+    uint64_t nCols;
+} LYRA2_CTX;
+
+//Maximum number of inputs hashed together by LYRA2_ctx_batch()
+#define LYRA2_MAX_LANES 4
+
+//Sponge implementations, see spongeSelectImpl()
+enum {
+    SPONGE_IMPL_GENERIC = 0,
+    SPONGE_IMPL_SSE41,
+    SPONGE_IMPL_AVX2,
+    SPONGE_IMPL_AVX512,
+    SPONGE_IMPL_COUNT
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    //Selection of the sponge implementation (not thread-safe: select before hashing starts)
+    const char *spongeImplName(int impl);
+    int spongeImplSupported(int impl);
+    int spongeSelectImpl(int impl);
+    const char *spongeAutoDetect(void);
+
+    void LYRA2_ctx_init(LYRA2_CTX *ctx);
+    void LYRA2_ctx_free(LYRA2_CTX *ctx);
+    int LYRA2_ctx(LYRA2_CTX *ctx, void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
+    int LYRA2_ctx_batch(LYRA2_CTX ctx[], size_t n, void *K[], uint64_t kLen, const void *pwd[], uint64_t pwdlen, const void *salt[], uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
     int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
 #ifdef __cplusplus
@@ -36,6 +36,15 @@
 #include "Lyra2.h"
 
 void lyra2z_hash(const char* input, char* output)
+{
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    lyra2z_hash_ctx(&ctx, input, output);
+    LYRA2_ctx_free(&ctx);
+}
+
+/* Returns 0 on success, -1 if the matrix couldn't be allocated */
+int lyra2z_hash_ctx(LYRA2_CTX *ctx, const char* input, char* output)
 {
     sph_blake256_context     ctx_blake;
 
@@ -45,8 +54,55 @@ void lyra2z_hash(const char* input, char* output)
     sph_blake256 (&ctx_blake, input, 80);
     sph_blake256_close (&ctx_blake, hashA);	
 	
-	LYRA2(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8);
+	if (LYRA2_ctx(ctx, hashB, 32, hashA, 32, hashA, 32, 8, 8, 8) != 0)
+		return -1;
 	
 	memcpy(output, hashB, 32);
+	return 0;
+}
+
+
+int lyra2z_hash_batch(const char* const input[], char* output[], size_t n)
+{
+    LYRA2_CTX ctx[LYRA2_MAX_LANES];
+    size_t l;
+    int result;
+
+    for (l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_init(&ctx[l]);
+    result = lyra2z_hash_batch_ctx(ctx, input, output, n);
+    for (l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_free(&ctx[l]);
+    return result;
 }
 
+/* Hashes n headers, LYRA2_MAX_LANES at a time, with the Lyra2 sponges interleaved
+ * (see LYRA2_ctx_batch). ctx must hold LYRA2_MAX_LANES contexts. Returns 0 on
+ * success, -1 if the matrices couldn't be allocated, the outputs are then unset. */
+int lyra2z_hash_batch_ctx(LYRA2_CTX ctx[], const char* const input[], char* output[], size_t n)
+{
+    sph_blake256_context     ctx_blake;
+
+    uint32_t hashA[LYRA2_MAX_LANES][8], hashB[LYRA2_MAX_LANES][8];
+    const void *pwd[LYRA2_MAX_LANES];
+    void *key[LYRA2_MAX_LANES];
+    size_t i, l, lanes;
+
+    for (i = 0; i < n; i += lanes) {
+        lanes = n - i < LYRA2_MAX_LANES ? n - i : LYRA2_MAX_LANES;
+        for (l = 0; l < lanes; l++) {
+            sph_blake256_init(&ctx_blake);
+            sph_blake256 (&ctx_blake, input[i + l], 80);
+            sph_blake256_close (&ctx_blake, hashA[l]);
+            pwd[l] = hashA[l];
+            key[l] = hashB[l];
+        }
+
+        if (LYRA2_ctx_batch(ctx, lanes, key, 32, pwd, 32, pwd, 32, 8, 8, 8) != 0)
+            return -1;
+
+        for (l = 0; l < lanes; l++)
+            memcpy(output[i + l], hashB[l], 32);
+    }
+    return 0;
+}
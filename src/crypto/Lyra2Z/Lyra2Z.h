@@ -1,11 +1,16 @@
 #ifndef LYRA2RE_H
 #define LYRA2RE_H
 
+#include "Lyra2.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void lyra2z_hash(const char* input, char* output);
+int lyra2z_hash_ctx(LYRA2_CTX *ctx, const char* input, char* output);
+int lyra2z_hash_batch(const char* const input[], char* output[], size_t n);
+int lyra2z_hash_batch_ctx(LYRA2_CTX ctx[], const char* const input[], char* output[], size_t n);
 
 #ifdef __cplusplus
 }
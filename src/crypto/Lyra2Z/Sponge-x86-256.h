@@ -0,0 +1,261 @@
+/**
+ * 256-bit (AVX2 / AVX-512VL) sponge kernels, instantiated by Sponge-x86.c.
+ *
+ * The including file defines SPONGE_TARGET (function attribute), SPONGE_FN(name) (adds a suffix)
+ * and SPONGE_ROR32/24/16/63 (64-bit lane rotations to the right).
+ *
+ * If SPONGE_LANES(M) is defined (M(0) M(1) ... for each lane), multi-lane versions of the duplexing
+ * row operations are generated too: they advance that many independent sponges together, with their
+ * rounds interleaved instruction by instruction so the latency of one lane's chain is hidden by the others.
+ *
+ * The 16-word state is held in four vectors, one per row of Blake2b's 4x4 matrix: a = v[0..3],
+ * b = v[4..7], c = v[8..11], d = v[12..15]. The sponge's bitrate (BLOCK_LEN_INT64 = 12 words) is
+ * exactly a, b and c, so each column of the memory matrix is three unaligned 256-bit loads.
+ */
+
+#define SPONGE_G256(a, b, c, d) \
+    a = _mm256_add_epi64(a, b); d = SPONGE_ROR32(_mm256_xor_si256(d, a)); \
+    c = _mm256_add_epi64(c, d); b = SPONGE_ROR24(_mm256_xor_si256(b, c)); \
+    a = _mm256_add_epi64(a, b); d = SPONGE_ROR16(_mm256_xor_si256(d, a)); \
+    c = _mm256_add_epi64(c, d); b = SPONGE_ROR63(_mm256_xor_si256(b, c));
+
+/*One Round of the Blake2b's compression function: G on the columns, then on the diagonals*/
+#define SPONGE_ROUND256(a, b, c, d) \
+    do { \
+        SPONGE_G256(a, b, c, d) \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1)); \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3)); \
+        SPONGE_G256(a, b, c, d) \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3)); \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1)); \
+    } while (0)
+
+/*rotW(rand): the 12 bitrate words rotated by one word, (s11, s0, s1, ..., s10)*/
+#define SPONGE_ROTW256(a, b, c, r0, r1, r2) \
+    do { \
+        __m256i ta = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(2, 1, 0, 3)); \
+        __m256i tb = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3)); \
+        __m256i tc = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(2, 1, 0, 3)); \
+        r0 = _mm256_blend_epi32(ta, tc, 0x03); \
+        r1 = _mm256_blend_epi32(tb, ta, 0x03); \
+        r2 = _mm256_blend_epi32(tc, tb, 0x03); \
+    } while (0)
+
+#define SPONGE_LOAD(p)      _mm256_loadu_si256((const __m256i *) (p))
+#define SPONGE_STORE(p, x)  _mm256_storeu_si256((__m256i *) (p), x)
+
+static SPONGE_TARGET void SPONGE_FN(blake2bLyra)(uint64_t *v) {
+    __m256i a = SPONGE_LOAD(v), b = SPONGE_LOAD(v + 4), c = SPONGE_LOAD(v + 8), d = SPONGE_LOAD(v + 12);
+    int i;
+    for (i = 0; i < 12; i++) {
+      SPONGE_ROUND256(a, b, c, d);
+    }
+    SPONGE_STORE(v, a); SPONGE_STORE(v + 4, b); SPONGE_STORE(v + 8, c); SPONGE_STORE(v + 12, d);
+}
+
+static SPONGE_TARGET void SPONGE_FN(reducedSqueezeRow0)(uint64_t *state, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWord = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    __m256i a = SPONGE_LOAD(state), b = SPONGE_LOAD(state + 4), c = SPONGE_LOAD(state + 8), d = SPONGE_LOAD(state + 12);
+    uint64_t i;
+    for (i = 0; i < nCols; i++) {
+      SPONGE_STORE(ptrWord, a); SPONGE_STORE(ptrWord + 4, b); SPONGE_STORE(ptrWord + 8, c);
+      ptrWord -= BLOCK_LEN_INT64;
+      SPONGE_ROUND256(a, b, c, d);
+    }
+    SPONGE_STORE(state, a); SPONGE_STORE(state + 4, b); SPONGE_STORE(state + 8, c); SPONGE_STORE(state + 12, d);
+}
+
+static SPONGE_TARGET void SPONGE_FN(reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    __m256i a = SPONGE_LOAD(state), b = SPONGE_LOAD(state + 4), c = SPONGE_LOAD(state + 8), d = SPONGE_LOAD(state + 12);
+    uint64_t i;
+    for (i = 0; i < nCols; i++) {
+      __m256i in0 = SPONGE_LOAD(ptrWordIn), in1 = SPONGE_LOAD(ptrWordIn + 4), in2 = SPONGE_LOAD(ptrWordIn + 8);
+      a = _mm256_xor_si256(a, in0); b = _mm256_xor_si256(b, in1); c = _mm256_xor_si256(c, in2);
+      SPONGE_ROUND256(a, b, c, d);
+      SPONGE_STORE(ptrWordOut, _mm256_xor_si256(in0, a));
+      SPONGE_STORE(ptrWordOut + 4, _mm256_xor_si256(in1, b));
+      SPONGE_STORE(ptrWordOut + 8, _mm256_xor_si256(in2, c));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE(state, a); SPONGE_STORE(state + 4, b); SPONGE_STORE(state + 8, c); SPONGE_STORE(state + 12, d);
+}
+
+static SPONGE_TARGET void SPONGE_FN(reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordInOut = rowInOut;
+    uint64_t *ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    __m256i a = SPONGE_LOAD(state), b = SPONGE_LOAD(state + 4), c = SPONGE_LOAD(state + 8), d = SPONGE_LOAD(state + 12);
+    uint64_t i;
+    for (i = 0; i < nCols; i++) {
+      __m256i in0 = SPONGE_LOAD(ptrWordIn), in1 = SPONGE_LOAD(ptrWordIn + 4), in2 = SPONGE_LOAD(ptrWordIn + 8);
+      __m256i io0 = SPONGE_LOAD(ptrWordInOut), io1 = SPONGE_LOAD(ptrWordInOut + 4), io2 = SPONGE_LOAD(ptrWordInOut + 8);
+      __m256i r0, r1, r2;
+      a = _mm256_xor_si256(a, _mm256_add_epi64(in0, io0));
+      b = _mm256_xor_si256(b, _mm256_add_epi64(in1, io1));
+      c = _mm256_xor_si256(c, _mm256_add_epi64(in2, io2));
+      SPONGE_ROUND256(a, b, c, d);
+      //M[row][C-1-col] = M[prev][col] XOR rand
+      SPONGE_STORE(ptrWordOut, _mm256_xor_si256(in0, a));
+      SPONGE_STORE(ptrWordOut + 4, _mm256_xor_si256(in1, b));
+      SPONGE_STORE(ptrWordOut + 8, _mm256_xor_si256(in2, c));
+      //M[row*][col] = M[row*][col] XOR rotW(rand); row* is never the row being written
+      SPONGE_ROTW256(a, b, c, r0, r1, r2);
+      SPONGE_STORE(ptrWordInOut, _mm256_xor_si256(io0, r0));
+      SPONGE_STORE(ptrWordInOut + 4, _mm256_xor_si256(io1, r1));
+      SPONGE_STORE(ptrWordInOut + 8, _mm256_xor_si256(io2, r2));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordInOut += BLOCK_LEN_INT64;
+      ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE(state, a); SPONGE_STORE(state + 4, b); SPONGE_STORE(state + 8, c); SPONGE_STORE(state + 12, d);
+}
+
+static SPONGE_TARGET void SPONGE_FN(reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordInOut = rowInOut;
+    uint64_t *ptrWordOut = rowOut;
+    __m256i a = SPONGE_LOAD(state), b = SPONGE_LOAD(state + 4), c = SPONGE_LOAD(state + 8), d = SPONGE_LOAD(state + 12);
+    uint64_t i;
+    for (i = 0; i < nCols; i++) {
+      __m256i r0, r1, r2;
+      a = _mm256_xor_si256(a, _mm256_add_epi64(SPONGE_LOAD(ptrWordIn), SPONGE_LOAD(ptrWordInOut)));
+      b = _mm256_xor_si256(b, _mm256_add_epi64(SPONGE_LOAD(ptrWordIn + 4), SPONGE_LOAD(ptrWordInOut + 4)));
+      c = _mm256_xor_si256(c, _mm256_add_epi64(SPONGE_LOAD(ptrWordIn + 8), SPONGE_LOAD(ptrWordInOut + 8)));
+      SPONGE_ROUND256(a, b, c, d);
+      //M[rowOut][col] = M[rowOut][col] XOR rand
+      SPONGE_STORE(ptrWordOut, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut), a));
+      SPONGE_STORE(ptrWordOut + 4, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut + 4), b));
+      SPONGE_STORE(ptrWordOut + 8, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut + 8), c));
+      //M[rowInOut][col] = M[rowInOut][col] XOR rotW(rand); reloaded, rowInOut may be rowOut
+      SPONGE_ROTW256(a, b, c, r0, r1, r2);
+      SPONGE_STORE(ptrWordInOut, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut), r0));
+      SPONGE_STORE(ptrWordInOut + 4, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut + 4), r1));
+      SPONGE_STORE(ptrWordInOut + 8, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut + 8), r2));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordInOut += BLOCK_LEN_INT64;
+      ptrWordOut += BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE(state, a); SPONGE_STORE(state + 4, b); SPONGE_STORE(state + 8, c); SPONGE_STORE(state + 12, d);
+}
+
+#ifdef SPONGE_LANES
+
+//One round on every lane, each G step issued for all lanes before the next
+#define SPONGE_LANE_GA(l) a##l = _mm256_add_epi64(a##l, b##l); d##l = SPONGE_ROR32(_mm256_xor_si256(d##l, a##l));
+#define SPONGE_LANE_GB(l) c##l = _mm256_add_epi64(c##l, d##l); b##l = SPONGE_ROR24(_mm256_xor_si256(b##l, c##l));
+#define SPONGE_LANE_GC(l) a##l = _mm256_add_epi64(a##l, b##l); d##l = SPONGE_ROR16(_mm256_xor_si256(d##l, a##l));
+#define SPONGE_LANE_GD(l) c##l = _mm256_add_epi64(c##l, d##l); b##l = SPONGE_ROR63(_mm256_xor_si256(b##l, c##l));
+#define SPONGE_LANE_DIAG(l) \
+    b##l = _mm256_permute4x64_epi64(b##l, _MM_SHUFFLE(0, 3, 2, 1)); \
+    c##l = _mm256_permute4x64_epi64(c##l, _MM_SHUFFLE(1, 0, 3, 2)); \
+    d##l = _mm256_permute4x64_epi64(d##l, _MM_SHUFFLE(2, 1, 0, 3));
+#define SPONGE_LANE_UNDIAG(l) \
+    b##l = _mm256_permute4x64_epi64(b##l, _MM_SHUFFLE(2, 1, 0, 3)); \
+    c##l = _mm256_permute4x64_epi64(c##l, _MM_SHUFFLE(1, 0, 3, 2)); \
+    d##l = _mm256_permute4x64_epi64(d##l, _MM_SHUFFLE(0, 3, 2, 1));
+#define SPONGE_LANES_ROUND() \
+    SPONGE_LANES(SPONGE_LANE_GA) SPONGE_LANES(SPONGE_LANE_GB) SPONGE_LANES(SPONGE_LANE_GC) SPONGE_LANES(SPONGE_LANE_GD) \
+    SPONGE_LANES(SPONGE_LANE_DIAG) \
+    SPONGE_LANES(SPONGE_LANE_GA) SPONGE_LANES(SPONGE_LANE_GB) SPONGE_LANES(SPONGE_LANE_GC) SPONGE_LANES(SPONGE_LANE_GD) \
+    SPONGE_LANES(SPONGE_LANE_UNDIAG)
+
+#define SPONGE_LANE_LOAD_STATE(l) \
+    __m256i a##l = SPONGE_LOAD(state[l]), b##l = SPONGE_LOAD(state[l] + 4), c##l = SPONGE_LOAD(state[l] + 8), d##l = SPONGE_LOAD(state[l] + 12); \
+    uint64_t *ptrWordIn##l = rowIn[l], *ptrWordInOut##l = rowInOut[l];
+#define SPONGE_LANE_SAVE_STATE(l) \
+    SPONGE_STORE(state[l], a##l); SPONGE_STORE(state[l] + 4, b##l); SPONGE_STORE(state[l] + 8, c##l); SPONGE_STORE(state[l] + 12, d##l);
+
+//Absorbing "M[prev] [+] M[row*]"
+#define SPONGE_LANE_ABSORB(l) \
+    __m256i in0##l = SPONGE_LOAD(ptrWordIn##l), in1##l = SPONGE_LOAD(ptrWordIn##l + 4), in2##l = SPONGE_LOAD(ptrWordIn##l + 8); \
+    __m256i io0##l = SPONGE_LOAD(ptrWordInOut##l), io1##l = SPONGE_LOAD(ptrWordInOut##l + 4), io2##l = SPONGE_LOAD(ptrWordInOut##l + 8); \
+    a##l = _mm256_xor_si256(a##l, _mm256_add_epi64(in0##l, io0##l)); \
+    b##l = _mm256_xor_si256(b##l, _mm256_add_epi64(in1##l, io1##l)); \
+    c##l = _mm256_xor_si256(c##l, _mm256_add_epi64(in2##l, io2##l));
+
+#define SPONGE_LANE_SETUP_OUT(l) \
+    { \
+      __m256i r0, r1, r2; \
+      SPONGE_STORE(ptrWordOut##l, _mm256_xor_si256(in0##l, a##l)); \
+      SPONGE_STORE(ptrWordOut##l + 4, _mm256_xor_si256(in1##l, b##l)); \
+      SPONGE_STORE(ptrWordOut##l + 8, _mm256_xor_si256(in2##l, c##l)); \
+      SPONGE_ROTW256(a##l, b##l, c##l, r0, r1, r2); \
+      SPONGE_STORE(ptrWordInOut##l, _mm256_xor_si256(io0##l, r0)); \
+      SPONGE_STORE(ptrWordInOut##l + 4, _mm256_xor_si256(io1##l, r1)); \
+      SPONGE_STORE(ptrWordInOut##l + 8, _mm256_xor_si256(io2##l, r2)); \
+      ptrWordIn##l += BLOCK_LEN_INT64; \
+      ptrWordInOut##l += BLOCK_LEN_INT64; \
+      ptrWordOut##l -= BLOCK_LEN_INT64; \
+    }
+
+#define SPONGE_LANE_SETUP_INIT(l) uint64_t *ptrWordOut##l = rowOut[l] + (nCols - 1) * BLOCK_LEN_INT64;
+
+static SPONGE_TARGET void SPONGE_FN(reducedDuplexRowSetupLanes)(uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols) {
+    uint64_t i;
+    SPONGE_LANES(SPONGE_LANE_LOAD_STATE)
+    SPONGE_LANES(SPONGE_LANE_SETUP_INIT)
+    for (i = 0; i < nCols; i++) {
+      SPONGE_LANES(SPONGE_LANE_ABSORB)
+      SPONGE_LANES_ROUND()
+      SPONGE_LANES(SPONGE_LANE_SETUP_OUT)
+    }
+    SPONGE_LANES(SPONGE_LANE_SAVE_STATE)
+}
+
+//The lane's rowInOut is reloaded after its rowOut is written: they may be the same row
+#define SPONGE_LANE_DUPLEX_OUT(l) \
+    { \
+      __m256i r0, r1, r2; \
+      SPONGE_STORE(ptrWordOut##l, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut##l), a##l)); \
+      SPONGE_STORE(ptrWordOut##l + 4, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut##l + 4), b##l)); \
+      SPONGE_STORE(ptrWordOut##l + 8, _mm256_xor_si256(SPONGE_LOAD(ptrWordOut##l + 8), c##l)); \
+      SPONGE_ROTW256(a##l, b##l, c##l, r0, r1, r2); \
+      SPONGE_STORE(ptrWordInOut##l, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut##l), r0)); \
+      SPONGE_STORE(ptrWordInOut##l + 4, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut##l + 4), r1)); \
+      SPONGE_STORE(ptrWordInOut##l + 8, _mm256_xor_si256(SPONGE_LOAD(ptrWordInOut##l + 8), r2)); \
+      ptrWordIn##l += BLOCK_LEN_INT64; \
+      ptrWordInOut##l += BLOCK_LEN_INT64; \
+      ptrWordOut##l += BLOCK_LEN_INT64; \
+    }
+
+#define SPONGE_LANE_DUPLEX_INIT(l) uint64_t *ptrWordOut##l = rowOut[l];
+
+static SPONGE_TARGET void SPONGE_FN(reducedDuplexRowLanes)(uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols) {
+    uint64_t i;
+    SPONGE_LANES(SPONGE_LANE_LOAD_STATE)
+    SPONGE_LANES(SPONGE_LANE_DUPLEX_INIT)
+    for (i = 0; i < nCols; i++) {
+      SPONGE_LANES(SPONGE_LANE_ABSORB)
+      SPONGE_LANES_ROUND()
+      SPONGE_LANES(SPONGE_LANE_DUPLEX_OUT)
+    }
+    SPONGE_LANES(SPONGE_LANE_SAVE_STATE)
+}
+
+#undef SPONGE_LANE_GA
+#undef SPONGE_LANE_GB
+#undef SPONGE_LANE_GC
+#undef SPONGE_LANE_GD
+#undef SPONGE_LANE_DIAG
+#undef SPONGE_LANE_UNDIAG
+#undef SPONGE_LANES_ROUND
+#undef SPONGE_LANE_LOAD_STATE
+#undef SPONGE_LANE_SAVE_STATE
+#undef SPONGE_LANE_ABSORB
+#undef SPONGE_LANE_SETUP_OUT
+#undef SPONGE_LANE_SETUP_INIT
+#undef SPONGE_LANE_DUPLEX_OUT
+#undef SPONGE_LANE_DUPLEX_INIT
+
+#endif // SPONGE_LANES
+
+#undef SPONGE_G256
+#undef SPONGE_ROUND256
+#undef SPONGE_ROTW256
+#undef SPONGE_LOAD
+#undef SPONGE_STORE
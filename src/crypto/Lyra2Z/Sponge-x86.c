@@ -0,0 +1,288 @@
+/**
+ * Vectorized (SSE4.1, AVX2 and AVX-512VL) versions of the sponge's permutation and row
+ * operations in Sponge.c, and the CPU feature detection used to pick one at runtime.
+ * They follow the reference code operation by operation and are bit-identical to it.
+ *
+ * Every kernel is compiled with a target attribute, so this file needs no special compiler
+ * flags and the rest of the binary still runs on any x86 CPU.
+ *
+ * This software is hereby placed in the public domain.
+ */
+#include "Sponge.h"
+#include "Lyra2.h"
+
+#ifdef SPONGE_USE_X86
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+//===================================== SSE4.1 ======================================//
+//The state is held in eight vectors of two words: Blake2b's matrix rows, low and high halves
+
+#define SSE_TARGET __attribute__((target("sse4.1")))
+
+#define SSE_ROR32(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define SSE_ROR24(x) _mm_shuffle_epi8(x, r24)
+#define SSE_ROR16(x) _mm_shuffle_epi8(x, r16)
+#define SSE_ROR63(x) _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x))
+
+#define SSE_G(al, bl, cl, dl, ah, bh, ch, dh) \
+    al = _mm_add_epi64(al, bl); ah = _mm_add_epi64(ah, bh); \
+    dl = SSE_ROR32(_mm_xor_si128(dl, al)); dh = SSE_ROR32(_mm_xor_si128(dh, ah)); \
+    cl = _mm_add_epi64(cl, dl); ch = _mm_add_epi64(ch, dh); \
+    bl = SSE_ROR24(_mm_xor_si128(bl, cl)); bh = SSE_ROR24(_mm_xor_si128(bh, ch)); \
+    al = _mm_add_epi64(al, bl); ah = _mm_add_epi64(ah, bh); \
+    dl = SSE_ROR16(_mm_xor_si128(dl, al)); dh = SSE_ROR16(_mm_xor_si128(dh, ah)); \
+    cl = _mm_add_epi64(cl, dl); ch = _mm_add_epi64(ch, dh); \
+    bl = SSE_ROR63(_mm_xor_si128(bl, cl)); bh = SSE_ROR63(_mm_xor_si128(bh, ch));
+
+#define SSE_ROUND(v) \
+    do { \
+        __m128i t0, t1; \
+        SSE_G(v[0], v[2], v[4], v[6], v[1], v[3], v[5], v[7]) \
+        t0 = _mm_alignr_epi8(v[3], v[2], 8); t1 = _mm_alignr_epi8(v[2], v[3], 8); v[2] = t0; v[3] = t1; \
+        t0 = v[4]; v[4] = v[5]; v[5] = t0; \
+        t0 = _mm_alignr_epi8(v[7], v[6], 8); t1 = _mm_alignr_epi8(v[6], v[7], 8); v[6] = t1; v[7] = t0; \
+        SSE_G(v[0], v[2], v[4], v[6], v[1], v[3], v[5], v[7]) \
+        t0 = _mm_alignr_epi8(v[2], v[3], 8); t1 = _mm_alignr_epi8(v[3], v[2], 8); v[2] = t0; v[3] = t1; \
+        t0 = v[4]; v[4] = v[5]; v[5] = t0; \
+        t0 = _mm_alignr_epi8(v[6], v[7], 8); t1 = _mm_alignr_epi8(v[7], v[6], 8); v[6] = t1; v[7] = t0; \
+    } while (0)
+
+#define SSE_LOAD(p)     _mm_loadu_si128((const __m128i *) (p))
+#define SSE_STORE(p, x) _mm_storeu_si128((__m128i *) (p), x)
+
+#define SSE_DECLARE_STATE(state) \
+    const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10); \
+    const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9); \
+    __m128i v[8]; \
+    int k; \
+    for (k = 0; k < 8; k++) v[k] = SSE_LOAD(state + 2 * k)
+
+#define SSE_SAVE_STATE(state) \
+    for (k = 0; k < 8; k++) SSE_STORE(state + 2 * k, v[k])
+
+static SSE_TARGET void blake2bLyraSSE41(uint64_t *state) {
+    SSE_DECLARE_STATE(state);
+    int i;
+    for (i = 0; i < 12; i++) {
+      SSE_ROUND(v);
+    }
+    SSE_SAVE_STATE(state);
+}
+
+static SSE_TARGET void reducedSqueezeRow0SSE41(uint64_t *state, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWord = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    uint64_t i;
+    SSE_DECLARE_STATE(state);
+    for (i = 0; i < nCols; i++) {
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWord + 2 * k, v[k]);
+      ptrWord -= BLOCK_LEN_INT64;
+      SSE_ROUND(v);
+    }
+    SSE_SAVE_STATE(state);
+}
+
+static SSE_TARGET void reducedDuplexRow1SSE41(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    uint64_t i;
+    SSE_DECLARE_STATE(state);
+    for (i = 0; i < nCols; i++) {
+      __m128i in[6];
+      for (k = 0; k < 6; k++) {
+        in[k] = SSE_LOAD(ptrWordIn + 2 * k);
+        v[k] = _mm_xor_si128(v[k], in[k]);
+      }
+      SSE_ROUND(v);
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWordOut + 2 * k, _mm_xor_si128(in[k], v[k]));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SSE_SAVE_STATE(state);
+}
+
+/*rotW(rand): (s11, s0), (s1, s2), ..., (s9, s10)*/
+#define SSE_ROTW(v, r) \
+    do { \
+        r[0] = _mm_alignr_epi8(v[0], v[5], 8); \
+        for (k = 1; k < 6; k++) r[k] = _mm_alignr_epi8(v[k], v[k - 1], 8); \
+    } while (0)
+
+static SSE_TARGET void reducedDuplexRowSetupSSE41(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordInOut = rowInOut;
+    uint64_t *ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    uint64_t i;
+    SSE_DECLARE_STATE(state);
+    for (i = 0; i < nCols; i++) {
+      __m128i in[6], io[6], r[6];
+      for (k = 0; k < 6; k++) {
+        in[k] = SSE_LOAD(ptrWordIn + 2 * k);
+        io[k] = SSE_LOAD(ptrWordInOut + 2 * k);
+        v[k] = _mm_xor_si128(v[k], _mm_add_epi64(in[k], io[k]));
+      }
+      SSE_ROUND(v);
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWordOut + 2 * k, _mm_xor_si128(in[k], v[k]));
+      SSE_ROTW(v, r);
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWordInOut + 2 * k, _mm_xor_si128(io[k], r[k]));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordInOut += BLOCK_LEN_INT64;
+      ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SSE_SAVE_STATE(state);
+}
+
+static SSE_TARGET void reducedDuplexRowSSE41(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t *ptrWordIn = rowIn;
+    uint64_t *ptrWordInOut = rowInOut;
+    uint64_t *ptrWordOut = rowOut;
+    uint64_t i;
+    SSE_DECLARE_STATE(state);
+    for (i = 0; i < nCols; i++) {
+      __m128i r[6];
+      for (k = 0; k < 6; k++) {
+        v[k] = _mm_xor_si128(v[k], _mm_add_epi64(SSE_LOAD(ptrWordIn + 2 * k), SSE_LOAD(ptrWordInOut + 2 * k)));
+      }
+      SSE_ROUND(v);
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWordOut + 2 * k, _mm_xor_si128(SSE_LOAD(ptrWordOut + 2 * k), v[k]));
+      //Reloaded after the store above: rowInOut may be rowOut
+      SSE_ROTW(v, r);
+      for (k = 0; k < 6; k++) SSE_STORE(ptrWordInOut + 2 * k, _mm_xor_si128(SSE_LOAD(ptrWordInOut + 2 * k), r[k]));
+      ptrWordIn += BLOCK_LEN_INT64;
+      ptrWordInOut += BLOCK_LEN_INT64;
+      ptrWordOut += BLOCK_LEN_INT64;
+    }
+    SSE_SAVE_STATE(state);
+}
+
+static const SpongeImpl spongeSSE41 = {
+    "sse4.1",
+    blake2bLyraSSE41,
+    reducedSqueezeRow0SSE41,
+    reducedDuplexRow1SSE41,
+    reducedDuplexRowSetupSSE41,
+    reducedDuplexRowSSE41,
+    1, NULL, NULL
+};
+
+//====================================== AVX2 =======================================//
+
+#define SPONGE_TARGET __attribute__((target("avx2")))
+#define SPONGE_FN(name) name##AVX2
+#define SPONGE_ROR32(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define SPONGE_ROR24(x) _mm256_shuffle_epi8(x, _mm256_setr_epi8( \
+    3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define SPONGE_ROR16(x) _mm256_shuffle_epi8(x, _mm256_setr_epi8( \
+    2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define SPONGE_ROR63(x) _mm256_xor_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+#define SPONGE_LANES(M) M(0) M(1)
+#include "Sponge-x86-256.h"
+#undef SPONGE_TARGET
+#undef SPONGE_FN
+#undef SPONGE_ROR32
+#undef SPONGE_ROR24
+#undef SPONGE_ROR16
+#undef SPONGE_ROR63
+#undef SPONGE_LANES
+
+static const SpongeImpl spongeAVX2 = {
+    "avx2",
+    blake2bLyraAVX2,
+    reducedSqueezeRow0AVX2,
+    reducedDuplexRow1AVX2,
+    reducedDuplexRowSetupAVX2,
+    reducedDuplexRowAVX2,
+    2,
+    reducedDuplexRowSetupLanesAVX2,
+    reducedDuplexRowLanesAVX2
+};
+
+//==================================== AVX-512VL ====================================//
+//Same kernels on 256-bit vectors, with AVX-512's native 64-bit rotation (vprorq)
+
+#define SPONGE_TARGET __attribute__((target("avx2,avx512f,avx512vl")))
+#define SPONGE_FN(name) name##AVX512
+#define SPONGE_ROR32(x) _mm256_ror_epi64(x, 32)
+#define SPONGE_ROR24(x) _mm256_ror_epi64(x, 24)
+#define SPONGE_ROR16(x) _mm256_ror_epi64(x, 16)
+#define SPONGE_ROR63(x) _mm256_ror_epi64(x, 63)
+#define SPONGE_LANES(M) M(0) M(1) M(2) M(3)
+#include "Sponge-x86-256.h"
+#undef SPONGE_TARGET
+#undef SPONGE_FN
+#undef SPONGE_ROR32
+#undef SPONGE_ROR24
+#undef SPONGE_ROR16
+#undef SPONGE_ROR63
+#undef SPONGE_LANES
+
+static const SpongeImpl spongeAVX512 = {
+    "avx512",
+    blake2bLyraAVX512,
+    reducedSqueezeRow0AVX512,
+    reducedDuplexRow1AVX512,
+    reducedDuplexRowSetupAVX512,
+    reducedDuplexRowAVX512,
+    4,
+    reducedDuplexRowSetupLanesAVX512,
+    reducedDuplexRowLanesAVX512
+};
+
+//================================ Feature detection ================================//
+
+static uint64_t xgetbv0(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static int cpuSupports(int impl) {
+    uint32_t eax, ebx, ecx, edx;
+    uint64_t xcr0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+      return 0;
+    }
+    //SSSE3 (bit 9) and SSE4.1 (bit 19)
+    if (!((ecx >> 9) & 1) || !((ecx >> 19) & 1)) {
+      return 0;
+    }
+    if (impl == SPONGE_IMPL_SSE41) {
+      return 1;
+    }
+    //AVX (bit 28) and the OS saving the AVX state (OSXSAVE, bit 27; XCR0 SSE and AVX bits)
+    if (!((ecx >> 27) & 1) || !((ecx >> 28) & 1)) {
+      return 0;
+    }
+    xcr0 = xgetbv0();
+    if ((xcr0 & 0x06) != 0x06 || __get_cpuid_max(0, NULL) < 7) {
+      return 0;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    //AVX2 (bit 5)
+    if (!((ebx >> 5) & 1)) {
+      return 0;
+    }
+    if (impl == SPONGE_IMPL_AVX2) {
+      return 1;
+    }
+    //AVX512F (bit 16), AVX512VL (bit 31) and the OS saving the opmask and ZMM state
+    return impl == SPONGE_IMPL_AVX512 && ((ebx >> 16) & 1) && ((ebx >> 31) & 1) && (xcr0 & 0xe6) == 0xe6;
+}
+
+/**
+ * Returns the vectorized implementation impl (SPONGE_IMPL_*) if the CPU supports it, NULL otherwise
+ */
+const SpongeImpl *spongeImplX86(int impl) {
+    if (!cpuSupports(impl)) {
+      return NULL;
+    }
+    switch (impl) {
+      case SPONGE_IMPL_SSE41: return &spongeSSE41;
+      case SPONGE_IMPL_AVX2: return &spongeAVX2;
+      case SPONGE_IMPL_AVX512: return &spongeAVX512;
+    }
+    return NULL;
+}
+
+#endif // SPONGE_USE_X86
@@ -24,7 +24,9 @@
 #include "Sponge.h"
 #include "Lyra2.h"
 
-
+static const SpongeImpl spongeGeneric;
+//Implementation used by the functions below, see spongeSelectImpl()
+static const SpongeImpl *activeSponge = &spongeGeneric;
 
 /**
  * Initializes the Sponge State. The first 512 bits are set to zeros and the remainder
@@ -56,7 +58,7 @@ inline void initState(uint64_t state[/*16*/]) {
  *
  * @param v     A 1024-bit (16 uint64_t) array to be processed by Blake2b's G function
  */
-inline static void blake2bLyra(uint64_t *v) {
+static void blake2bLyraGeneric(uint64_t *v) {
     ROUND_LYRA(0);
     ROUND_LYRA(1);
     ROUND_LYRA(2);
@@ -94,7 +96,7 @@ inline void squeeze(uint64_t *state, byte *out, unsigned int len) {
     //Squeezes full blocks
     for (i = 0; i < fullBlocks; i++) {
     memcpy(ptr, state, BLOCK_LEN_BYTES);
-    blake2bLyra(state);
+    activeSponge->blake2bLyra(state);
     ptr += BLOCK_LEN_BYTES;
     }
 
@@ -125,7 +127,7 @@ inline void absorbBlock(uint64_t *state, const uint64_t *in) {
     state[11] ^= in[11];
 
     //Applies the transformation f to the sponge's state
-    blake2bLyra(state);
+    activeSponge->blake2bLyra(state);
 }
 
 /**
@@ -149,7 +151,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
 
 
     //Applies the transformation f to the sponge's state
-    blake2bLyra(state);
+    activeSponge->blake2bLyra(state);
 
 }
 
@@ -161,7 +163,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
  * @param state     The current state of the sponge
  * @param rowOut    Row to receive the data squeezed
  */
-inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+static void reducedSqueezeRow0Generic(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
     uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
     int i;
     //M[row][C-1-col] = H.reduced_squeeze()
@@ -196,7 +198,7 @@ inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols
  * @param rowIn		Row to feed the sponge
  * @param rowOut	Row to receive the sponge's output
  */
-inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRow1Generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
     uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
     int i;
@@ -256,7 +258,7 @@ inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut
  * @param rowOut         Row receiving the output
  *
  */
-inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRowSetupGeneric(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
     uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
     uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
@@ -330,7 +332,7 @@ inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *ro
  * @param rowOut         Row receiving the output
  *
  */
-inline void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRowGeneric(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
     uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
     uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
@@ -730,6 +732,124 @@ inline void reducedDuplexRowd(uint64_t *state, uint64_t *rowIn, uint64_t *rowInO
 }
 */
 
+//---- Dispatch to the selected implementation
+void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+    activeSponge->reducedSqueezeRow0(state, rowOut, nCols);
+}
+
+void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    activeSponge->reducedDuplexRow1(state, rowIn, rowOut, nCols);
+}
+
+void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    activeSponge->reducedDuplexRowSetup(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    activeSponge->reducedDuplexRow(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+/**
+ * Runs reducedDuplexRowSetup() on n independent sponges, in groups of the implementation's lanes
+ */
+void reducedDuplexRowSetupBatch(size_t n, uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols) {
+    const SpongeImpl *sponge = activeSponge;
+    size_t l = 0;
+    if (sponge->nLanes > 1) {
+      for (; l + sponge->nLanes <= n; l += sponge->nLanes) {
+        sponge->reducedDuplexRowSetupLanes(state + l, rowIn + l, rowInOut + l, rowOut + l, nCols);
+      }
+    }
+    for (; l < n; l++) {
+      sponge->reducedDuplexRowSetup(state[l], rowIn[l], rowInOut[l], rowOut[l], nCols);
+    }
+}
+
+/**
+ * Runs reducedDuplexRow() on n independent sponges, in groups of the implementation's lanes
+ */
+void reducedDuplexRowBatch(size_t n, uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols) {
+    const SpongeImpl *sponge = activeSponge;
+    size_t l = 0;
+    if (sponge->nLanes > 1) {
+      for (; l + sponge->nLanes <= n; l += sponge->nLanes) {
+        sponge->reducedDuplexRowLanes(state + l, rowIn + l, rowInOut + l, rowOut + l, nCols);
+      }
+    }
+    for (; l < n; l++) {
+      sponge->reducedDuplexRow(state[l], rowIn[l], rowInOut[l], rowOut[l], nCols);
+    }
+}
+
+static const SpongeImpl spongeGeneric = {
+    "generic",
+    blake2bLyraGeneric,
+    reducedSqueezeRow0Generic,
+    reducedDuplexRow1Generic,
+    reducedDuplexRowSetupGeneric,
+    reducedDuplexRowGeneric,
+    1, NULL, NULL
+};
+
+static const SpongeImpl *spongeGetImpl(int impl) {
+    if (impl == SPONGE_IMPL_GENERIC) {
+      return &spongeGeneric;
+    }
+#ifdef SPONGE_USE_X86
+    return spongeImplX86(impl);
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * Name of an implementation (SPONGE_IMPL_*), whether or not it is supported here
+ */
+const char *spongeImplName(int impl) {
+    static const char *names[SPONGE_IMPL_COUNT] = {"generic", "sse4.1", "avx2", "avx512"};
+    if (impl < 0 || impl >= SPONGE_IMPL_COUNT) {
+      return "unknown";
+    }
+    return names[impl];
+}
+
+/**
+ * Returns 1 if the implementation was built and the CPU supports it
+ */
+int spongeImplSupported(int impl) {
+    return spongeGetImpl(impl) != NULL;
+}
+
+/**
+ * Makes the sponge functions use the given implementation.
+ *
+ * @return 1 on success; 0 if it is not supported (the selection is left unchanged)
+ */
+int spongeSelectImpl(int impl) {
+    const SpongeImpl *sponge = spongeGetImpl(impl);
+    if (sponge == NULL) {
+      return 0;
+    }
+    activeSponge = sponge;
+    return 1;
+}
+
+/**
+ * Selects the fastest supported implementation and returns its name
+ */
+const char *spongeAutoDetect(void) {
+    int impl;
+    for (impl = SPONGE_IMPL_COUNT - 1; impl > SPONGE_IMPL_GENERIC; impl--) {
+      if (spongeSelectImpl(impl)) {
+        break;
+      }
+    }
+    if (impl == SPONGE_IMPL_GENERIC) {
+      spongeSelectImpl(SPONGE_IMPL_GENERIC);
+    }
+    return activeSponge->name;
+}
+
 /**
  Prints an array of unsigned chars
  */
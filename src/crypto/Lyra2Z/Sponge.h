@@ -22,6 +22,7 @@
 #ifndef SPONGE_H_
 #define SPONGE_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #if defined(__GNUC__)
@@ -73,6 +74,33 @@ static inline uint64_t rotr64( const uint64_t w, const unsigned c ){
     G(r,7,v[ 3],v[ 4],v[ 9],v[14]);
 
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPONGE_USE_X86 1 //SIMD kernels in Sponge-x86.c, selected at runtime
+#endif
+
+/**
+ * One implementation of the sponge's permutation and row operations. The generic one is plain C;
+ * the others are vectorized and produce bit-identical results.
+ *
+ * The *Lanes functions, if nLanes > 1, run the duplexing row operation on nLanes independent sponges
+ * (one state and set of rows per lane) at once, interleaving their rounds.
+ */
+typedef struct {
+    const char *name;
+    void (*blake2bLyra)(uint64_t *v);
+    void (*reducedSqueezeRow0)(uint64_t *state, uint64_t *rowOut, uint64_t nCols);
+    void (*reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+    void (*reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+    void (*reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+    unsigned int nLanes;
+    void (*reducedDuplexRowSetupLanes)(uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols);
+    void (*reducedDuplexRowLanes)(uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols);
+} SpongeImpl;
+
+#ifdef SPONGE_USE_X86
+const SpongeImpl *spongeImplX86(int impl);
+#endif
+
 //---- Housekeeping
 void initState(uint64_t state[/*16*/]);
 
@@ -88,6 +116,8 @@ void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in);
 void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
 void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
 void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRowSetupBatch(size_t n, uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols);
+void reducedDuplexRowBatch(size_t n, uint64_t *state[], uint64_t *rowIn[], uint64_t *rowInOut[], uint64_t *rowOut[], uint64_t nCols);
 
 //---- Misc
 void printArray(unsigned char *array, unsigned int size, char *name);
@@ -315,9 +315,7 @@ void scrypt_detect_sse2(unsigned int cpuid_edx)
 #endif
 #endif
 
-void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor) {
-    //char scratchpad[((1 << (Nfactor + 1)) * 128) + 63];
-    char *scratchpad = (char *) malloc((((1 << (Nfactor + 1)) * 128 ) + 63  ) * sizeof (char));
+static void scrypt_N_1_1_256_sp_best(const char *input, char *output, char *scratchpad, unsigned char Nfactor) {
 #if defined(USE_SSE2)
     // Detection would work, but in cases where we KNOW it always has SSE2,
         // it is faster to use directly than to use a function pointer or conditional.
@@ -332,5 +330,36 @@ void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor) {
     // Generic scrypt
     scrypt_N_1_1_256_sp_generic(input, output, scratchpad, Nfactor);
 #endif
+}
+
+void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor) {
+    //char scratchpad[((1 << (Nfactor + 1)) * 128) + 63];
+    char *scratchpad = (char *) malloc((((1 << (Nfactor + 1)) * 128 ) + 63  ) * sizeof (char));
+    scrypt_N_1_1_256_sp_best(input, output, scratchpad, Nfactor);
     free(scratchpad);
 }
+
+void scrypt_ctx_init(SCRYPT_CTX *ctx) {
+    ctx->scratchpad = NULL;
+    ctx->size = 0;
+}
+
+void scrypt_ctx_free(SCRYPT_CTX *ctx) {
+    free(ctx->scratchpad);
+    scrypt_ctx_init(ctx);
+}
+
+bool scrypt_N_1_1_256_ctx(SCRYPT_CTX *ctx, const char *input, char *output, unsigned char Nfactor) {
+    size_t size = (((size_t)1 << (Nfactor + 1)) * 128) + 63;
+    if (size > ctx->size) {
+        free(ctx->scratchpad);
+        ctx->scratchpad = (char *) malloc(size);
+        if (ctx->scratchpad == NULL) {
+            ctx->size = 0;
+            return false;
+        }
+        ctx->size = size;
+    }
+    scrypt_N_1_1_256_sp_best(input, output, ctx->scratchpad, Nfactor);
+    return true;
+}
@@ -5,7 +5,20 @@
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
+/**
+ * Caller-owned scratchpad for scrypt_N_1_1_256_ctx(). It is grown to fit the largest
+ * Nfactor hashed with it and kept between calls. Not safe for concurrent use.
+ */
+typedef struct {
+    char *scratchpad;
+    size_t size;
+} SCRYPT_CTX;
+
+void scrypt_ctx_init(SCRYPT_CTX *ctx);
+void scrypt_ctx_free(SCRYPT_CTX *ctx);
+
 void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor);
+bool scrypt_N_1_1_256_ctx(SCRYPT_CTX *ctx, const char *input, char *output, unsigned char Nfactor);
 void scrypt_N_1_1_256_sp_generic(const char *input, char *output, char *scratchpad, unsigned char Nfactor);
 
 #if defined(USE_SSE2)
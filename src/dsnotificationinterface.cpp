@@ -0,0 +1,19 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dsnotificationinterface.h"
+#include "znodeman.h"
+
+CDSNotificationInterface::CDSNotificationInterface()
+{
+}
+
+CDSNotificationInterface::~CDSNotificationInterface()
+{
+}
+
+void CDSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, const CBlock *pblock)
+{
+    mnodeman.SyncTransaction(tx, pindex, pblock);
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_DSNOTIFICATIONINTERFACE_H
+#define BITCOIN_DSNOTIFICATIONINTERFACE_H
+
+#include "validationinterface.h"
+
+/** Passes the validation events the Enode subsystems follow on to them */
+class CDSNotificationInterface : public CValidationInterface
+{
+public:
+    CDSNotificationInterface();
+    virtual ~CDSNotificationInterface();
+
+protected:
+    // CValidationInterface
+    void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, const CBlock *pblock);
+};
+
+#endif // BITCOIN_DSNOTIFICATIONINTERFACE_H
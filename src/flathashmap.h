@@ -0,0 +1,216 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATHASHMAP_H
+#define BITCOIN_FLATHASHMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash multimap stored in a single array, with open addressing and linear probing.
+ * Entries with equal keys are allowed and are found in the order they were inserted.
+ * There is no per-entry allocation, so it suits many small entries with cheap hashes,
+ * like digests. Erasing moves the following entries of the probe sequence back, no
+ * tombstones are left. Pointers returned by find_if are invalidated by insert and erase.
+ */
+template <typename K, typename V, typename Hash>
+class flathashmultimap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef size_t size_type;
+
+    flathashmultimap() : nSize(0), nMask(0) {}
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    void clear()
+    {
+        slots.clear();
+        used.clear();
+        nSize = 0;
+        nMask = 0;
+    }
+
+    //! Make room for n entries without rehashing
+    void reserve(size_type n)
+    {
+        size_type nCapacity = 16;
+        while (nCapacity < 2 * n)
+            nCapacity *= 2;
+        if (nCapacity > slots.size())
+            rehash(nCapacity);
+    }
+
+    void insert(const K& key, const V& value)
+    {
+        // Keep the load factor under one half
+        if (2 * (nSize + 1) > slots.size())
+            rehash(slots.empty() ? 16 : 2 * slots.size());
+        size_type i = Hash()(key) & nMask;
+        while (used[i])
+            i = (i + 1) & nMask;
+        slots[i] = value_type(key, value);
+        used[i] = true;
+        nSize++;
+    }
+
+    size_type count(const K& key) const
+    {
+        size_type n = 0;
+        for (size_type i = first(key); i != npos(); i = next(key, i))
+            n++;
+        return n;
+    }
+
+    //! First value inserted with key for which pred(value) is true, or NULL
+    template <typename Pred>
+    const V* find_if(const K& key, Pred pred) const
+    {
+        for (size_type i = first(key); i != npos(); i = next(key, i)) {
+            if (pred(slots[i].second))
+                return &slots[i].second;
+        }
+        return NULL;
+    }
+
+    const V* find(const K& key) const
+    {
+        size_type i = first(key);
+        return i == npos() ? NULL : &slots[i].second;
+    }
+
+    //! Erase the first entry of key for which pred(value) is true
+    template <typename Pred>
+    bool erase_if(const K& key, Pred pred)
+    {
+        for (size_type i = first(key); i != npos(); i = next(key, i)) {
+            if (pred(slots[i].second)) {
+                erase_slot(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! Erase all the entries of key, returns their number
+    size_type erase(const K& key)
+    {
+        size_type n = 0;
+        size_type i;
+        while ((i = first(key)) != npos()) {
+            erase_slot(i);
+            n++;
+        }
+        return n;
+    }
+
+    //! Heap memory used by the table
+    size_t DynamicMemoryUsage() const
+    {
+        return slots.capacity() * sizeof(value_type) + used.capacity() / 8;
+    }
+
+private:
+    std::vector<value_type> slots;
+    std::vector<bool> used;
+    size_type nSize;
+    size_type nMask;
+
+    static size_type npos() { return (size_type)-1; }
+
+    size_type first(const K& key) const
+    {
+        if (nSize == 0)
+            return npos();
+        return scan(key, Hash()(key) & nMask);
+    }
+
+    size_type next(const K& key, size_type i) const
+    {
+        return scan(key, (i + 1) & nMask);
+    }
+
+    // First slot of key from i on, stopping at the end of the probe sequence
+    size_type scan(const K& key, size_type i) const
+    {
+        while (used[i]) {
+            if (slots[i].first == key)
+                return i;
+            i = (i + 1) & nMask;
+        }
+        return npos();
+    }
+
+    void erase_slot(size_type i)
+    {
+        // Move back the entries whose home slot is not after the gap
+        size_type j = i;
+        for (;;) {
+            j = (j + 1) & nMask;
+            if (!used[j])
+                break;
+            size_type home = Hash()(slots[j].first) & nMask;
+            if (((j - home) & nMask) >= ((j - i) & nMask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = value_type();
+        used[i] = false;
+        nSize--;
+    }
+
+    void rehash(size_type nCapacity)
+    {
+        std::vector<value_type> oldSlots(nCapacity);
+        std::vector<bool> oldUsed(nCapacity, false);
+        oldSlots.swap(slots);
+        oldUsed.swap(used);
+        nMask = nCapacity - 1;
+        nSize = 0;
+        if (oldSlots.empty())
+            return;
+        // Entries of the same key keep their order if every probe sequence is copied
+        // from its start, which is after a free slot
+        size_type nStart = 0;
+        while (oldUsed[nStart])
+            nStart++;
+        for (size_type n = 1; n <= oldSlots.size(); n++) {
+            size_type i = (nStart + n) % oldSlots.size();
+            if (oldUsed[i])
+                insert(oldSlots[i].first, oldSlots[i].second);
+        }
+    }
+};
+
+/** Hash multiset on top of flathashmultimap */
+template <typename K, typename Hash>
+class flathashmultiset
+{
+public:
+    typedef K key_type;
+    typedef size_t size_type;
+
+    size_type size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+    void clear() { map.clear(); }
+    void reserve(size_type n) { map.reserve(n); }
+    void insert(const K& key) { map.insert(key, Empty()); }
+    size_type count(const K& key) const { return map.count(key); }
+    size_type erase(const K& key) { return map.erase(key); }
+    size_t DynamicMemoryUsage() const { return map.DynamicMemoryUsage(); }
+
+private:
+    struct Empty {};
+    flathashmultimap<K, Empty, Hash> map;
+};
+
+#endif // BITCOIN_FLATHASHMAP_H
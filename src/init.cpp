@@ -17,6 +17,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/Lyra2Z/Lyra2.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -25,6 +26,7 @@
 #include "miner.h"
 #include "net.h"
 #include "policy/policy.h"
+#include "primitives/powcache.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "script/standard.h"
@@ -73,6 +75,7 @@
 #include <event2/thread.h>
 #include "activeznode.h"
 #include "darksend.h"
+#include "dsnotificationinterface.h"
 #include "znode-payments.h"
 #include "znode-sync.h"
 #include "znodeman.h"
@@ -98,6 +101,8 @@ static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
 #endif
 
+static CDSNotificationInterface* pdsNotificationInterface = NULL;
+
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
 // accessing block files don't count towards the fd_set size limit
@@ -289,6 +294,12 @@ void Shutdown() {
     }
 #endif
 
+    if (pdsNotificationInterface) {
+        UnregisterValidationInterface(pdsNotificationInterface);
+        delete pdsNotificationInterface;
+        pdsNotificationInterface = NULL;
+    }
+
 #ifndef WIN32
     try {
         boost::filesystem::remove(GetPidFile());
@@ -363,6 +374,12 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-checklevel=<n>",
                                strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"),
                                          DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-checkpowblocks=<n>",
+                               strprintf(_("How many of the highest block index entries get their stored proof-of-work hash recomputed at startup (default: %u, 0 = all)"),
+                                         DEFAULT_CHECKPOWBLOCKS));
+    strUsage += HelpMessageOpt("-checkpowsample=<n>",
+                               strprintf(_("How many randomly chosen block index entries get their stored proof-of-work hash recomputed at startup (default: %u)"),
+                                         DEFAULT_CHECKPOWSAMPLE));
     strUsage += HelpMessageOpt("-conf=<file>",
                                strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND) {
@@ -387,7 +404,7 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(
             _("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(
-            _("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+            _("Set the number of script and header verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
             -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
@@ -573,6 +590,12 @@ std::string HelpMessage(HelpMessageMode mode) {
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>",
                                    strprintf("Limit size of signature cache to <n> MiB (default: %u)",
                                              DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-zcverifycachesize=<n>",
+                                   strprintf("Limit size of zerocoin spend proof verification cache to <n> MiB (default: %u)",
+                                             DEFAULT_MAX_ZC_VERIFY_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-powhashcachesize=<n>",
+                                   strprintf("Limit size of proof-of-work hash cache to <n> entries (default: %u)",
+                                             DEFAULT_POW_HASH_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf(
                 "Maximum tip age in seconds to consider node in initial block download (default: %u)",
                 DEFAULT_MAX_TIP_AGE));
@@ -1185,6 +1208,8 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    powHashCache.SetMaxSize(std::max((int64_t)0, GetArg("-powhashcachesize", DEFAULT_POW_HASH_CACHE_SIZE)));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
@@ -1344,12 +1369,16 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     LogPrintf("Using data directory %s\n", strDataDir);
     LogPrintf("Using config file %s\n", GetConfigFile().string());
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrintf("Using %s Lyra2 sponge implementation\n", spongeAutoDetect());
     std::ostringstream strErrors;
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script, header PoW and zerocoin spend verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadHeaderPoWCheck);
+            threadGroup.create_thread(&ThreadZerocoinSpendCheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1529,6 +1558,10 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
         RegisterValidationInterface(pzmqNotificationInterface);
     }
 #endif
+
+    pdsNotificationInterface = new CDSNotificationInterface();
+    RegisterValidationInterface(pdsNotificationInterface);
+
     if (mapArgs.count("-maxuploadtarget")) {
         CNode::SetMaxOutboundTarget(GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET) * 1024 * 1024);
     }
@@ -1686,6 +1719,11 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
                     strLoadError = _("Corrupted block database detected");
                     break;
                 }
+
+                if (!BuildEnodePayeeIndex(chainparams)) {
+                    strLoadError = _("Error building enode payee index");
+                    break;
+                }
             } catch (const std::exception &e) {
                 if (fDebug) LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
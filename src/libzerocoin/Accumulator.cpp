@@ -40,7 +40,7 @@ Accumulator::Accumulator(const Params* p, const Bignum &v, const CoinDenominatio
 
 Accumulator::Accumulator(const Params* p, const CoinDenomination d) :Accumulator(p, p->accumulatorParams.accumulatorBase, d) {}
 
-void Accumulator::accumulate(const PublicCoin& coin, bool validateCoin) {
+void Accumulator::checkCoin(const PublicCoin& coin, bool validateCoin) const {
 	// Make sure we're initialized
 	if(!(this->value)) {
 		throw ZerocoinException("Accumulator is not initialized");
@@ -56,14 +56,44 @@ void Accumulator::accumulate(const PublicCoin& coin, bool validateCoin) {
 		throw ZerocoinException(msg);
 	}
 
-	if(!validateCoin || coin.validate()) {
-		// Compute new accumulator = "old accumulator"^{element} mod N
-		this->value = this->value.pow_mod(coin.getValue(), this->params->accumulatorModulus);
-	} else {
+	if(validateCoin && !coin.validate()) {
 		throw ZerocoinException("Coin is not valid");
 	}
 }
 
+void Accumulator::accumulate(const PublicCoin& coin, bool validateCoin) {
+	checkCoin(coin, validateCoin);
+
+	// Compute new accumulator = "old accumulator"^{element} mod N
+	this->value = this->value.pow_mod_mont(coin.getValue(), this->params->accumulatorModulus, this->params->accumulatorModulusMont);
+}
+
+void Accumulator::accumulateMany(const std::vector<PublicCoin>& coins, bool validateCoins) {
+	for (const PublicCoin& coin : coins) {
+		checkCoin(coin, validateCoins);
+	}
+
+	// ((v^a)^b)^c = v^(a*b*c) mod N. The product of a batch is built as a
+	// balanced tree so that the big multiplications are of similar sizes.
+	for (size_t start = 0; start < coins.size(); start += ACCUMULATOR_BATCH_SIZE) {
+		std::vector<Bignum> level;
+		for (size_t i = start; i < coins.size() && i < start + ACCUMULATOR_BATCH_SIZE; i++) {
+			level.push_back(coins[i].getValue());
+		}
+		while (level.size() > 1) {
+			std::vector<Bignum> next;
+			for (size_t i = 0; i + 1 < level.size(); i += 2) {
+				next.push_back(level[i] * level[i + 1]);
+			}
+			if (level.size() % 2) {
+				next.push_back(level.back());
+			}
+			level.swap(next);
+		}
+		this->value = this->value.pow_mod_mont(level[0], this->params->accumulatorModulus, this->params->accumulatorModulusMont);
+	}
+}
+
 CoinDenomination Accumulator::getDenomination() const {
 	return static_cast<CoinDenomination> (this->denomination);
 }
@@ -92,6 +122,17 @@ void AccumulatorWitness::AddElement(const PublicCoin& c) {
 	}
 }
 
+void AccumulatorWitness::AddElements(const std::vector<PublicCoin>& coins) {
+	std::vector<PublicCoin> others;
+	others.reserve(coins.size());
+	for (const PublicCoin& c : coins) {
+		if(element != c) {
+			others.push_back(c);
+		}
+	}
+	witness.accumulateMany(others);
+}
+
 const Bignum& AccumulatorWitness::getValue() const {
 	return this->witness.getValue();
 }
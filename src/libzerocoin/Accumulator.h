@@ -61,6 +61,20 @@ public:
 	 **/
     void accumulate(const PublicCoin &coin, bool validateCoin=false);
 
+	/**
+	 * Accumulate several coins at once. Same result as accumulating them
+	 * one by one, in any order: the coin values are multiplied into one
+	 * exponent, ACCUMULATOR_BATCH_SIZE at a time, so that the accumulator
+	 * is raised once per batch instead of once per coin.
+	 *
+	 * @param coins			the PublicCoins to accumulate
+	 * @param validateCoins	validate every coin first
+	 *
+	 * @throw		Zerocoin exception if a coin is not valid or of another
+	 *				denomination, in which case nothing is accumulated.
+	 **/
+    void accumulateMany(const std::vector<PublicCoin> &coins, bool validateCoins=false);
+
 	CoinDenomination getDenomination() const;
 	/** Get the accumulator result
 	 *
@@ -93,6 +107,8 @@ public:
 		READWRITE(denomination);
 	}
 private:
+	void checkCoin(const PublicCoin &coin, bool validateCoin) const;
+
 	const AccumulatorAndProofParams* params;
 	Bignum value;
 	// Denomination is stored as an INT because storing
@@ -123,6 +139,12 @@ public:
 	 */
     void AddElement(const PublicCoin& c);
 
+	/** Adds several elements at once, see Accumulator::accumulateMany
+	 *
+	 * @param coins the coins to add
+	 */
+    void AddElements(const std::vector<PublicCoin>& coins);
+
 	/**
 	 *
 	 * @return the value of the witness
@@ -34,9 +34,14 @@ namespace libzerocoin {
         Bignum r_2 = Bignum::randBignum(params->accumulatorModulus / 4);
         Bignum r_3 = Bignum::randBignum(params->accumulatorModulus / 4);
 
-        this->C_e = g_n.pow_mod(e, params->accumulatorModulus) * h_n.pow_mod(r_1, params->accumulatorModulus);
-        this->C_u = witness.getValue() * h_n.pow_mod(r_2, params->accumulatorModulus);
-        this->C_r = g_n.pow_mod(r_2, params->accumulatorModulus) * h_n.pow_mod(r_3, params->accumulatorModulus);
+        const IntegerGroupParams &pok = params->accumulatorPoKCommitmentGroup;
+        const Bignum &N = params->accumulatorModulus;
+        const CBigNumMontCtx &NMont = params->accumulatorModulusMont;
+
+        // The exponents of the prover are secret, they are not looked up in the fixed-base tables
+        this->C_e = MultiExp(N, NMont).add(g_n, e).result() * MultiExp(N, NMont).add(h_n, r_1).result();
+        this->C_u = witness.getValue() * MultiExp(N, NMont).add(h_n, r_2).result();
+        this->C_r = MultiExp(N, NMont).add(g_n, r_2).result() * MultiExp(N, NMont).add(h_n, r_3).result();
 
         Bignum r_alpha = Bignum::randBignum(params->maxCoinValue * Bignum(2).pow(params->k_prime + params->k_dprime));
         if (!(Bignum::randBignum(Bignum(3)) % 2)) {
@@ -78,32 +83,20 @@ namespace libzerocoin {
             r_delta = 0 - r_delta;
         }
 
-        this->st_1 = (sg.pow_mod(r_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                      sh.pow_mod(r_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-        this->st_2 = (((commitmentToCoin.getCommitmentValue() *
-                        sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(r_gamma,
-                                                                                           params->accumulatorPoKCommitmentGroup.modulus)) *
-                      sh.pow_mod(r_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-        this->st_3 = ((sg * commitmentToCoin.getCommitmentValue()).pow_mod(r_sigma,
-                                                                           params->accumulatorPoKCommitmentGroup.modulus) *
-                      sh.pow_mod(r_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-
-        this->t_1 =
-                (h_n.pow_mod(r_zeta, params->accumulatorModulus) * g_n.pow_mod(r_epsilon, params->accumulatorModulus)) %
-                params->accumulatorModulus;
-        this->t_2 =
-                (h_n.pow_mod(r_eta, params->accumulatorModulus) * g_n.pow_mod(r_alpha, params->accumulatorModulus)) %
-                params->accumulatorModulus;
-        this->t_3 = (C_u.pow_mod(r_alpha, params->accumulatorModulus) *
-                     ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) %
-                    params->accumulatorModulus;
-        this->t_4 = (C_r.pow_mod(r_alpha, params->accumulatorModulus) *
-                     ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_delta, params->accumulatorModulus)) *
-                     ((g_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) %
-                    params->accumulatorModulus;
+        // (V * sg^-1)^x = V^x * sg^-x and (sg * V)^x = sg^x * V^x
+        const Bignum &V = commitmentToCoin.getCommitmentValue();
+        this->st_1 = MultiExp(pok.modulus, pok.modulusMont).add(sg, r_alpha).add(sh, r_phi).result();
+        this->st_2 = MultiExp(pok.modulus, pok.modulusMont).add(V, r_gamma).add(sg, Bignum(0) - r_gamma)
+                             .add(sh, r_psi).result();
+        this->st_3 = MultiExp(pok.modulus, pok.modulusMont).add(sg, r_sigma).add(V, r_sigma)
+                             .add(sh, r_xi).result();
+
+        this->t_1 = MultiExp(N, NMont).add(h_n, r_zeta).add(g_n, r_epsilon).result();
+        this->t_2 = MultiExp(N, NMont).add(h_n, r_eta).add(g_n, r_alpha).result();
+        // h_n^-1 and g_n^-1 raised to x are h_n and g_n raised to -x
+        this->t_3 = MultiExp(N, NMont).add(C_u, r_alpha).add(h_n, Bignum(0) - r_beta).result();
+        this->t_4 = MultiExp(N, NMont).add(C_r, r_alpha).add(h_n, Bignum(0) - r_delta)
+                            .add(g_n, Bignum(0) - r_beta).result();
 
         CHashWriter hasher(0, 0);
         hasher << *params << sg << sh << g_n << h_n << commitmentToCoin.getCommitmentValue() << C_e << C_u << C_r
@@ -144,38 +137,31 @@ namespace libzerocoin {
 
         Bignum c = Bignum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-        Bignum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
-                                                                                              sg.inverse(
-                                                                                                      params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(
-                s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) *
-                             sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             (sg * valueOfCommitmentToCoin).pow_mod(s_sigma,
-                                                                    params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-
-        Bignum t_1_prime =
-                (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-        Bignum t_2_prime =
-                (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-
-        Bignum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) *
-                            C_u.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
-
-        Bignum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) *
-                            ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
+        const IntegerGroupParams &pok = params->accumulatorPoKCommitmentGroup;
+        const IntegerGroupParams &qrn = params->accumulatorQRNCommitmentGroup;
+        const Bignum &N = params->accumulatorModulus;
+        const CBigNumMontCtx &NMont = params->accumulatorModulusMont;
+        const Bignum &V = valueOfCommitmentToCoin;
+
+        // (V * sg^-1)^x = V^x * sg^-x and (sg * V)^x = sg^x * V^x
+        Bignum st_1_prime = MultiExp(pok.modulus, pok.modulusMont).add(V, c).add(sg, s_alpha, pok.gTable)
+                                    .add(sh, s_phi, pok.hTable).result();
+        Bignum st_2_prime = MultiExp(pok.modulus, pok.modulusMont).add(sg, c - s_gamma, pok.gTable).add(V, s_gamma)
+                                    .add(sh, s_psi, pok.hTable).result();
+        Bignum st_3_prime = MultiExp(pok.modulus, pok.modulusMont).add(sg, c + s_sigma, pok.gTable).add(V, s_sigma)
+                                    .add(sh, s_xi, pok.hTable).result();
+
+        Bignum t_1_prime = MultiExp(N, NMont).add(C_r, c).add(h_n, s_zeta, qrn.hTable)
+                                   .add(g_n, s_epsilon, qrn.gTable).result();
+        Bignum t_2_prime = MultiExp(N, NMont).add(C_e, c).add(h_n, s_eta, qrn.hTable)
+                                   .add(g_n, s_alpha, qrn.gTable).result();
+
+        // h_n^-1 and g_n^-1 raised to x are h_n and g_n raised to -x
+        Bignum t_3_prime = MultiExp(N, NMont).add(a.getValue(), c).add(C_u, s_alpha)
+                                   .add(h_n, Bignum(0) - s_beta, qrn.hTable).result();
+
+        Bignum t_4_prime = MultiExp(N, NMont).add(C_r, s_alpha).add(h_n, Bignum(0) - s_delta, qrn.hTable)
+                                   .add(g_n, Bignum(0) - s_beta, qrn.gTable).result();
 
         bool result = false;
 
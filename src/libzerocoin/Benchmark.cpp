@@ -19,8 +19,10 @@ using namespace std;
 #include <exception>
 #include <cstdlib>
 #include <sys/time.h>
+#include <boost/thread.hpp>
 
 #include "Zerocoin.h"
+#include "../streams.h"
 
 using namespace libzerocoin;
 
@@ -224,6 +226,55 @@ Test_ParamGen()
 	return result;
 }
 
+// Times count exponentiations base^e mod modulus with bits-long exponents, the way
+// the proofs do them, with and without the cached Montgomery context
+static bool
+TimeModExp(const char *name, const Bignum &base, const Bignum &modulus, const CBigNumMontCtx &mont, uint32_t bits, int count)
+{
+	vector<Bignum> exponents, plain(count), cached(count);
+	for (int i = 0; i < count; i++) {
+		exponents.push_back(Bignum::RandKBitBigum(bits));
+	}
+
+	timer.start();
+	for (int i = 0; i < count; i++) {
+		plain[i] = base.pow_mod(exponents[i], modulus);
+	}
+	timer.stop();
+	int plainDuration = timer.duration();
+
+	timer.start();
+	for (int i = 0; i < count; i++) {
+		cached[i] = base.pow_mod_mont(exponents[i], modulus, mont);
+	}
+	timer.stop();
+
+	cout << "\t" << name << " (" << count << " x " << modulus.bitSize() << "-bit modulus, " << bits << "-bit exponent):\n\t\tpow_mod: " <<
+	        plainDuration << " ms\tpow_mod_mont: " << timer.duration() << " ms" << endl;
+
+	return plain == cached;
+}
+
+bool
+Test_ModExpMont()
+{
+	try {
+		const AccumulatorAndProofParams &ap = g_Params->accumulatorParams;
+		const IntegerGroupParams &sok = g_Params->serialNumberSoKCommitmentGroup;
+		bool result = true;
+
+		// Challenges of the accumulator proof and accumulated coin values
+		result &= TimeModExp("ACCUMULATOR MODEXP", ap.accumulatorBase, ap.accumulatorModulus, ap.accumulatorModulusMont, 256, 2000);
+		// Serial number signature of knowledge, zkp_iterations of these per spend
+		result &= TimeModExp("SERIAL SOK MODEXP", sok.h, sok.modulus, sok.modulusMont, sok.groupOrder.bitSize(), 2000);
+		result &= TimeModExp("SERIAL SOK ORDER MODEXP", g_Params->coinCommitmentGroup.h, sok.groupOrder, sok.groupOrderMont, 256, 2000);
+		return result;
+	} catch (runtime_error &e) {
+		cout << e.what() << endl;
+		return false;
+	}
+}
+
 bool
 Test_Accumulator()
 {
@@ -293,6 +344,25 @@ Test_MintCoin()
 	return true;
 }
 
+bool
+Test_MintCoins()
+{
+	try {
+		timer.start();
+		vector<PrivateCoin> coins = PrivateCoin::MintCoins(g_Params, TESTS_COINS_TO_ACCUMULATE);
+		timer.stop();
+		if (coins.size() != TESTS_COINS_TO_ACCUMULATE) {
+			return false;
+		}
+	} catch (exception &e) {
+		return false;
+	}
+
+	cout << "\tPARALLEL MINT ELAPSED TIME (" << boost::thread::hardware_concurrency() << " threads):\n\t\tTotal: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s\n\t\tPer Coin: " << timer.duration()/TESTS_COINS_TO_ACCUMULATE << " ms\t" << (timer.duration()/TESTS_COINS_TO_ACCUMULATE)*0.001 << " s" << endl;
+
+	return true;
+}
+
 bool
 Test_MintAndSpend()
 {
@@ -329,8 +399,33 @@ Test_MintAndSpend()
 
 		cout << "\tWITNESS ELAPSED TIME: \n\t\tTotal: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s\n\t\tPer Element: " << timer.duration()/TESTS_COINS_TO_ACCUMULATE << " ms\t" << (timer.duration()/TESTS_COINS_TO_ACCUMULATE)*0.001 << " s" << endl;
 
+		// The same accumulator and witness, in batches
+		vector<PublicCoin> pubCoins;
+		for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+			pubCoins.push_back(gCoins[i]->getPublicCoin());
+		}
+		Accumulator accBatch(&g_Params->accumulatorParams);
+		AccumulatorWitness wBatch(g_Params, accBatch, gCoins[0]->getPublicCoin());
+
+		timer.start();
+		accBatch.accumulateMany(pubCoins);
+		timer.stop();
+
+		cout << "\tBATCH ACCUMULATOR ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
+		timer.start();
+		wBatch.AddElements(pubCoins);
+		timer.stop();
+
+		cout << "\tBATCH WITNESS ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
+		if (accBatch.getValue() != acc.getValue() || wBatch.getValue() != wAcc.getValue()) {
+			cout << "Batch accumulation doesn't match" << endl;
+			return false;
+		}
+
 		// Now spend the coin
-		SpendMetaData m(1,1);
+		SpendMetaData m(1, uint256());
 
 		timer.start();
 		CoinSpend spend(g_Params, *(gCoins[0]), acc, wAcc, m);
@@ -381,7 +476,9 @@ Test_RunAllTests()
 	LogTestResult("parameter sizes are correct", Test_CalcParamSizes);
 	LogTestResult("group/field parameters can be generated", Test_GenerateGroupParams);
 	LogTestResult("parameter generation is correct", Test_ParamGen);
+	LogTestResult("cached Montgomery exponentiation matches and is faster", Test_ModExpMont);
 	LogTestResult("coins can be minted", Test_MintCoin);
+	LogTestResult("coins can be minted on several threads", Test_MintCoins);
 	LogTestResult("the accumulator works", Test_Accumulator);
 	LogTestResult("a minted coin can be spent", Test_MintAndSpend);
 
@@ -13,6 +13,7 @@
 #include <stdexcept>
 #include <openssl/rand.h>
 #include "Zerocoin.h"
+#include "ParallelTasks.h"
 
 namespace libzerocoin {
 secp256k1_context* init_ctx() {
@@ -104,6 +105,79 @@ unsigned int PrivateCoin::getVersion() const {
      return this->version;
 }
 
+// Coin candidates with a prime factor below this bound are rejected by trial
+// division before the much slower Miller-Rabin test
+#define MINT_SIEVE_BOUND	4096
+
+namespace {
+
+// Small odd primes grouped so that the product of each group fits in 32 bits,
+// one BN_mod_word per group then gives the residues modulo all its primes
+class SmallPrimeSieve {
+public:
+	SmallPrimeSieve() {
+		std::vector<bool> composite(MINT_SIEVE_BOUND, false);
+		uint64_t product = 1;
+		for (uint32_t p = 3; p < MINT_SIEVE_BOUND; p += 2) {
+			if (composite[p]) {
+				continue;
+			}
+			for (uint32_t m = p * p; m < MINT_SIEVE_BOUND; m += 2 * p) {
+				composite[m] = true;
+			}
+			if (groups.empty() || product * p > 0xffffffffULL) {
+				groups.push_back(Group());
+				product = 1;
+			}
+			product *= p;
+			groups.back().product = (BN_ULONG)product;
+			groups.back().primes.push_back(p);
+			largestPrime = p;
+		}
+	}
+
+	// True if n is even or divisible by one of the primes, and is not that prime
+	bool hasSmallFactor(const Bignum& n) const {
+		if (n <= Bignum(largestPrime)) {
+			return false;
+		}
+		if (!BN_is_odd(&n)) {
+			return true;
+		}
+		for (const Group& group : groups) {
+			BN_ULONG residue = BN_mod_word(&n, group.product);
+			if (residue == (BN_ULONG)-1) {
+				throw bignum_error("SmallPrimeSieve : BN_mod_word failed");
+			}
+			for (uint32_t p : group.primes) {
+				if (residue % p == 0) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+private:
+	struct Group {
+		BN_ULONG product;
+		std::vector<uint32_t> primes;
+	};
+	std::vector<Group> groups;
+	uint32_t largestPrime;
+};
+
+// Same result as v.isPrime(ZEROCOIN_MINT_PRIME_PARAM) && min <= v <= max
+bool isValidCoinValue(const Bignum& v, const Params* params) {
+	static const SmallPrimeSieve sieve;
+	return v >= params->accumulatorParams.minCoinValue &&
+	       v <= params->accumulatorParams.maxCoinValue &&
+	       !sieve.hasSmallFactor(v) &&
+	       v.isPrime(ZEROCOIN_MINT_PRIME_PARAM);
+}
+
+} // namespace
+
 void PrivateCoin::mintCoin(const CoinDenomination denomination) {
 
 	Bignum s;
@@ -138,11 +212,7 @@ void PrivateCoin::mintCoin(const CoinDenomination denomination) {
 		// Now verify that the commitment is a prime number
 		// in the appropriate range. If not, we'll throw this coin
 		// away and generate a new one.
-		if (coin.getCommitmentValue().isPrime(ZEROCOIN_MINT_PRIME_PARAM)
-				&& coin.getCommitmentValue()
-						>= params->accumulatorParams.minCoinValue
-				&& coin.getCommitmentValue()
-						<= params->accumulatorParams.maxCoinValue) {
+		if (isValidCoinValue(coin.getCommitmentValue(), params)) {
 			// Found a valid coin. Store it.
 			this->serialNumber = s;
 			this->randomness = coin.getRandomness();
@@ -160,6 +230,61 @@ void PrivateCoin::mintCoin(const CoinDenomination denomination) {
 			"Unable to mint a new Zerocoin (too many attempts)");
 }
 
+std::vector<PrivateCoin> PrivateCoin::MintCoins(const Params* p, size_t count, CoinDenomination denomination,
+                                                int version, unsigned int nThreads) {
+	if (p->initialized == false) {
+		throw ZerocoinException("Params are not initialized");
+	}
+
+	std::vector<PrivateCoin> coins;
+	if (count == 0) {
+		return coins;
+	}
+	coins.reserve(count);
+
+	if (nThreads == 0) {
+		nThreads = std::max(1U, boost::thread::hardware_concurrency());
+	}
+	nThreads = (unsigned int)std::min<size_t>(nThreads, count);
+
+	// Every thread mints coins the same way as the constructor until all the
+	// coins are claimed. OpenSSL and the secp256k1 context are thread safe here.
+	boost::mutex cs;
+	size_t nClaimed = 0;
+	std::string strError;
+
+	ParallelTasks workers(nThreads);
+	for (unsigned int i = 0; i < nThreads; i++) {
+		workers.Add([&] {
+			try {
+				for (;;) {
+					{
+						boost::lock_guard<boost::mutex> lock(cs);
+						if (nClaimed >= count || !strError.empty()) {
+							return;
+						}
+						nClaimed++;
+					}
+					PrivateCoin coin(p, denomination, version);
+					boost::lock_guard<boost::mutex> lock(cs);
+					coins.push_back(coin);
+				}
+			} catch (const std::exception& e) {
+				boost::lock_guard<boost::mutex> lock(cs);
+				if (strError.empty()) {
+					strError = e.what();
+				}
+			}
+		});
+	}
+	workers.Wait();
+
+	if (!strError.empty()) {
+		throw ZerocoinException(strError);
+	}
+	return coins;
+}
+
 void PrivateCoin::mintCoinFast(const CoinDenomination denomination) {
 	Bignum s;
 
@@ -186,7 +311,8 @@ void PrivateCoin::mintCoinFast(const CoinDenomination denomination) {
 
 	// Manually compute a Pedersen commitment to the serial number "s" under randomness "r"
 	// C = g^s * h^r mod p
-	Bignum commitmentValue = this->params->coinCommitmentGroup.g.pow_mod(s, this->params->coinCommitmentGroup.modulus).mul_mod(this->params->coinCommitmentGroup.h.pow_mod(r, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
+	const IntegerGroupParams &group = this->params->coinCommitmentGroup;
+	Bignum commitmentValue = MultiExp(group.modulus, group.modulusMont).add(group.g, s).add(group.h, r).result();
 
 	// Repeat this process up to MAX_COINMINT_ATTEMPTS times until
 	// we obtain a prime number
@@ -194,9 +320,7 @@ void PrivateCoin::mintCoinFast(const CoinDenomination denomination) {
 		// First verify that the commitment is a prime number
 		// in the appropriate range. If not, we'll throw this coin
 		// away and generate a new one.
-		if (commitmentValue.isPrime(ZEROCOIN_MINT_PRIME_PARAM) &&
-			commitmentValue >= params->accumulatorParams.minCoinValue &&
-			commitmentValue <= params->accumulatorParams.maxCoinValue) {
+		if (isValidCoinValue(commitmentValue, params)) {
 			// Found a valid coin. Store it.
 			this->serialNumber = s;
 			this->randomness = r;
@@ -213,7 +337,7 @@ void PrivateCoin::mintCoinFast(const CoinDenomination denomination) {
 		// r = r + r_delta mod q
 		// C = C * h mod p
 		r = (r + r_delta) % this->params->coinCommitmentGroup.groupOrder;
-		commitmentValue = commitmentValue.mul_mod(this->params->coinCommitmentGroup.h.pow_mod(r_delta, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
+		commitmentValue = commitmentValue.mul_mod(MultiExp(group.modulus, group.modulusMont).add(group.h, r_delta).result(), group.modulus);
 	}
 
 	// We only get here if we did not find a coin within
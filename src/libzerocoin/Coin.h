@@ -97,6 +97,21 @@ public:
         strm >> *this;
     }
     PrivateCoin(const Params* p, CoinDenomination denomination = ZQ_LOVELACE, int version = ZEROCOIN_TX_VERSION_1);
+
+    /**
+     * @brief Mint several coins at once.
+     * @param p             the parameters
+     * @param count         number of coins to mint
+     * @param denomination  the denomination of the coins
+     * @param version       the version of the coins
+     * @param nThreads      threads searching for coins, 0 for one per core
+     * @throws ZerocoinException if the process takes too long
+     *
+     * Same as constructing count coins, but the coins are minted
+     * on several threads.
+     **/
+    static std::vector<PrivateCoin> MintCoins(const Params* p, size_t count, CoinDenomination denomination = ZQ_LOVELACE,
+                                              int version = ZEROCOIN_TX_VERSION_1, unsigned int nThreads = 0);
     const PublicCoin& getPublicCoin() const;
     const Bignum& getSerialNumber() const;
     const Bignum& getRandomness() const;
@@ -0,0 +1,232 @@
+/**
+* @file       MultiExp.cpp
+*
+* @brief      Fixed-base precomputation and simultaneous multi-exponentiation
+*             for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+
+#include "Zerocoin.h"
+
+namespace libzerocoin {
+
+// Window size of the simultaneous exponentiation of bases without a table
+#define MULTIEXP_WINDOW_BITS	4
+
+// Bits [pos, pos + w) of the non-negative e
+static uint32_t getDigit(const Bignum& e, uint32_t pos, uint32_t w) {
+	uint32_t d = 0;
+	for (uint32_t j = 0; j < w; j++) {
+		if (BN_is_bit_set(&e, pos + j)) {
+			d |= 1U << j;
+		}
+	}
+	return d;
+}
+
+// a mod m in [0, m), as BN_mod_exp_mont reduces its base
+static Bignum reduce(const Bignum& a, const Bignum& m) {
+	Bignum r;
+	if (!BN_nnmod(&r, &a, &m, GetThreadBN_CTX())) {
+		throw bignum_error("MultiExp : BN_nnmod failed");
+	}
+	return r;
+}
+
+// r = r * a, or r = a for the first factor, in Montgomery form
+static void mulMont(Bignum& r, bool& fInit, const Bignum& a, BN_MONT_CTX* mont, BN_CTX* ctx) {
+	if (!fInit) {
+		r = a;
+		fInit = true;
+	} else if (!BN_mod_mul_montgomery(&r, &r, &a, mont, ctx)) {
+		throw bignum_error("MultiExp : BN_mod_mul_montgomery failed");
+	}
+}
+
+FixedBaseTable::FixedBaseTable(const Bignum& base, const Bignum& modulus, const Bignum& order,
+                               uint32_t maxBits, uint32_t windowBits, bool fNegative)
+	: base(base), modulus(modulus), order(order), maxBits(maxBits), windowBits(windowBits) {
+	if (windowBits < 1 || windowBits > 16 || !BN_is_odd(&modulus)) {
+		throw ZerocoinException("Invalid fixed-base table parameters");
+	}
+
+	CBigNumMontCtx montCtx;
+	BN_MONT_CTX* mont = montCtx.Get(this->modulus);
+	BN_CTX* ctx = GetThreadBN_CTX();
+
+	// Exponents are only reduced by an order that is really the order of the base
+	if (this->order != Bignum(0) && !this->base.pow_mod_mont(this->order, this->modulus, montCtx).isOne()) {
+		this->order = Bignum(0);
+	}
+	if (this->order != Bignum(0)) {
+		this->maxBits = this->order.bitSize();
+	}
+	this->nDigits = (this->maxBits + windowBits - 1) / windowBits;
+
+	build(mont, ctx);
+
+	if (fNegative && this->order == Bignum(0)) {
+		inverse.reset(new FixedBaseTable(base.inverse(modulus), modulus, Bignum(0), maxBits, windowBits));
+	}
+}
+
+void FixedBaseTable::build(BN_MONT_CTX* mont, BN_CTX* ctx) {
+	const uint32_t nEntries = (1U << windowBits) - 1;
+	entries.resize((size_t)nDigits * nEntries);
+
+	// cur = base^(2^(w*i)) for digit position i
+	Bignum cur = reduce(base, modulus);
+	if (!BN_to_montgomery(&cur, &cur, mont, ctx)) {
+		throw bignum_error("FixedBaseTable : BN_to_montgomery failed");
+	}
+
+	for (uint32_t i = 0; i < nDigits; i++) {
+		Bignum* row = std::addressof(entries[(size_t)i * nEntries]);
+		row[0] = cur;
+		for (uint32_t d = 1; d < nEntries; d++) {
+			if (!BN_mod_mul_montgomery(&row[d], &row[d - 1], &cur, mont, ctx)) {
+				throw bignum_error("FixedBaseTable : BN_mod_mul_montgomery failed");
+			}
+		}
+		if (i + 1 < nDigits && !BN_mod_mul_montgomery(&cur, &row[nEntries - 1], &cur, mont, ctx)) {
+			throw bignum_error("FixedBaseTable : BN_mod_mul_montgomery failed");
+		}
+	}
+}
+
+bool FixedBaseTable::mulPow(Bignum& r, bool& fInit, const Bignum& e, BN_MONT_CTX* mont, BN_CTX* ctx) const {
+	if (order != Bignum(0)) {
+		return mulPowNonNegative(r, fInit, reduce(e, order), mont, ctx);
+	}
+	if (e < Bignum(0)) {
+		return inverse && inverse->mulPowNonNegative(r, fInit, Bignum(0) - e, mont, ctx);
+	}
+	return mulPowNonNegative(r, fInit, e, mont, ctx);
+}
+
+bool FixedBaseTable::mulPowNonNegative(Bignum& r, bool& fInit, const Bignum& e, BN_MONT_CTX* mont, BN_CTX* ctx) const {
+	if ((uint32_t)e.bitSize() > maxBits) {
+		return false;
+	}
+
+	const uint32_t nEntries = (1U << windowBits) - 1;
+	for (uint32_t i = 0; i < nDigits; i++) {
+		uint32_t d = getDigit(e, i * windowBits, windowBits);
+		if (d != 0) {
+			mulMont(r, fInit, entries[(size_t)i * nEntries + d - 1], mont, ctx);
+		}
+	}
+	return true;
+}
+
+size_t FixedBaseTable::getMemoryUsage() const {
+	return EstimateMemoryUsage(modulus.bitSize(), maxBits, windowBits, false) + (inverse ? inverse->getMemoryUsage() : 0);
+}
+
+size_t FixedBaseTable::EstimateMemoryUsage(uint32_t modulusBits, uint32_t maxBits, uint32_t windowBits, bool fNegative) {
+	// CBigNum, BIGNUM struct and limbs, with the allocator overhead of both
+	const size_t entrySize = sizeof(Bignum) + 3 * sizeof(void*) + 2 * 16 + ((modulusBits + 63) / 64) * 8;
+	const size_t nDigits = (maxBits + windowBits - 1) / windowBits;
+	return nDigits * ((1U << windowBits) - 1) * entrySize * (fNegative ? 2 : 1);
+}
+
+MultiExp::MultiExp(const Bignum& modulus, const CBigNumMontCtx& mont) : modulus(modulus), mont(mont) {}
+
+MultiExp& MultiExp::add(const Bignum& base, const Bignum& e, const FixedBaseTable* table) {
+	// A table for another base or modulus is of no use
+	if (table != NULL && (table->getModulus() != modulus || table->getBase() != base)) {
+		table = NULL;
+	}
+	Term term;
+	term.base = base;
+	term.exponent = e;
+	term.table = table;
+	terms.push_back(term);
+	return *this;
+}
+
+Bignum MultiExp::result() const {
+	BN_MONT_CTX* pmont = mont.Get(modulus);
+	if (pmont == NULL) {
+		Bignum r = 1;
+		for (const Term& term : terms) {
+			r = r.mul_mod(term.base.pow_mod(term.exponent, modulus), modulus);
+		}
+		return r;
+	}
+	BN_CTX* ctx = GetThreadBN_CTX();
+
+	Bignum r;
+	bool fInit = false;
+	std::vector<const Term*> variable;
+	for (const Term& term : terms) {
+		if (term.table == NULL || !term.table->mulPow(r, fInit, term.exponent, pmont, ctx)) {
+			variable.push_back(&term);
+		}
+	}
+
+	if (variable.size() == 1) {
+		Bignum p = variable[0]->base.pow_mod_mont(variable[0]->exponent, modulus, mont);
+		if (!BN_to_montgomery(&p, &p, pmont, ctx)) {
+			throw bignum_error("MultiExp : BN_to_montgomery failed");
+		}
+		mulMont(r, fInit, p, pmont, ctx);
+	} else if (variable.size() > 1) {
+		// Straus: the digits of all the exponents are processed together, top down,
+		// so the squarings are shared by all the bases
+		const uint32_t w = MULTIEXP_WINDOW_BITS;
+		const uint32_t nEntries = (1U << w) - 1;
+		std::vector<Bignum> exponents(variable.size());
+		std::vector<Bignum> powers(variable.size() * nEntries);
+		uint32_t maxBits = 0;
+		for (size_t k = 0; k < variable.size(); k++) {
+			// g^-x = (g^-1)^x
+			Bignum b = variable[k]->exponent < Bignum(0) ? variable[k]->base.inverse(modulus) : reduce(variable[k]->base, modulus);
+			exponents[k] = variable[k]->exponent < Bignum(0) ? Bignum(0) - variable[k]->exponent : variable[k]->exponent;
+			maxBits = std::max(maxBits, (uint32_t)exponents[k].bitSize());
+
+			Bignum* row = std::addressof(powers[k * nEntries]);
+			if (!BN_to_montgomery(&row[0], &b, pmont, ctx)) {
+				throw bignum_error("MultiExp : BN_to_montgomery failed");
+			}
+			for (uint32_t d = 1; d < nEntries; d++) {
+				if (!BN_mod_mul_montgomery(&row[d], &row[d - 1], &row[0], pmont, ctx)) {
+					throw bignum_error("MultiExp : BN_mod_mul_montgomery failed");
+				}
+			}
+		}
+
+		Bignum acc;
+		bool fAccInit = false;
+		for (uint32_t i = (maxBits + w - 1) / w; i-- > 0; ) {
+			if (fAccInit) {
+				for (uint32_t j = 0; j < w; j++) {
+					if (!BN_mod_mul_montgomery(&acc, &acc, &acc, pmont, ctx)) {
+						throw bignum_error("MultiExp : BN_mod_mul_montgomery failed");
+					}
+				}
+			}
+			for (size_t k = 0; k < variable.size(); k++) {
+				uint32_t d = getDigit(exponents[k], i * w, w);
+				if (d != 0) {
+					mulMont(acc, fAccInit, powers[k * nEntries + d - 1], pmont, ctx);
+				}
+			}
+		}
+		if (fAccInit) {
+			mulMont(r, fInit, acc, pmont, ctx);
+		}
+	}
+
+	if (!fInit) {
+		// Empty product, or only zero exponents
+		return Bignum(1) % modulus;
+	}
+	if (!BN_from_montgomery(&r, &r, pmont, ctx)) {
+		throw bignum_error("MultiExp : BN_from_montgomery failed");
+	}
+	return r;
+}
+
+} /* namespace libzerocoin */
@@ -0,0 +1,111 @@
+/**
+* @file       MultiExp.h
+*
+* @brief      Fixed-base precomputation and simultaneous multi-exponentiation
+*             for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+#ifndef MULTIEXP_H_
+#define MULTIEXP_H_
+
+#include <memory>
+#include <vector>
+
+namespace libzerocoin {
+
+/**
+ * Precomputed powers of a fixed base: with w-bit digits the table holds
+ * base^(d * 2^(w*i)) for every digit d and digit position i, in Montgomery
+ * form. A power is then a product of one table entry per nonzero digit of
+ * the exponent, with no squarings.
+ *
+ * If the order of the base is known exponents are reduced modulo the order,
+ * otherwise negative exponents need the table of the inverse (fNegative).
+ * The table is immutable once built and can be shared between threads.
+ * Which entries are read depends on the exponent, so it is only meant for
+ * public exponents, as in proof verification.
+ */
+class FixedBaseTable {
+public:
+	/**
+	 * @param base         the fixed base
+	 * @param modulus      odd modulus
+	 * @param order        order of base modulo modulus, or 0 if unknown. Checked.
+	 * @param maxBits      largest exponent size covered, when the order is unknown
+	 * @param windowBits   bits per digit, 1 to 16
+	 * @param fNegative    also build the table of the inverse, for negative exponents
+	 */
+	FixedBaseTable(const Bignum& base, const Bignum& modulus, const Bignum& order,
+	               uint32_t maxBits, uint32_t windowBits, bool fNegative = false);
+
+	/**
+	 * Multiplies r, in Montgomery form, by base^e. If fInit is false r is set
+	 * instead and fInit becomes true.
+	 * @return false if the exponent is out of the range of the table
+	 */
+	bool mulPow(Bignum& r, bool& fInit, const Bignum& e, BN_MONT_CTX* mont, BN_CTX* ctx) const;
+
+	const Bignum& getBase() const { return base; }
+	const Bignum& getModulus() const { return modulus; }
+	uint32_t getWindowBits() const { return windowBits; }
+
+	//! Approximate heap memory used by the table
+	size_t getMemoryUsage() const;
+
+	//! Approximate heap memory of a table with these dimensions
+	static size_t EstimateMemoryUsage(uint32_t modulusBits, uint32_t maxBits, uint32_t windowBits, bool fNegative);
+
+private:
+	Bignum base;
+	Bignum modulus;
+	Bignum order;
+	uint32_t maxBits;
+	uint32_t windowBits;
+	uint32_t nDigits;
+	// entries[i * (2^w - 1) + d - 1] = base^(d * 2^(w*i)) * R mod modulus
+	std::vector<Bignum> entries;
+	std::unique_ptr<FixedBaseTable> inverse;
+
+	void build(BN_MONT_CTX* mont, BN_CTX* ctx);
+	bool mulPowNonNegative(Bignum& r, bool& fInit, const Bignum& e, BN_MONT_CTX* mont, BN_CTX* ctx) const;
+};
+
+/**
+ * Product of powers b_1^e_1 * ... * b_n^e_n mod m. Powers of bases with a
+ * FixedBaseTable are looked up in the table, the others are computed by
+ * simultaneous (Straus) exponentiation sharing a single chain of squarings.
+ * Same result as multiplying the pow_mod of every term. Negative exponents
+ * are allowed, as in pow_mod.
+ *
+ * Usage: MultiExp(p, pMont).add(g, x, gTable).add(h, y, hTable).result()
+ */
+class MultiExp {
+public:
+	MultiExp(const Bignum& modulus, const CBigNumMontCtx& mont);
+
+	/**
+	 * @param table precomputed powers of base modulo the same modulus, or NULL
+	 */
+	MultiExp& add(const Bignum& base, const Bignum& e, const FixedBaseTable* table = NULL);
+	MultiExp& add(const Bignum& base, const Bignum& e, const std::shared_ptr<const FixedBaseTable>& table) {
+		return add(base, e, table.get());
+	}
+
+	Bignum result() const;
+
+private:
+	struct Term {
+		Bignum base;
+		Bignum exponent;
+		const FixedBaseTable* table;
+	};
+
+	const Bignum& modulus;
+	const CBigNumMontCtx& mont;
+	std::vector<Term> terms;
+};
+
+} /* namespace libzerocoin */
+
+#endif /* MULTIEXP_H_ */
@@ -13,7 +13,7 @@
 
 namespace libzerocoin {
 
-Params::Params(CBigNum N, uint32_t securityLevel) {
+Params::Params(CBigNum N, uint32_t securityLevel, size_t maxPrecomputeSize) {
 	this->zkp_hash_len = securityLevel;
 	this->zkp_iterations = securityLevel;
 
@@ -25,6 +25,65 @@ Params::Params(CBigNum N, uint32_t securityLevel) {
 
 	this->accumulatorParams.initialized = true;
 	this->initialized = true;
+
+	precompute(maxPrecomputeSize);
+}
+
+size_t Params::precompute(size_t maxSize) {
+	struct Candidate {
+		IntegerGroupParams *group;
+		const Bignum *modulus;
+		Bignum order;
+		uint32_t maxBits;
+		bool fNegative;
+		uint32_t windowBits;
+
+		size_t size() const {
+			return windowBits == 0 ? 0 : 2 * FixedBaseTable::EstimateMemoryUsage(modulus->bitSize(), maxBits, windowBits, fNegative);
+		}
+	};
+
+	// The order of the QRN generators is unknown, so their exponents are not reduced and
+	// can be negative. The largest ones in the accumulator proof are c * r_2 * e with
+	// r_2 < N/4 and e < maxCoinValue.
+	uint32_t qrnMaxBits = accumulatorParams.accumulatorModulus.bitSize() + accumulatorParams.maxCoinValue.bitSize() + HASH_OUTPUT_BITS;
+	Candidate candidates[] = {
+		{&coinCommitmentGroup, std::addressof(coinCommitmentGroup.modulus), coinCommitmentGroup.groupOrder, (uint32_t)coinCommitmentGroup.groupOrder.bitSize(), false, 8},
+		{&serialNumberSoKCommitmentGroup, std::addressof(serialNumberSoKCommitmentGroup.modulus), serialNumberSoKCommitmentGroup.groupOrder, (uint32_t)serialNumberSoKCommitmentGroup.groupOrder.bitSize(), false, 8},
+		{&accumulatorParams.accumulatorPoKCommitmentGroup, std::addressof(accumulatorParams.accumulatorPoKCommitmentGroup.modulus), accumulatorParams.accumulatorPoKCommitmentGroup.groupOrder, (uint32_t)accumulatorParams.accumulatorPoKCommitmentGroup.groupOrder.bitSize(), false, 8},
+		{&accumulatorParams.accumulatorQRNCommitmentGroup, std::addressof(accumulatorParams.accumulatorModulus), Bignum(0), qrnMaxBits, true, 8},
+	};
+	const size_t nCandidates = sizeof(candidates) / sizeof(candidates[0]);
+
+	// Narrow the window of the largest tables until everything fits
+	for (;;) {
+		size_t total = 0;
+		Candidate *largest = NULL;
+		for (size_t i = 0; i < nCandidates; i++) {
+			total += candidates[i].size();
+			if (candidates[i].windowBits != 0 && (largest == NULL || candidates[i].size() > largest->size())) {
+				largest = &candidates[i];
+			}
+		}
+		if (total <= maxSize || largest == NULL) {
+			break;
+		}
+		largest->windowBits = largest->windowBits > 2 ? largest->windowBits - 1 : 0;
+	}
+
+	size_t total = 0;
+	for (size_t i = 0; i < nCandidates; i++) {
+		Candidate &c = candidates[i];
+		c.group->gTable.reset();
+		c.group->hTable.reset();
+		if (c.windowBits == 0) {
+			continue;
+		}
+		c.group->gTable = std::make_shared<FixedBaseTable>(c.group->g, *c.modulus, c.order, c.maxBits, c.windowBits, c.fNegative);
+		c.group->hTable = std::make_shared<FixedBaseTable>(c.group->h, *c.modulus, c.order, c.maxBits, c.windowBits, c.fNegative);
+		total += c.group->gTable->getMemoryUsage() + c.group->hTable->getMemoryUsage();
+	}
+	return total;
 }
 
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
@@ -39,7 +98,7 @@ Bignum IntegerGroupParams::randomElement() const {
 	// The generator of the group raised
 	// to a random number less than the order of the group
 	// provides us with a uniformly distributed random number.
-	return this->g.pow_mod(Bignum::randBignum(this->groupOrder),this->modulus);
+	return MultiExp(this->modulus, this->modulusMont).add(this->g, Bignum::randBignum(this->groupOrder)).result();
 }
 
 } /* namespace libzerocoin */
@@ -52,6 +52,22 @@ public:
 	 */
     CBigNum groupOrder;
 
+	/**
+	 * Montgomery contexts for modulus and groupOrder,
+	 * for use with CBigNum::pow_mod_mont. Not serialized.
+	 */
+	CBigNumMontCtx modulusMont;
+	CBigNumMontCtx groupOrderMont;
+
+	/**
+	 * Precomputed powers of g and h for use with MultiExp when
+	 * verifying, NULL if not precomputed. Not serialized.
+	 * The entries looked up depend on the digits of the exponent,
+	 * so they must not be used with secret exponents.
+	 */
+	std::shared_ptr<const FixedBaseTable> gTable;
+	std::shared_ptr<const FixedBaseTable> hTable;
+
 	ADD_SERIALIZE_METHODS;
 
 	template <typename Stream, typename Operation>
@@ -95,6 +111,12 @@ public:
 	 */
     CBigNum accumulatorModulus;
 
+	/**
+	 * Montgomery context for accumulatorModulus,
+	 * for use with CBigNum::pow_mod_mont. Not serialized.
+	 */
+	CBigNumMontCtx accumulatorModulusMont;
+
 	/**
 	 * The initial value for the accumulator
 	 * A random Quadratic residue mod n thats not 1
@@ -171,8 +193,12 @@ public:
 	* be known to any party, or the security of Zerocoin is
 	* compromised. The integer "N" must be a MINIMUM of 1024
 	* in length. 3072 bits is strongly recommended.
+	*
+	* Fixed-base tables for the group generators are precomputed
+	* using at most maxPrecomputeSize bytes, see precompute().
 	**/
-    Params(CBigNum accumulatorModulus, uint32_t securityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL);
+    Params(CBigNum accumulatorModulus, uint32_t securityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL,
+           size_t maxPrecomputeSize = ZEROCOIN_DEFAULT_PRECOMPUTE_SIZE);
 
 	bool initialized;
 
@@ -204,6 +230,16 @@ public:
 	 */
 	uint32_t zkp_hash_len;
 
+	/**
+	 * Builds the fixed-base tables of the generators of all the
+	 * groups within a memory budget of maxSize bytes. The windows
+	 * of the largest tables are narrowed until everything fits,
+	 * maxSize 0 removes the tables. Must not be called while the
+	 * parameters are in use by other threads.
+	 * @return the memory used by the tables
+	 */
+	size_t precompute(size_t maxSize);
+
 	ADD_SERIALIZE_METHODS;
 
 	template <typename Stream, typename Operation>
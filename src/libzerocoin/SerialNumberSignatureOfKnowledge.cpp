@@ -15,6 +15,11 @@
 
 namespace libzerocoin {
 
+// Zero challenge bits needed before Verify builds a table for the commitment,
+// and the window of that table
+#define SOK_COMMITMENT_TABLE_MIN_USES		8
+#define SOK_COMMITMENT_TABLE_WINDOW_BITS	4
+
 SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params* p): params(p) { }
 
 SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params* p, const PrivateCoin& coin, const Commitment& commitmentToCoin, uint256 msghash)
@@ -61,7 +66,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 	for(uint32_t i=0; i < params->zkp_iterations; i++) {
 		// compute g^{ {a^x b^r} h^v} mod p2
         challenges.Add([this, i, &coin, &c, &r, &v] {
-            c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i]);
+            c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i], false);
         });
 	}
     challenges.Wait();
@@ -88,7 +93,8 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
             challenges.Add([this, i, &r, &v, &b, &commitmentToCoin, &coin] {
                 s_notprime[i]   = r[i] - coin.getRandomness();
                 sprime[i]       = v[i] - (commitmentToCoin.getRandomness() *
-			                              b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
+			                              MultiExp(params->serialNumberSoKCommitmentGroup.groupOrder, params->serialNumberSoKCommitmentGroup.groupOrderMont)
+			                                  .add(b, r[i] - coin.getRandomness()).result());
             });
 		}
     }
@@ -96,17 +102,23 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 }
 
 inline Bignum SerialNumberSignatureOfKnowledge::challengeCalculation(const Bignum& a_exp,const Bignum& b_exp,
-        const Bignum& h_exp) const {
+        const Bignum& h_exp, bool fPublic) const {
 
 	Bignum a = params->coinCommitmentGroup.g;
 	Bignum b = params->coinCommitmentGroup.h;
 	Bignum g = params->serialNumberSoKCommitmentGroup.g;
 	Bignum h = params->serialNumberSoKCommitmentGroup.h;
 
-	Bignum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+	// a and b live in the group of order serialNumberSoKCommitmentGroup.groupOrder,
+	// the modulus of their own precomputed tables. The prover's exponents are
+	// secret and must not select table entries.
+	const IntegerGroupParams &sok = params->serialNumberSoKCommitmentGroup;
+	const IntegerGroupParams &coinGroup = params->coinCommitmentGroup;
+	Bignum exponent = MultiExp(sok.groupOrder, sok.groupOrderMont).add(a, a_exp, fPublic ? coinGroup.gTable.get() : NULL)
+	                  .add(b, b_exp, fPublic ? coinGroup.hTable.get() : NULL).result();
 
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	return MultiExp(sok.modulus, sok.modulusMont).add(g, exponent, fPublic ? sok.gTable.get() : NULL)
+	       .add(h, h_exp, fPublic ? sok.hTable.get() : NULL).result();
 }
 
 bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,
@@ -133,20 +145,34 @@ bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, co
 	vector<CBigNum> tprime(params->zkp_iterations);
 	unsigned char *hashbytes = (unsigned char*) &this->hash;
 
+	// Every zero challenge bit raises the commitment to a fresh exponent, and
+	// once there are enough of them a table of its powers pays for itself
+	const IntegerGroupParams &sok = params->serialNumberSoKCommitmentGroup;
+	uint32_t zeroBits = 0;
+	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+		if (!((hashbytes[i / 8] >> (i % 8)) & 0x01)) {
+			zeroBits++;
+		}
+	}
+	std::unique_ptr<FixedBaseTable> commitmentTable;
+	if (zeroBits >= SOK_COMMITMENT_TABLE_MIN_USES && BN_is_odd(&sok.modulus)) {
+		commitmentTable.reset(new FixedBaseTable(valueOfCommitmentToCoin, sok.modulus, Bignum(0),
+		                                         sok.groupOrder.bitSize(), SOK_COMMITMENT_TABLE_WINDOW_BITS));
+	}
+
     ParallelTasks challenges(params->zkp_iterations);
 
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
-        challenges.Add([this, i, hashbytes, &b, &h, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin] {
+        challenges.Add([this, i, hashbytes, &b, &h, &sok, &commitmentTable, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin] {
             int bit = i % 8;
             int byte = i / 8;
             bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
             if(challenge_bit) {
-                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
+                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i], true);
             } else {
-                Bignum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-                tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-                             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
-                            params->serialNumberSoKCommitmentGroup.modulus;
+                Bignum exp = MultiExp(sok.groupOrder, sok.groupOrderMont).add(b, s_notprime[i], params->coinCommitmentGroup.hTable).result();
+                tprime[i] = MultiExp(sok.modulus, sok.modulusMont).add(valueOfCommitmentToCoin, exp, commitmentTable.get())
+                            .add(h, sprime[i], sok.hTable).result();
             }
         });
 	}
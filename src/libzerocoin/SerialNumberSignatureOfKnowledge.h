@@ -70,7 +70,7 @@ private:
 	vector<Bignum> s_notprime;
 	vector<Bignum> sprime;
 	inline Bignum challengeCalculation(const Bignum& a_exp, const Bignum& b_exp,
-	                                   const Bignum& h_exp) const;
+	                                   const Bignum& h_exp, bool fPublic) const;
 };
 
 } /* namespace libzerocoin */
@@ -17,7 +17,9 @@ using namespace std;
 #include <fstream>
 #include <curses.h>
 #include <exception>
+#include <cmath>
 #include "Zerocoin.h"
+#include "../streams.h"
 
 using namespace libzerocoin;
 
@@ -233,6 +235,37 @@ Test_Accumulator()
 			return false;
 		}
 
+		// Batch accumulation gives the same results
+		vector<PublicCoin> pubCoins;
+		for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+			pubCoins.push_back(gCoins[i]->getPublicCoin());
+		}
+		Accumulator accBatch(&g_Params->accumulatorParams);
+		AccumulatorWitness wBatch(g_Params, accBatch, gCoins[0]->getPublicCoin());
+		accBatch.accumulateMany(pubCoins);
+		wBatch.AddElements(pubCoins);
+		if (accBatch.getValue() != accOne.getValue() || wBatch.getValue() != wThree.getValue()) {
+			cout << "Batch accumulation doesn't match" << endl;
+			return false;
+		}
+
+		// An empty batch changes nothing
+		accBatch.accumulateMany(vector<PublicCoin>());
+		if (accBatch.getValue() != accOne.getValue()) {
+			return false;
+		}
+
+		// A coin of another denomination rejects the whole batch
+		Accumulator accOther(&g_Params->accumulatorParams, ZQ_GOLDWASSER);
+		try {
+			accOther.accumulateMany(pubCoins);
+			return false;
+		} catch (ZerocoinException &e) {
+		}
+		if (accOther.getValue() != g_Params->accumulatorParams.accumulatorBase) {
+			return false;
+		}
+
 		// Serialization test: see if we can serialize the accumulator
 		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
 		ss << accOne;
@@ -309,6 +342,142 @@ Test_EqualityPoK()
 	return true;
 }
 
+// g^e1 * h^e2 through MultiExp with and without the tables of the group,
+// compared with pow_mod
+static bool
+CheckMultiExp(const IntegerGroupParams &group, const Bignum &modulus, const CBigNumMontCtx &mont,
+              const Bignum &e1, const Bignum &e2)
+{
+	Bignum expected = group.g.pow_mod(e1, modulus).mul_mod(group.h.pow_mod(e2, modulus), modulus);
+
+	return MultiExp(modulus, mont).add(group.g, e1, group.gTable).add(group.h, e2, group.hTable).result() == expected &&
+	       MultiExp(modulus, mont).add(group.g, e1).add(group.h, e2).result() == expected &&
+	       MultiExp(modulus, mont).add(group.g, e1, group.gTable).result() == group.g.pow_mod(e1, modulus) &&
+	       MultiExp(modulus, mont).add(group.h, e2).result() == group.h.pow_mod(e2, modulus);
+}
+
+static bool
+CheckAllGroups(const Params *params)
+{
+	const IntegerGroupParams *groups[] = {
+		&params->coinCommitmentGroup,
+		&params->serialNumberSoKCommitmentGroup,
+		&params->accumulatorParams.accumulatorPoKCommitmentGroup
+	};
+	for (const IntegerGroupParams *group : groups) {
+		Bignum large = Bignum(2).pow(group->modulus.bitSize() + 100);
+		Bignum exponents[] = {
+			Bignum(0), Bignum(1), group->groupOrder, group->groupOrder - Bignum(1),
+			Bignum::randBignum(group->groupOrder), Bignum(0) - Bignum::randBignum(group->groupOrder),
+			Bignum::randBignum(large), Bignum(0) - Bignum::randBignum(large)
+		};
+		for (const Bignum &e1 : exponents) {
+			if (!CheckMultiExp(*group, group->modulus, group->modulusMont, e1, Bignum::randBignum(group->groupOrder)) ||
+			    !CheckMultiExp(*group, group->modulus, group->modulusMont, Bignum::randBignum(group->groupOrder), e1)) {
+				return false;
+			}
+		}
+	}
+
+	// The order of the QRN group is unknown, the tables cover exponents
+	// up to a size and negative exponents through the inverse
+	const IntegerGroupParams &qrn = params->accumulatorParams.accumulatorQRNCommitmentGroup;
+	const Bignum &N = params->accumulatorParams.accumulatorModulus;
+	Bignum inRange = Bignum(2).pow(N.bitSize() + 256);
+	Bignum outOfRange = Bignum(2).pow(2 * N.bitSize() + 512);
+	Bignum exponents[] = {
+		Bignum(0), Bignum::randBignum(inRange), Bignum(0) - Bignum::randBignum(inRange),
+		Bignum::randBignum(outOfRange), Bignum(0) - Bignum::randBignum(outOfRange)
+	};
+	for (const Bignum &e1 : exponents) {
+		if (!CheckMultiExp(qrn, N, params->accumulatorParams.accumulatorModulusMont, e1, Bignum::randBignum(inRange))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+Test_MultiExp()
+{
+	try {
+		if (!CheckAllGroups(g_Params)) {
+			return false;
+		}
+
+		// Straus over bases without tables, with mixed signs
+		const IntegerGroupParams &group = g_Params->serialNumberSoKCommitmentGroup;
+		Bignum expected = 1;
+		MultiExp product(group.modulus, group.modulusMont);
+		for (uint32_t i = 0; i < 5; i++) {
+			Bignum base = group.randomElement();
+			Bignum e = Bignum::randBignum(group.groupOrder);
+			if (i % 2) {
+				e = Bignum(0) - e;
+			}
+			product.add(base, e);
+			expected = expected.mul_mod(base.pow_mod(e, group.modulus), group.modulus);
+		}
+		if (product.result() != expected) {
+			return false;
+		}
+
+		// Small tables built directly, for every window size
+		for (uint32_t w = 1; w <= 8; w++) {
+			FixedBaseTable table(group.g, group.modulus, Bignum(0), 300, w, true);
+			Bignum e = Bignum::randBignum(Bignum(2).pow(300));
+			Bignum r;
+			bool fInit = false;
+			if (!table.mulPow(r, fInit, e, group.modulusMont.Get(group.modulus), GetThreadBN_CTX()) ||
+			    MultiExp(group.modulus, group.modulusMont).add(group.g, Bignum(0) - e, &table).result() != group.g.pow_mod(Bignum(0) - e, group.modulus) ||
+			    table.mulPow(r, fInit, Bignum(2).pow(301), group.modulusMont.Get(group.modulus), GetThreadBN_CTX())) {
+				return false;
+			}
+		}
+	} catch (runtime_error &e) {
+		return false;
+	}
+
+	return true;
+}
+
+bool
+Test_PrecomputeBudget()
+{
+	try {
+		Params params(*g_Params);
+
+		// No tables at all
+		if (params.precompute(0) != 0 || params.coinCommitmentGroup.gTable || !CheckAllGroups(&params)) {
+			return false;
+		}
+
+		// A budget too small for all the tables at their widest windows
+		size_t budget = 4 * 1024 * 1024;
+		if (params.precompute(budget) > budget || !params.coinCommitmentGroup.gTable || !CheckAllGroups(&params)) {
+			return false;
+		}
+
+		// Proofs made with one set of tables verify with another
+		Bignum val = Bignum::randBignum(params.coinCommitmentGroup.groupOrder);
+		Commitment one(&params.accumulatorParams.accumulatorPoKCommitmentGroup, val);
+		Commitment two(&params.serialNumberSoKCommitmentGroup, val);
+		CommitmentProofOfKnowledge pok(&params.accumulatorParams.accumulatorPoKCommitmentGroup,
+		                               &params.serialNumberSoKCommitmentGroup, one, two);
+		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+		ss << pok;
+		CommitmentProofOfKnowledge newPok(&g_Params->accumulatorParams.accumulatorPoKCommitmentGroup,
+		                                  &g_Params->serialNumberSoKCommitmentGroup, ss);
+		if (!newPok.Verify(one.getCommitmentValue(), two.getCommitmentValue())) {
+			return false;
+		}
+	} catch (runtime_error &e) {
+		return false;
+	}
+
+	return true;
+}
+
 bool
 Test_MintCoin()
 {
@@ -334,6 +503,41 @@ Test_MintCoin()
 	return true;
 }
 
+bool
+Test_MintCoins()
+{
+	try {
+		// Coins minted on several threads must be distinct valid coins of the right kind
+		vector<PrivateCoin> coins = PrivateCoin::MintCoins(g_Params, 6, ZQ_PEDERSEN, ZEROCOIN_TX_VERSION_2, 3);
+		if (coins.size() != 6) {
+			return false;
+		}
+		for (size_t i = 0; i < coins.size(); i++) {
+			const PublicCoin& pc = coins[i].getPublicCoin();
+			if (!pc.validate() || pc.getDenomination() != ZQ_PEDERSEN || coins[i].getVersion() != ZEROCOIN_TX_VERSION_2) {
+				return false;
+			}
+			const IntegerGroupParams& group = g_Params->coinCommitmentGroup;
+			if (group.g.pow_mod(coins[i].getSerialNumber(), group.modulus).mul_mod(group.h.pow_mod(coins[i].getRandomness(), group.modulus), group.modulus) != pc.getValue()) {
+				return false;
+			}
+			for (size_t j = 0; j < i; j++) {
+				if (coins[j].getPublicCoin() == pc || coins[j].getSerialNumber() == coins[i].getSerialNumber()) {
+					return false;
+				}
+			}
+		}
+
+		if (!PrivateCoin::MintCoins(g_Params, 0).empty()) {
+			return false;
+		}
+	} catch (exception &e) {
+		return false;
+	}
+
+	return true;
+}
+
 bool Test_InvalidCoin()
 {
 	Bignum coinValue;
@@ -407,12 +611,8 @@ Test_MintAndSpend()
 		}
 
 		// Now spend the coin
-		SpendMetaData m(1,1);
-		CDataStream cc(SER_NETWORK, PROTOCOL_VERSION);
-		cc << *gCoins[0];
-		PrivateCoin myCoin(g_Params,cc);
-
-		CoinSpend spend(g_Params, myCoin, acc, wAcc, m);
+		SpendMetaData m(1, uint256());
+		CoinSpend spend(g_Params, *(gCoins[0]), acc, wAcc, m);
 
 		// Serialize the proof and deserialize into newSpend
 		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
@@ -453,10 +653,13 @@ Test_RunAllTests()
 	LogTestResult("group/field parameters can be generated", Test_GenerateGroupParams);
 	LogTestResult("parameter generation is correct", Test_ParamGen);
 	LogTestResult("coins can be minted", Test_MintCoin);
+	LogTestResult("coins can be minted on several threads", Test_MintCoins);
 	LogTestResult("invalid coins will be rejected", Test_InvalidCoin);
 	LogTestResult("the accumulator works", Test_Accumulator);
 	LogTestResult("the commitment equality PoK works", Test_EqualityPoK);
 	LogTestResult("a minted coin can be spent", Test_MintAndSpend);
+	LogTestResult("multi-exponentiation matches pow_mod", Test_MultiExp);
+	LogTestResult("precomputation respects its memory budget", Test_PrecomputeBudget);
 
 	cout << endl << "Average coin size is " << gCoinSize << " bytes." << endl;
 	cout << "Serial number size is " << gSerialNumberSize << " bytes." << endl;
@@ -23,6 +23,8 @@
 #define ZEROCOIN_MAX_SECURITY_LEVEL         80
 #define ACCPROOF_KPRIME                     160
 #define ACCPROOF_KDPRIME                    128
+#define ZEROCOIN_DEFAULT_PRECOMPUTE_SIZE    (32 * 1024 * 1024)
+#define ACCUMULATOR_BATCH_SIZE              64
 #define MAX_COINMINT_ATTEMPTS               10000
 #define ZEROCOIN_MINT_PRIME_PARAM			20
 #define ZEROCOIN_VERSION_STRING             "0.11"
@@ -63,6 +65,7 @@ namespace libzerocoin {
 #include "../serialize.h"
 #include "bitcoin_bignum/bignum.h"
 #include "../hash.h"
+#include "MultiExp.h"
 #include "Params.h"
 #include "Coin.h"
 #include "Commitment.h"
@@ -5,10 +5,13 @@
 #ifndef BITCOIN_BIGNUM_H
 #define BITCOIN_BIGNUM_H
 
+#include <atomic>
 #include <stdexcept>
 #include <vector>
 #include <openssl/bn.h>
 
+#include <boost/thread/tss.hpp>
+
 #include "../../uint256.h" // for uint64
 #include "../../arith_uint256.h"
 #include "../../version.h"
@@ -48,6 +51,47 @@ public:
 };
 
 
+/**
+ * BN_CTX of the calling thread, kept for the lifetime of the thread so that hot paths
+ * don't allocate a fresh context per operation. Must not be used across threads.
+ */
+inline BN_CTX* GetThreadBN_CTX()
+{
+    static boost::thread_specific_ptr<CAutoBN_CTX> threadCtx;
+    CAutoBN_CTX* pctx = threadCtx.get();
+    if (pctx == NULL) {
+        pctx = new CAutoBN_CTX();
+        threadCtx.reset(pctx);
+    }
+    return *pctx;
+}
+
+class CBigNum;
+
+/**
+ * Montgomery parameters of a fixed odd modulus, computed on first use and then shared
+ * by all threads. Owned by the object holding the modulus (see libzerocoin::Params);
+ * copies start out empty. If it is used with a different modulus than the one it was
+ * built for, CBigNum::pow_mod_mont falls back to plain BN_mod_exp.
+ */
+class CBigNumMontCtx
+{
+private:
+    struct CEntry;
+    mutable std::atomic<CEntry*> pentry;
+
+public:
+    CBigNumMontCtx() : pentry(NULL) {}
+    CBigNumMontCtx(const CBigNumMontCtx&) : pentry(NULL) {}
+    CBigNumMontCtx& operator=(const CBigNumMontCtx&) { Reset(); return *this; }
+    ~CBigNumMontCtx() { Reset(); }
+
+    //! Montgomery context for modulus m, or NULL if it can't be used for m
+    inline BN_MONT_CTX* Get(const CBigNum& m) const;
+    inline void Reset();
+};
+
+
 /** C++ wrapper for BIGNUM (OpenSSL bignum) */class CBigNum
 {
 protected:
@@ -58,6 +102,15 @@ protected:
         bn = BN_new();
     }
 
+    // BN_mod_exp with precomputed Montgomery parameters, keeping its shortcut for one-word bases
+    static int mod_exp_mont(BIGNUM* r, const BIGNUM* a, const BIGNUM* p, const BIGNUM* m, BN_MONT_CTX* pmont)
+    {
+        BN_CTX* pctx = GetThreadBN_CTX();
+        if (BN_num_bits(a) > 0 && BN_num_bits(a) <= BN_BITS2 && !BN_is_negative(a))
+            return BN_mod_exp_mont_word(r, BN_get_word(a), p, m, pctx, pmont);
+        return BN_mod_exp_mont(r, a, p, m, pctx, pmont);
+    }
+
 public:
     CBigNum()
     {
@@ -518,7 +571,7 @@ public:
      * @param m modulus
      */
     CBigNum mul_mod(const CBigNum& b, const CBigNum& m) const {
-        CAutoBN_CTX pctx;
+        BN_CTX* pctx = GetThreadBN_CTX();
         CBigNum ret;
         if (!BN_mod_mul(&ret, bn, &b, &m, pctx))
             throw bignum_error("CBigNum::mul_mod : BN_mod_mul failed");
@@ -532,7 +585,7 @@ public:
      * @param m modulus
      */
     CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const {
-        CAutoBN_CTX pctx;
+        BN_CTX* pctx = GetThreadBN_CTX();
         CBigNum ret;
         if( e < 0){
             // g^-x = (g^-1)^x
@@ -547,6 +600,32 @@ public:
         return ret;
     }
 
+    /**
+     * modular exponentiation: this^e mod m, using the cached Montgomery parameters
+     * of m and the thread's BN_CTX. Same result as pow_mod.
+     * @param e exponent
+     * @param m modulus
+     * @param mont Montgomery context kept for m
+     */
+    CBigNum pow_mod_mont(const CBigNum& e, const CBigNum& m, const CBigNumMontCtx& mont) const {
+        BN_MONT_CTX* pmont = mont.Get(m);
+        if (pmont == NULL)
+            return pow_mod(e, m);
+
+        CBigNum ret;
+        if (e < 0) {
+            // g^-x = (g^-1)^x
+            CBigNum inv = this->inverse(m);
+            CBigNum posE = e * -1;
+            if (!mod_exp_mont(&ret, &inv, &posE, &m, pmont))
+                throw bignum_error("CBigNum::pow_mod_mont : BN_mod_exp_mont failed on negative exponent");
+        } else
+        if (!mod_exp_mont(&ret, bn, &e, &m, pmont))
+            throw bignum_error("CBigNum::pow_mod_mont : BN_mod_exp_mont failed");
+
+        return ret;
+    }
+
     /**
      * Calculates the inverse of this element mod m.
      * i.e. i such this*i = 1 mod m
@@ -554,7 +633,7 @@ public:
      * @return the inverse
      */
     CBigNum inverse(const CBigNum& m) const {
-        CAutoBN_CTX pctx;
+        BN_CTX* pctx = GetThreadBN_CTX();
         CBigNum ret;
         if (!BN_mod_inverse(&ret, bn, &m, pctx))
             throw bignum_error("CBigNum::inverse*= :BN_mod_inverse");
@@ -628,7 +707,7 @@ public:
 
     CBigNum& operator*=(const CBigNum& b)
     {
-        CAutoBN_CTX pctx;
+        BN_CTX* pctx = GetThreadBN_CTX();
         if (!BN_mul(bn, bn, &b, pctx))
             throw bignum_error("CBigNum::operator*= : BN_mul failed");
         return *this;
@@ -747,7 +826,7 @@ inline const CBigNum operator-(const CBigNum& a)
 
 inline const CBigNum operator*(const CBigNum& a, const CBigNum& b)
 {
-    CAutoBN_CTX pctx;
+    BN_CTX* pctx = GetThreadBN_CTX();
     CBigNum r;
     if (!BN_mul(&r, &a, &b, pctx))
         throw bignum_error("CBigNum::operator* : BN_mul failed");
@@ -756,7 +835,7 @@ inline const CBigNum operator*(const CBigNum& a, const CBigNum& b)
 
 inline const CBigNum operator/(const CBigNum& a, const CBigNum& b)
 {
-    CAutoBN_CTX pctx;
+    BN_CTX* pctx = GetThreadBN_CTX();
     CBigNum r;
     if (!BN_div(&r, NULL, &a, &b, pctx))
         throw bignum_error("CBigNum::operator/ : BN_div failed");
@@ -765,7 +844,7 @@ inline const CBigNum operator/(const CBigNum& a, const CBigNum& b)
 
 inline const CBigNum operator%(const CBigNum& a, const CBigNum& b)
 {
-    CAutoBN_CTX pctx;
+    BN_CTX* pctx = GetThreadBN_CTX();
     CBigNum r;
     if (!BN_nnmod(&r, &a, &b, pctx))
         throw bignum_error("CBigNum::operator% : BN_div failed");
@@ -795,6 +874,46 @@ inline bool operator<(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a,
 inline bool operator>(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a, &b) > 0); }
 inline std::ostream& operator<<(std::ostream &strm, const CBigNum &b) { return strm << b.ToString(10); }
 
+struct CBigNumMontCtx::CEntry
+{
+    CBigNum modulus;
+    BN_MONT_CTX* pmont;
+
+    CEntry(const CBigNum& m) : modulus(m), pmont(BN_MONT_CTX_new())
+    {
+        if (pmont == NULL || !BN_MONT_CTX_set(pmont, &modulus, GetThreadBN_CTX())) {
+            BN_MONT_CTX_free(pmont);
+            throw bignum_error("CBigNumMontCtx : BN_MONT_CTX_set failed");
+        }
+    }
+
+    ~CEntry()
+    {
+        BN_MONT_CTX_free(pmont);
+    }
+};
+
+inline BN_MONT_CTX* CBigNumMontCtx::Get(const CBigNum& m) const
+{
+    CEntry* p = pentry.load(std::memory_order_acquire);
+    if (p == NULL) {
+        // Montgomery reduction only works for odd moduli
+        if (!BN_is_odd(&m))
+            return NULL;
+        CEntry* pnew = new CEntry(m);
+        if (pentry.compare_exchange_strong(p, pnew, std::memory_order_acq_rel))
+            p = pnew;
+        else
+            delete pnew; // another thread was first, p now holds its entry
+    }
+    return p->modulus == m ? p->pmont : NULL;
+}
+
+inline void CBigNumMontCtx::Reset()
+{
+    delete pentry.exchange(NULL);
+}
+
 typedef CBigNum Bignum;
 
 #endif
@@ -24,6 +24,8 @@
 #include "policy/policy.h"
 #include "pow.h"
 #include "primitives/block.h"
+#include "primitives/powcache.h"
+#include "primitives/powscratch.h"
 #include "primitives/transaction.h"
 #include "random.h"
 #include "script/script.h"
@@ -59,6 +61,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/math/distributions/poisson.hpp>
+#include <boost/scoped_array.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -83,6 +86,7 @@ int nScriptCheckThreads = 0;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = false;
+bool fEnodePayeeIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -1765,7 +1769,48 @@ bool WriteBlockToDisk(const CBlock &block, CDiskBlockPos &pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, const Consensus::Params &consensusParams) {
+//! Serialized size of CBlockHeader
+static const unsigned int BLOCK_HEADER_SIZE = 80;
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char> &block, const CDiskBlockPos &pos, const uint256 &hash,
+                          const CMessageHeader::MessageStartChars &messageStart) {
+    // WriteBlockToDisk put the message start and the size right before the block
+    if (pos.nPos < MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("ReadRawBlockFromDisk: invalid position %s", pos.ToString());
+    CDiskBlockPos posIndexHeader(pos.nFile, pos.nPos - MESSAGE_START_SIZE - sizeof(unsigned int));
+
+    CAutoFile filein(OpenBlockFile(posIndexHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadRawBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blockStart) >> nSize;
+        if (memcmp(blockStart, messageStart, MESSAGE_START_SIZE) != 0)
+            return error("ReadRawBlockFromDisk: bad message start at %s", pos.ToString());
+        if (nSize < BLOCK_HEADER_SIZE || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("ReadRawBlockFromDisk: bad size %u at %s", nSize, pos.ToString());
+        block.resize(nSize);
+        filein.read((char *) block.data(), nSize);
+    }
+    catch (const std::exception &e) {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+
+    // The block hash is the hash of the serialized header, which comes first
+    if (Hash(block.begin(), block.begin() + BLOCK_HEADER_SIZE) != hash)
+        return error("ReadRawBlockFromDisk: hash doesn't match %s at %s", hash.ToString(), pos.ToString());
+    return true;
+}
+
+//! Time spent checking PoW of blocks read from disk, and number of such checks done and skipped
+static std::atomic<int64_t> nTimeReadPoW(0);
+static std::atomic<int64_t> nReadPoWChecked(0);
+static std::atomic<int64_t> nReadPoWSkipped(0);
+
+static bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, const Consensus::Params &consensusParams,
+                              bool fCheckPOW) {
     block.SetNull();
 
     // Open history file to read
@@ -1781,18 +1826,37 @@ bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, con
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams))
-        return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+    if (fCheckPOW) {
+        int64_t nTimeStart = GetTimeMicros();
+        if (!CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams))
+            return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+        nTimeReadPoW += GetTimeMicros() - nTimeStart;
+        nReadPoWChecked++;
+    }
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, const Consensus::Params &consensusParams) {
+    return ReadBlockFromDisk(block, pos, nHeight, consensusParams, true);
+}
+
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams) {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), pindex->nHeight, consensusParams))
+    // The header of an index entry valid up to BLOCK_VALID_TREE already passed CheckBlockHeader when it
+    // was accepted. The block hash comparison below proves we read that same header, so PoW is only
+    // rechecked for entries that were never validated.
+    bool fCheckPOW = !pindex->IsValid(BLOCK_VALID_TREE);
+    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), pindex->nHeight, consensusParams, fCheckPOW))
         return false;
     if (block.GetHash() != pindex->GetBlockHash()) {
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                      pindex->ToString(), pindex->GetBlockPos().ToString());
     }
+    if (!fCheckPOW) {
+        int64_t nSkipped = ++nReadPoWSkipped;
+        int64_t nChecked = nReadPoWChecked;
+        LogPrint("bench", "    - ReadBlockFromDisk: skipped PoW check of validated block %d (%d skipped, ~%.2fs saved)\n",
+                 pindex->nHeight, nSkipped, nChecked ? 0.000001 * nTimeReadPoW * nSkipped / nChecked : 0.0);
+    }
     return true;
 }
 
@@ -2358,6 +2422,124 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+// Every check is POW_HASH_BATCH_SIZE memory-hard hashes, hand them out one at a time so work spreads over all threads
+static CCheckQueue<CHeaderPoWCheck> headerpowcheckqueue(1);
+
+void ThreadHeaderPoWCheck() {
+    RenameThread("bitcoin-headerpow");
+    headerpowcheckqueue.Thread();
+}
+
+// Every check is a full CoinSpend verification taking milliseconds
+static CCheckQueue<CZerocoinSpendCheck> zerocoinspendcheckqueue(1);
+// A check queue has a single master: concurrent CheckBlock calls verify their spends serially
+static CCriticalSection cs_zerocoinspendcheck;
+
+void ThreadZerocoinSpendCheck() {
+    RenameThread("bitcoin-zcspend");
+    zerocoinspendcheckqueue.Thread();
+}
+
+/**
+ * Verify the proofs of all the zerocoin spends in a block on the check threads. The
+ * ordered checks of CheckTransaction (versions, serials, double spends) then find the
+ * verified spends in zerocoinTxInfo and skip their proofs.
+ */
+static void PrecomputeZerocoinSpends(const CBlock &block) {
+    if (!nScriptCheckThreads)
+        return;
+
+    std::vector <CZerocoinSpendInput> spends;
+    BOOST_FOREACH(const CTransaction &tx, block.vtx)
+        GetZerocoinSpendInputs(tx, spends);
+    if (spends.size() < 2)
+        return;
+
+    TRY_LOCK(cs_zerocoinspendcheck, lockSpendCheck);
+    if (!lockSpendCheck)
+        return;
+
+    int64_t nTimeStart = GetTimeMicros();
+    boost::scoped_array<bool> fVerified(new bool[spends.size()]);
+    std::vector <CZerocoinSpendCheck> vChecks;
+    vChecks.reserve(spends.size());
+    for (size_t i = 0; i < spends.size(); i++)
+        vChecks.push_back(CZerocoinSpendCheck(spends[i], &fVerified[i]));
+
+    CCheckQueueControl<CZerocoinSpendCheck> control(&zerocoinspendcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    size_t nVerified = 0;
+    for (size_t i = 0; i < spends.size(); i++) {
+        if (!fVerified[i])
+            continue;
+        block.zerocoinTxInfo->verifiedSpends.insert(make_pair(spends[i].ptx->GetHash(),
+                make_pair(spends[i].nIn, (int)spends[i].denomination)));
+        nVerified++;
+    }
+    LogPrint("bench", "    - Verify %u zerocoin spends (%u passed): %.2fms\n", spends.size(), nVerified,
+             0.001 * (GetTimeMicros() - nTimeStart));
+}
+
+bool CHeaderPoWCheck::operator()() {
+    const CBlockHeader *pHeaders[POW_HASH_BATCH_SIZE];
+    uint256 powHashes[POW_HASH_BATCH_SIZE];
+    assert(headers.size() <= POW_HASH_BATCH_SIZE);
+    for (size_t i = 0; i < headers.size(); i++)
+        pHeaders[i] = &headers[i];
+    CBlockHeader::GetPoWHashes(pHeaders, &nHeights[0], powHashes, headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (!CheckProofOfWork(powHashes[i], headers[i].nBits, Params().GetConsensus()))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Hash a batch of headers received from a peer on the header check threads, without
+ * holding cs_main. Only headers that connect to a known block, one after the other, are
+ * hashed, and headers we already know are skipped. Validation of the batch then only
+ * finds the PoW hashes in powHashCache. Returns false if a header fails its proof of work,
+ * the remaining batches are then skipped by the check queue.
+ */
+static bool PrecomputeHeadersPoW(const std::vector <CBlockHeader> &headers) {
+    if (!nScriptCheckThreads || headers.size() < 2 || powHashCache.GetMaxSize() < headers.size())
+        return true;
+
+    int64_t nTimeStart = GetTimeMicros();
+    std::vector <CHeaderPoWCheck> vChecks;
+    vChecks.reserve(headers.size() / POW_HASH_BATCH_SIZE + 1);
+    size_t nHeaders = 0;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(headers[0].hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return true;
+        int nHeight = mi->second->nHeight + 1;
+        uint256 hashPrev = headers[0].hashPrevBlock;
+        for (size_t i = 0; i < headers.size(); i++) {
+            // A non-continuous sequence is rejected before its headers are hashed
+            if (headers[i].hashPrevBlock != hashPrev)
+                break;
+            hashPrev = headers[i].GetHash();
+            if (mapBlockIndex.count(hashPrev))
+                continue;
+            // Group the headers so that Lyra2Z hashes them with interleaved sponges
+            if (vChecks.empty() || vChecks.back().size() == POW_HASH_BATCH_SIZE)
+                vChecks.push_back(CHeaderPoWCheck());
+            vChecks.back().Add(headers[i], nHeight + i);
+            nHeaders++;
+        }
+    }
+
+    CCheckQueueControl<CHeaderPoWCheck> control(&headerpowcheckqueue);
+    control.Add(vChecks);
+    bool fOk = control.Wait();
+    LogPrint("bench", "    - Hash %u headers: %.2fms\n", nHeaders, 0.001 * (GetTimeMicros() - nTimeStart));
+    return fOk;
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2797,7 +2979,14 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
-                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                // Zerocoin data of the connected blocks goes with their BLOCK_HAVE_ZEROCOIN flags
+                std::vector<std::pair<const CBlockIndex *, CZerocoinBlockDataCache::DataPtr> > vZerocoinDirty;
+                CZerocoinState::GetZerocoinState()->TakeDirtyBlockData(vZerocoinDirty);
+                std::vector<std::pair<const CBlockIndex *, const CZerocoinBlockData *> > vZerocoinData;
+                vZerocoinData.reserve(vZerocoinDirty.size());
+                BOOST_FOREACH(const PAIRTYPE(const CBlockIndex *, CZerocoinBlockDataCache::DataPtr) &dirty, vZerocoinDirty)
+                    vZerocoinData.push_back(make_pair(dirty.first, dirty.second.get()));
+                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, vZerocoinData)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
             }
@@ -2908,6 +3097,20 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams &chainParams) {
         LogPrintf(" warning='%s'", boost::algorithm::join(warningMessages, ", "));
 }
 
+/** Coinbase outputs of the block at pindex paying the enode reward */
+static void GetEnodePayments(const CBlock &block, const CBlockIndex *pindex,
+                             std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> > &payments) {
+    if (block.vtx.empty())
+        return;
+    const CTransaction &coinbase = block.vtx[0];
+    CAmount nEnodePayment = GetEnodePayment(pindex->nHeight, coinbase.GetValueOut());
+    BOOST_FOREACH(const CTxOut &txout, coinbase.vout) {
+        if (txout.nValue == nEnodePayment)
+            payments.push_back(make_pair(CEnodePayeeKey(txout.scriptPubKey, pindex->nHeight),
+                                         CEnodePayeeValue(pindex->GetBlockHash(), txout.nValue)));
+    }
+}
+
 /** Disconnect chainActive's tip. You probably want to call mempool.removeForReorg and manually re-limit mempool size after this, with cs_main held. */
 bool static DisconnectTip(CValidationState &state, const CChainParams &chainparams, bool fBare = false) {
     LogPrintf("DisconnectTip()\n");
@@ -2927,7 +3130,11 @@ bool static DisconnectTip(CValidationState &state, const CChainParams &chainpara
     }
     LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
 	
-	DisconnectTipZC(block, pindexDelete);
+    if (!DisconnectTipZC(block, pindexDelete))
+        return AbortNode(state, "Failed to read zerocoin data, you may need to -reindex");
+
+    // The enode payee index keeps this block's entries, UpdateLastPaid skips
+    // those whose block is no longer on the active chain
 	
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
@@ -3012,8 +3219,18 @@ ConnectTip(CValidationState &state, const CChainParams &chainparams, CBlockIndex
     nTimeFlush += nTime4 - nTime3;
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
 
-    if (!ConnectTipZC(state, chainparams, pindexNew, pblock))
+    if (!ConnectTipZC(state, chainparams, pindexNew, pblock)) {
+        if (state.IsError())
+            return AbortNode(state, "Failed to read zerocoin data, you may need to -reindex");
         return false;
+    }
+    // BLOCK_HAVE_ZEROCOIN may have changed
+    setDirtyBlockIndex.insert(pindexNew);
+
+    std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> > vEnodePayments;
+    GetEnodePayments(*pblock, pindexNew, vEnodePayments);
+    if (!vEnodePayments.empty() && !pblocktree->WriteEnodePayments(vEnodePayments))
+        return AbortNode(state, "Failed to write enode payee index");
 
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
@@ -3101,6 +3318,36 @@ CAmount GetEnodePayment(int nHeight, CAmount blockValue) {
     return ret;
 }
 
+bool BuildEnodePayeeIndex(const CChainParams &chainparams) {
+    LOCK(cs_main);
+    if (fEnodePayeeIndex)
+        return true;
+
+    LogPrintf("Building enode payee index...\n");
+    int nStart = std::max(1, chainparams.GetConsensus().nEnodePaymentsStartBlock);
+    std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> > vPayments;
+    for (CBlockIndex *pindex = chainActive[nStart]; pindex; pindex = chainActive.Next(pindex)) {
+        boost::this_thread::interruption_point();
+        // Pruned blocks paid nothing we could still need
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            continue;
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+            return error("%s: ReadBlockFromDisk failed at %d", __func__, pindex->nHeight);
+        GetEnodePayments(block, pindex, vPayments);
+        if (vPayments.size() >= 1000) {
+            if (!pblocktree->WriteEnodePayments(vPayments))
+                return error("%s: failed to write enode payee index", __func__);
+            vPayments.clear();
+        }
+    }
+    if (!pblocktree->WriteEnodePayments(vPayments) || !pblocktree->WriteFlag("enodepayeeindex", true))
+        return error("%s: failed to write enode payee index", __func__);
+    fEnodePayeeIndex = true;
+    LogPrintf("Enode payee index built up to height %d\n", chainActive.Height());
+    return true;
+}
+
 bool DisconnectBlocks(int blocks) {
     LOCK(cs_main);
 
@@ -3695,10 +3942,15 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
 }
 
 //btzc: code from vertcoin, add
-bool CheckBlockHeader(const CBlockHeader &block, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW) {
-    int nHeight = ZerocoinGetNHeight(block);
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams)) {
-        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+bool CheckBlockHeader(const CBlockHeader &block, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW,
+                      uint256 *pPoWHash) {
+    if (fCheckPOW) {
+        int nHeight = ZerocoinGetNHeight(block);
+        uint256 powHash = block.GetPoWHash(nHeight);
+        if (!CheckProofOfWork(powHash, block.nBits, consensusParams))
+            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+        if (pPoWHash)
+            *pPoWHash = powHash;
     }
     return true;
 }
@@ -3796,6 +4048,11 @@ bool CheckBlock(const CBlock &block, CValidationState &state, const Consensus::P
             nHeight = ZerocoinGetNHeight(block.GetBlockHeader());
         if (block.zerocoinTxInfo == NULL)
             block.zerocoinTxInfo = new CZerocoinTxInfo();
+        // Spends verified by an earlier pass were checked against the coin groups of that
+        // time, which a new tip or a reorg may have changed
+        block.zerocoinTxInfo->verifiedSpends.clear();
+        if (!isVerifyDB)
+            PrecomputeZerocoinSpends(block);
         BOOST_FOREACH(const CTransaction &tx, block.vtx)
         if (!CheckTransaction(tx, state, tx.GetHash(), isVerifyDB, nHeight, false, block.zerocoinTxInfo)) {
             LogPrintf("block=%s\n", block.ToString());
@@ -4024,6 +4281,7 @@ static bool AcceptBlockHeader(const CBlockHeader &block, CValidationState &state
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
+    uint256 powHash;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
 
         if (miSelf != mapBlockIndex.end()) {
@@ -4039,7 +4297,7 @@ static bool AcceptBlockHeader(const CBlockHeader &block, CValidationState &state
 //        int nHeight = ZerocoinGetNHeight(block);
 //        int64_t start = std::chrono::duration_cast<std::chrono::milliseconds>(
 //                std::chrono::system_clock::now().time_since_epoch()).count();
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, &powHash))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(),
                          FormatStateMessage(state));
 //        int64_t end = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -4072,8 +4330,14 @@ static bool AcceptBlockHeader(const CBlockHeader &block, CValidationState &state
                          FormatStateMessage(state));
         }
     }
-    if (pindex == NULL)
+    if (pindex == NULL) {
         pindex = AddToBlockIndex(block);
+        // Remember the verified PoW hash so it's persisted with the block index
+        if (pindex->powHash.IsNull() && !powHash.IsNull()) {
+            pindex->powHash = powHash;
+            pindex->nStatus |= BLOCK_HAVE_POWHASH;
+        }
+    }
     if (ppindex)
         *ppindex = pindex;
 //    LogPrintf("--->AcceptBlockHeader success");
@@ -4392,6 +4656,52 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
     return pindexNew;
 }
 
+/**
+ * Check proof of work of the loaded block index. Stored PoW hashes are trusted and only
+ * compared against the target, except for the -checkpowblocks highest entries and a random
+ * -checkpowsample of the others, which are recomputed. Entries without BLOCK_HAVE_POWHASH
+ * have no stored hash: it is computed once and the entry is marked dirty so the hash gets
+ * persisted on the next flush.
+ */
+static bool CheckBlockIndexProofOfWork(const vector <pair<int, CBlockIndex *>> &vSortedByHeight,
+                                       const Consensus::Params &consensusParams) {
+    int64_t nStart = GetTimeMicros();
+    size_t nCheckBlocks = vSortedByHeight.size();
+    int64_t nCheckPowBlocks = GetArg("-checkpowblocks", DEFAULT_CHECKPOWBLOCKS);
+    if (nCheckPowBlocks > 0 && (uint64_t)nCheckPowBlocks < nCheckBlocks)
+        nCheckBlocks = nCheckPowBlocks;
+    set<size_t> setSample;
+    int64_t nSample = GetArg("-checkpowsample", DEFAULT_CHECKPOWSAMPLE);
+    for (int64_t i = 0; i < nSample && !vSortedByHeight.empty(); i++)
+        setSample.insert(GetRand(vSortedByHeight.size()));
+
+    unsigned int nHashed = 0, nMigrated = 0;
+    for (size_t i = 0; i < vSortedByHeight.size(); i++) {
+        boost::this_thread::interruption_point();
+        CBlockIndex *pindex = vSortedByHeight[i].second;
+        uint256 powHash = pindex->powHash;
+        if (powHash.IsNull()) {
+            powHash = pindex->GetBlockPoWHash(true);
+            pindex->powHash = powHash;
+            pindex->nStatus |= BLOCK_HAVE_POWHASH;
+            setDirtyBlockIndex.insert(pindex);
+            nHashed++;
+            nMigrated++;
+        } else if (i + nCheckBlocks >= vSortedByHeight.size() || setSample.count(i)) {
+            powHash = pindex->GetBlockPoWHash(true);
+            nHashed++;
+            if (powHash != pindex->powHash)
+                return error("%s: stored PoW hash doesn't match: %s", __func__, pindex->ToString());
+        }
+        if (!CheckProofOfWork(powHash, pindex->nBits, consensusParams))
+            return error("%s: CheckProofOfWork failed: %s", __func__, pindex->ToString());
+    }
+
+    LogPrintf("%s: checked %u entries, hashed %u, stored PoW hash for %u: %.2fms\n", __func__,
+              vSortedByHeight.size(), nHashed, nMigrated, 0.001 * (GetTimeMicros() - nStart));
+    return true;
+}
+
 bool static LoadBlockIndexDB() {
     LogPrintf("LoadBlockIndexDB\n");
     const CChainParams &chainparams = Params();
@@ -4410,6 +4720,9 @@ bool static LoadBlockIndexDB() {
         vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
     }
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
+
+    if (!CheckBlockIndexProofOfWork(vSortedByHeight, chainparams.GetConsensus()))
+        return false;
     BOOST_FOREACH(
     const PAIRTYPE(int, CBlockIndex*) &item, vSortedByHeight)
     {
@@ -4491,6 +4804,8 @@ bool static LoadBlockIndexDB() {
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    pblocktree->ReadFlag("enodepayeeindex", fEnodePayeeIndex);
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end()) {
@@ -4500,7 +4815,8 @@ bool static LoadBlockIndexDB() {
     chainActive.SetTip(it->second);
 
     PruneBlockIndexCandidates();
-    ZerocoinBuildStateFromIndex(&chainActive);
+    if (!ZerocoinBuildStateFromIndex(&chainActive))
+        return error("LoadBlockIndexDB(): failed to read zerocoin data, you may need to -reindex");
 
     LogPrintf("%s: hashBestChain=%s height=%d date=%s progress=%f\n", __func__,
               chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
@@ -4765,6 +5081,9 @@ bool InitBlockIndex(const CChainParams &chainparams) {
     // Use the provided setting for -txindex in the new database
     fTxIndex = GetBoolArg("-txindex", DEFAULT_TXINDEX);
     pblocktree->WriteFlag("txindex", fTxIndex);
+    // A new database indexes enode payments from the start
+    fEnodePayeeIndex = true;
+    pblocktree->WriteFlag("enodepayeeindex", fEnodePayeeIndex);
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -5252,7 +5571,13 @@ bool static AlreadyHave(const CInv &inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     return true;
 }
 
-void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParams) {
+/**
+ * Answer the getdata requests of a peer. A block that can go out as stored on disk is only
+ * located: ProcessGetData reads and sends it once cs_main is released, followed by the inv
+ * that triggers the next getblocks.
+ */
+void static ProcessGetDataLocked(CNode *pfrom, const Consensus::Params &consensusParams,
+                                 CDiskBlockPos &posRawBlock, uint256 &hashRawBlock, vector <CInv> &vInvContinue) {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
 
     vector <CInv> vNotFound;
@@ -5307,11 +5632,17 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
+                    // Blocks are stored with their witness data, and there is none before segwit activation
+                    bool fRawBlock = inv.type == MSG_WITNESS_BLOCK ||
+                                     (inv.type == MSG_BLOCK && !IsWitnessEnabled(mi->second->pprev, consensusParams));
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                    if (!fRawBlock && !ReadBlockFromDisk(block, (*mi).second, consensusParams))
                         assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
+                    if (fRawBlock) {
+                        posRawBlock = mi->second->GetBlockPos();
+                        hashRawBlock = inv.hash;
+                    } else if (inv.type == MSG_BLOCK)
                         pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
                     else if (inv.type == MSG_WITNESS_BLOCK)
                         pfrom->PushMessage(NetMsgType::BLOCK, block);
@@ -5361,9 +5692,7 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                         // Bypass PushInventory, this must send even if redundant,
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
-                        vector <CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
-                        pfrom->PushMessage(NetMsgType::INV, vInv);
+                        vInvContinue.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
                         pfrom->hashContinue.SetNull();
                     }
                 }
@@ -5534,6 +5863,24 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
     }
 }
 
+void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParams) {
+    CDiskBlockPos posRawBlock;
+    uint256 hashRawBlock;
+    vector <CInv> vInvContinue;
+    ProcessGetDataLocked(pfrom, consensusParams, posRawBlock, hashRawBlock, vInvContinue);
+
+    if (!posRawBlock.IsNull()) {
+        // The block may have been pruned meanwhile, the peer then asks someone else
+        std::vector<unsigned char> vchBlock;
+        if (ReadRawBlockFromDisk(vchBlock, posRawBlock, hashRawBlock, Params().MessageStart()))
+            pfrom->PushMessageRaw(NetMsgType::BLOCK, vchBlock);
+        else
+            LogPrintf("%s: cannot send block %s to peer=%d\n", __func__, hashRawBlock.ToString(), pfrom->GetId());
+    }
+    if (!vInvContinue.empty())
+        pfrom->PushMessage(NetMsgType::INV, vInvContinue);
+}
+
 uint32_t GetFetchFlags(CNode *pfrom, CBlockIndex *pprev, const Consensus::Params &chainparams) {
     uint32_t nFetchFlags = 0;
     if ((nLocalServices & NODE_WITNESS) && State(pfrom->GetId())->fHaveWitness) {
@@ -6520,6 +6867,14 @@ bool static ProcessMessage(CNode *pfrom, string strCommand, CDataStream &vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // The memory-hard PoW hashing is done in parallel without cs_main, only the
+        // contextual checks below run under the lock
+        if (!PrecomputeHeadersPoW(headers)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 50);
+            return error("headers message with invalid proof of work");
+        }
+
         {
             LOCK(cs_main);
 
@@ -189,6 +189,8 @@ extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+/** Whether the enode payee index covers the whole active chain, see BuildEnodePayeeIndex */
+extern bool fEnodePayeeIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -226,6 +228,10 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Default for -checkpowblocks, highest block index entries whose stored PoW hash is recomputed at startup */
+static const signed int DEFAULT_CHECKPOWBLOCKS = 6;
+/** Default for -checkpowsample, random block index entries whose stored PoW hash is recomputed at startup */
+static const signed int DEFAULT_CHECKPOWSAMPLE = 16;
 
 // Require that user allocate at least 550MB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
@@ -281,6 +287,10 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header PoW hashing thread */
+void ThreadHeaderPoWCheck();
+/** Run an instance of the zerocoin spend verification thread */
+void ThreadZerocoinSpendCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -473,16 +483,47 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure computing the PoW hashes of up to POW_HASH_BATCH_SIZE headers together, so
+ * that they're found in the PoW hash cache when the headers are validated under cs_main.
+ * Fails if one of them doesn't meet its target.
+ */
+class CHeaderPoWCheck
+{
+private:
+    std::vector<CBlockHeader> headers;
+    std::vector<int> nHeights;
+
+public:
+    CHeaderPoWCheck() {}
+
+    void Add(const CBlockHeader& header, int nHeight) {
+        headers.push_back(header);
+        nHeights.push_back(nHeight);
+    }
+
+    size_t size() const { return headers.size(); }
+
+    bool operator()();
+
+    void swap(CHeaderPoWCheck &check) {
+        headers.swap(check.headers);
+        nHeights.swap(check.nHeights);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, int nHeight, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the block at pos as serialized on disk, which is also its network serialization with witness data */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const uint256& hash, const CMessageHeader::MessageStartChars& messageStart);
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, uint256 *pPoWHash = NULL);
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, int nHeight = INT_MAX, bool isVerifyDB = false);
 
 /** Context-dependent validity checks.
@@ -512,6 +553,8 @@ int GetInputAge(const CTxIn &txin);
 int GetInputAgeIX(const uint256 &nTXHash, const CTxIn &txin);
 int GetIXConfirmations(const uint256 &nTXHash);
 CAmount GetEnodePayment(int nHeight, CAmount blockValue = 50 * COIN);
+/** Index the enode payments of the active chain, for block databases created before the index existed */
+bool BuildEnodePayeeIndex(const CChainParams& chainparams);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
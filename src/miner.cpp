@@ -18,6 +18,7 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "primitives/powscratch.h"
 #include "primitives/transaction.h"
 #include "script/standard.h"
 #include "timedata.h"
@@ -1119,39 +1120,40 @@ void static EledgerMiner(const CChainParams &chainparams) {
             LogPrintf("pblock: %s\n", pblock->ToString());
             LogPrintf("pblock->nVersion: %s\n", pblock->nVersion);
             LogPrintf("pblock->nTime: %s\n", pblock->nTime);
+            // Scratch memory of the PoW hash, allocated by the first nonce and reused for the rest
+            CPoWScratch powScratch;
+            // Nonces are tried POW_HASH_BATCH_SIZE at a time, so Lyra2Z hashes them with interleaved sponges
+            CBlockHeader vHeaders[POW_HASH_BATCH_SIZE];
+            const CBlockHeader *pHeaders[POW_HASH_BATCH_SIZE];
+            int nHeights[POW_HASH_BATCH_SIZE];
+            uint256 vHashes[POW_HASH_BATCH_SIZE];
+            for (size_t i = 0; i < POW_HASH_BATCH_SIZE; i++) {
+                pHeaders[i] = &vHeaders[i];
+                nHeights[i] = pindexPrev->nHeight + 1;
+            }
             while (true) {
                 // Check if something found
                 uint256 thash;
 
                 while (true) {
-                    if ((!fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2Z_HEIGHT)) {
-                        lyra2z_hash(BEGIN(pblock->nVersion), BEGIN(thash));
-                    } else if (!fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2_HEIGHT) {
-                        LYRA2(BEGIN(thash), 32, BEGIN(pblock->nVersion), 80, BEGIN(pblock->nVersion), 80, 2, 8192, 256);
-                    } else if (!fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2VAR_HEIGHT) {
-                        LYRA2(BEGIN(thash), 32, BEGIN(pblock->nVersion), 80, BEGIN(pblock->nVersion), 80, 2,
-                              pindexPrev->nHeight + 1, 256);
-                    } else if (fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2Z_HEIGHT_TESTNET) { // testnet
-                        lyra2z_hash(BEGIN(pblock->nVersion), BEGIN(thash));
-                    } else if (fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2_HEIGHT_TESTNET) { // testnet
-                        LYRA2(BEGIN(thash), 32, BEGIN(pblock->nVersion), 80, BEGIN(pblock->nVersion), 80, 2, 8192, 256);
-                    } else if (fTestNet && pindexPrev->nHeight + 1 >= HF_LYRA2VAR_HEIGHT_TESTNET) { // testnet
-                        LYRA2(BEGIN(thash), 32, BEGIN(pblock->nVersion), 80, BEGIN(pblock->nVersion), 80, 2, pindexPrev->nHeight + 1, 256);
-                    } else {
-                        unsigned long int scrypt_scratpad_size_current_block =
-                                ((1 << (GetNfactor(pblock->nTime) + 1)) * 128) + 63;
-                        char *scratchpad = (char *) malloc(scrypt_scratpad_size_current_block * sizeof(char));
-                        scrypt_N_1_1_256_sp_generic(BEGIN(pblock->nVersion), BEGIN(thash), scratchpad,
-                                                    GetNfactor(pblock->nTime));
-//                        LogPrintf("scrypt thash: %s\n", thash.ToString().c_str());
-//                        LogPrintf("hashTarget: %s\n", hashTarget.ToString().c_str());
-                        free(scratchpad);
+                    CBlockHeader header = pblock->GetBlockHeader();
+                    for (size_t i = 0; i < POW_HASH_BATCH_SIZE; i++) {
+                        vHeaders[i] = header;
+                        vHeaders[i].nNonce = header.nNonce + i;
+                    }
+                    CBlockHeader::ComputePoWHashes(pHeaders, nHeights, vHashes, POW_HASH_BATCH_SIZE, powScratch);
+                    size_t nFound = POW_HASH_BATCH_SIZE;
+                    for (size_t i = 0; i < POW_HASH_BATCH_SIZE && nFound == POW_HASH_BATCH_SIZE; i++) {
+                        if (UintToArith256(vHashes[i]) <= hashTarget)
+                            nFound = i;
                     }
 
                     //LogPrintf("*****\nhash   : %s  \ntarget : %s\n", UintToArith256(thash).ToString(), hashTarget.ToString());
 
-                    if (UintToArith256(thash) <= hashTarget) {
+                    if (nFound < POW_HASH_BATCH_SIZE) {
                         // Found a solution
+                        pblock->nNonce += nFound;
+                        thash = vHashes[nFound];
                         LogPrintf("Found a solution. Hash: %s", UintToArith256(thash).ToString());
                         SetThreadPriority(THREAD_PRIORITY_NORMAL);
 //                        CheckWork(pblock, *pwallet, reservekey);
@@ -1165,8 +1167,8 @@ void static EledgerMiner(const CChainParams &chainparams) {
                             throw boost::thread_interrupted();
                         break;
                     }
-                    pblock->nNonce += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
+                    pblock->nNonce += POW_HASH_BATCH_SIZE;
+                    if ((pblock->nNonce & 0xFF) < POW_HASH_BATCH_SIZE)
                         break;
                 }
                 // Check for stop or if block needs to be rebuilt
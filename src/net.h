@@ -629,6 +629,22 @@ public:
         }
     }
 
+    /** Send a message whose payload is already serialized, like a block read from disk. */
+    void PushMessageRaw(const char* pszCommand, const std::vector<unsigned char>& payload)
+    {
+        try
+        {
+            BeginMessage(pszCommand);
+            ssSend.write((const char*)payload.data(), payload.size());
+            EndMessage(pszCommand);
+        }
+        catch (...)
+        {
+            AbortMessage();
+            throw;
+        }
+    }
+
     template<typename T1, typename T2>
     void PushMessage(const char* pszCommand, const T1& a1, const T2& a2)
     {
@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "primitives/block.h"
+#include "primitives/powcache.h"
+#include "primitives/powscratch.h"
 #include "consensus/consensus.h"
 #include "main.h"
 #include "zerocoin.h"
@@ -21,7 +23,23 @@
 #include <fstream>
 #include <algorithm>
 #include <string>
-#include "precomputed_hash.h"
+#include <stdexcept>
+#include "primitives/precomputed_hash.raw.h"
+
+#include <boost/thread/tss.hpp>
+
+/** Heights [1, PRECOMPUTED_POW_HASH_END) of mainnet have their PoW hash in precomputedPoWHash */
+static const int PRECOMPUTED_POW_HASH_END = ARRAYLEN(precomputedPoWHash) + 1;
+
+static bool GetPrecomputedPoWHash(int nHeight, uint256 &powHash)
+{
+    if (nHeight < 1 || nHeight >= PRECOMPUTED_POW_HASH_END)
+        return false;
+    // The table holds the hashes in display (big-endian) byte order
+    const unsigned char *pHash = precomputedPoWHash[nHeight - 1];
+    std::reverse_copy(pHash, pHash + 32, powHash.begin());
+    return true;
+}
 
 
 
@@ -50,50 +68,157 @@ uint256 CBlockHeader::GetHash() const {
     return SerializeHash(*this);
 }
 
+static bool IsLyra2ZHeight(int nHeight)
+{
+    bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
+    return nHeight >= (fTestNet ? HF_LYRA2Z_HEIGHT_TESTNET : HF_LYRA2Z_HEIGHT);
+}
+
+/** Per-thread scratch memory of GetPoWHash, deleted by thread_specific_ptr when the thread ends */
+static CPoWScratch &GetThreadPoWScratch()
+{
+    static boost::thread_specific_ptr<CPoWScratch> threadScratch;
+    if (!threadScratch.get())
+        threadScratch.reset(new CPoWScratch());
+    return *threadScratch;
+}
+
+/** Don't pin the big matrices of the early LYRA2 blocks to every validation thread */
+static void TrimThreadPoWScratch(CPoWScratch &scratch)
+{
+    if (scratch.DynamicUsage() > MAX_THREAD_POW_SCRATCH_SIZE)
+        scratch.Release();
+}
+
+uint256 CBlockHeader::ComputePoWHash(int nHeight, CPoWScratch &scratch) const {
+    bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
+    uint256 powHash;
+    int result = 0;
+    if (!fTestNet && nHeight >= HF_LYRA2Z_HEIGHT) {
+        result = lyra2z_hash_ctx(&scratch.lyra2[0], BEGIN(nVersion), BEGIN(powHash));
+    } else if (!fTestNet && nHeight >= HF_LYRA2_HEIGHT) {
+        result = LYRA2_ctx(&scratch.lyra2[0], BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, 8192, 256);
+    } else if (!fTestNet && nHeight >= HF_LYRA2VAR_HEIGHT) {
+        result = LYRA2_ctx(&scratch.lyra2[0], BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, nHeight, 256);
+    } else if (fTestNet && nHeight >= HF_LYRA2Z_HEIGHT_TESTNET) { // testnet
+        result = lyra2z_hash_ctx(&scratch.lyra2[0], BEGIN(nVersion), BEGIN(powHash));
+    } else if (fTestNet && nHeight >= HF_LYRA2_HEIGHT_TESTNET) { // testnet
+        result = LYRA2_ctx(&scratch.lyra2[0], BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, 8192, 256);
+    } else if (fTestNet && nHeight >= HF_LYRA2VAR_HEIGHT_TESTNET) { // testnet
+        result = LYRA2_ctx(&scratch.lyra2[0], BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, nHeight, 256);
+    } else {
+        if (!scrypt_N_1_1_256_ctx(&scratch.scrypt, BEGIN(nVersion), BEGIN(powHash), GetNfactor(nTime)))
+            result = -1;
+    }
+    if (result != 0)
+        throw std::runtime_error("ComputePoWHash(): out of memory");
+    return powHash;
+}
+
 uint256 CBlockHeader::GetPoWHash(int nHeight) const {
 //    int64_t start = std::chrono::duration_cast<std::chrono::milliseconds>(
 //            std::chrono::system_clock::now().time_since_epoch()).count();
     bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
-    if (!fTestNet) {
-        if (nHeight < 20500) {
-            if (!mapPoWHash.count(1)) {
-//            std::cout << "Start Build Map" << std::endl;
-                buildMapPoWHash();
-            }
-        }
-        if (mapPoWHash.count(nHeight)) {
-//        std::cout << "GetPowHash nHeight=" << nHeight << ", hash= " << mapPoWHash[nHeight].ToString() << std::endl;
-            return mapPoWHash[nHeight];
-        }
-    }
     uint256 powHash;
+    if (!fTestNet && GetPrecomputedPoWHash(nHeight, powHash))
+        return powHash;
+    uint256 hashBlock = GetHash();
+    if (powHashCache.Get(hashBlock, nHeight, powHash))
+        return powHash;
+    CPoWScratch &scratch = GetThreadPoWScratch();
     try {
-        if (!fTestNet && nHeight >= HF_LYRA2Z_HEIGHT) {
-            lyra2z_hash(BEGIN(nVersion), BEGIN(powHash));
-        } else if (!fTestNet && nHeight >= HF_LYRA2_HEIGHT) {
-            LYRA2(BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, 8192, 256);
-        } else if (!fTestNet && nHeight >= HF_LYRA2VAR_HEIGHT) {
-            LYRA2(BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, nHeight, 256);
-        } else if (fTestNet && nHeight >= HF_LYRA2Z_HEIGHT_TESTNET) { // testnet
-            lyra2z_hash(BEGIN(nVersion), BEGIN(powHash));
-        } else if (fTestNet && nHeight >= HF_LYRA2_HEIGHT_TESTNET) { // testnet
-            LYRA2(BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, 8192, 256);
-        } else if (fTestNet && nHeight >= HF_LYRA2VAR_HEIGHT_TESTNET) { // testnet
-            LYRA2(BEGIN(powHash), 32, BEGIN(nVersion), 80, BEGIN(nVersion), 80, 2, nHeight, 256);
-        } else {
-            scrypt_N_1_1_256(BEGIN(nVersion), BEGIN(powHash), GetNfactor(nTime));
-        }
+        powHash = ComputePoWHash(nHeight, scratch);
     } catch (std::exception &e) {
         LogPrintf("excepetion: %s", e.what());
+        // Don't cache a hash that wasn't computed
+        return powHash;
     }
+    TrimThreadPoWScratch(scratch);
 //    int64_t end = std::chrono::duration_cast<std::chrono::milliseconds>(
 //            std::chrono::system_clock::now().time_since_epoch()).count();
 //    std::cout << "GetPowHash nHeight=" << nHeight << ", hash= " << powHash.ToString() << " done in= " << (end - start) << " miliseconds" << std::endl;
-    mapPoWHash.insert(make_pair(nHeight, powHash));
+    powHashCache.Insert(hashBlock, nHeight, powHash);
 //    SetPoWHash(thash);
     return powHash;
 }
 
+/** Hash a batch of Lyra2Z headers together, or one by one if the batch matrices couldn't be allocated */
+static void ComputeLyra2ZBatch(const CBlockHeader *const headers[], const int nHeights[], uint256 powHashes[],
+                               const size_t index[], size_t nBatch, CPoWScratch &scratch) {
+    const char *input[POW_HASH_BATCH_SIZE];
+    char *output[POW_HASH_BATCH_SIZE];
+    for (size_t j = 0; j < nBatch; j++) {
+        input[j] = BEGIN(headers[index[j]]->nVersion);
+        output[j] = BEGIN(powHashes[index[j]]);
+    }
+    if (lyra2z_hash_batch_ctx(scratch.lyra2, input, output, nBatch) == 0)
+        return;
+    for (size_t j = 0; j < nBatch; j++)
+        powHashes[index[j]] = headers[index[j]]->ComputePoWHash(nHeights[index[j]], scratch);
+}
+
+void CBlockHeader::ComputePoWHashes(const CBlockHeader *const headers[], const int nHeights[], uint256 powHashes[], size_t n, CPoWScratch &scratch) {
+    // Lyra2Z headers are hashed together with the sponges interleaved, the rest one by one
+    size_t index[POW_HASH_BATCH_SIZE];
+    size_t nBatch = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!IsLyra2ZHeight(nHeights[i])) {
+            powHashes[i] = headers[i]->ComputePoWHash(nHeights[i], scratch);
+            continue;
+        }
+        index[nBatch] = i;
+        if (++nBatch == POW_HASH_BATCH_SIZE) {
+            ComputeLyra2ZBatch(headers, nHeights, powHashes, index, nBatch, scratch);
+            nBatch = 0;
+        }
+    }
+    if (nBatch > 0)
+        ComputeLyra2ZBatch(headers, nHeights, powHashes, index, nBatch, scratch);
+}
+
+void CBlockHeader::GetPoWHashes(const CBlockHeader *const headers[], const int nHeights[], uint256 powHashes[], size_t n) {
+    bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
+    const CBlockHeader *pending[POW_HASH_BATCH_SIZE];
+    int nPendingHeights[POW_HASH_BATCH_SIZE];
+    uint256 pendingBlockHashes[POW_HASH_BATCH_SIZE];
+    uint256 *pendingPoWHashes[POW_HASH_BATCH_SIZE];
+    uint256 computed[POW_HASH_BATCH_SIZE];
+    CPoWScratch &scratch = GetThreadPoWScratch();
+
+    for (size_t i = 0; i < n; ) {
+        // Collect up to POW_HASH_BATCH_SIZE headers whose hash isn't known yet
+        size_t nPending = 0;
+        for (; i < n && nPending < POW_HASH_BATCH_SIZE; i++) {
+            if (!fTestNet && GetPrecomputedPoWHash(nHeights[i], powHashes[i]))
+                continue;
+            uint256 hashBlock = headers[i]->GetHash();
+            if (powHashCache.Get(hashBlock, nHeights[i], powHashes[i]))
+                continue;
+            pending[nPending] = headers[i];
+            nPendingHeights[nPending] = nHeights[i];
+            pendingBlockHashes[nPending] = hashBlock;
+            pendingPoWHashes[nPending] = &powHashes[i];
+            nPending++;
+        }
+        if (nPending == 0)
+            continue;
+        try {
+            ComputePoWHashes(pending, nPendingHeights, computed, nPending, scratch);
+        } catch (std::exception &e) {
+            LogPrintf("excepetion: %s", e.what());
+            // Don't cache hashes that weren't computed
+            for (size_t j = 0; j < nPending; j++)
+                pendingPoWHashes[j]->SetNull();
+            continue;
+        }
+        for (size_t j = 0; j < nPending; j++) {
+            *pendingPoWHashes[j] = computed[j];
+            powHashCache.Insert(pendingBlockHashes[j], nPendingHeights[j], computed[j]);
+        }
+    }
+    TrimThreadPoWScratch(scratch);
+}
+
 std::string CBlock::ToString() const {
     std::stringstream s;
     s << strprintf(
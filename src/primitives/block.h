@@ -12,6 +12,8 @@
 #include "definition.h"
 
 
+class CPoWScratch;
+
 unsigned char GetNfactor(int64_t nTimestamp);
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -96,6 +98,15 @@ public:
 
     uint256 GetPoWHash(int nHeight) const;
 
+    /** Compute the PoW hash for nHeight using scratch memory, bypassing the precomputed table and cache */
+    uint256 ComputePoWHash(int nHeight, CPoWScratch &scratch) const;
+
+    /** ComputePoWHash of n headers, hashing the Lyra2Z ones POW_HASH_BATCH_SIZE at a time with interleaved sponges */
+    static void ComputePoWHashes(const CBlockHeader *const headers[], const int nHeights[], uint256 powHashes[], size_t n, CPoWScratch &scratch);
+
+    /** GetPoWHash of n headers, computing the ones not in the table or cache together */
+    static void GetPoWHashes(const CBlockHeader *const headers[], const int nHeights[], uint256 powHashes[], size_t n);
+
     uint256 GetHash() const;
 
     int64_t GetBlockTime() const
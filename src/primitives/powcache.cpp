@@ -0,0 +1,95 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/powcache.h"
+
+CPoWHashCache powHashCache;
+
+CPoWHashCache::CPoWHashCache(size_t nMaxSizeIn) : nHits(0), nMisses(0)
+{
+    SetMaxSize(nMaxSizeIn);
+}
+
+bool CPoWHashCache::Get(const uint256 &hashBlock, int nHeight, uint256 &powHash)
+{
+    CShard &shard = GetShard(hashBlock);
+    {
+        boost::mutex::scoped_lock lock(shard.cs);
+        entry_map::iterator it = shard.map.find(hashBlock);
+        if (it != shard.map.end() && it->second->nHeight == nHeight) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            powHash = it->second->powHash;
+            nHits++;
+            return true;
+        }
+    }
+    nMisses++;
+    return false;
+}
+
+void CPoWHashCache::Insert(const uint256 &hashBlock, int nHeight, const uint256 &powHash)
+{
+    size_t nMax = nMaxSizePerShard;
+    if (nMax == 0)
+        return;
+
+    CShard &shard = GetShard(hashBlock);
+    boost::mutex::scoped_lock lock(shard.cs);
+    entry_map::iterator it = shard.map.find(hashBlock);
+    if (it != shard.map.end()) {
+        it->second->nHeight = nHeight;
+        it->second->powHash = powHash;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    while (shard.map.size() >= nMax) {
+        shard.map.erase(shard.lru.back().hashBlock);
+        shard.lru.pop_back();
+    }
+    CEntry entry;
+    entry.hashBlock = hashBlock;
+    entry.nHeight = nHeight;
+    entry.powHash = powHash;
+    shard.lru.push_front(entry);
+    shard.map.insert(std::make_pair(hashBlock, shard.lru.begin()));
+}
+
+void CPoWHashCache::SetMaxSize(size_t nMaxSizeIn)
+{
+    // Round up so that a non-zero size keeps at least one entry per shard
+    nMaxSizePerShard = (nMaxSizeIn + SHARDS - 1) / SHARDS;
+    for (unsigned int i = 0; i < SHARDS; i++) {
+        boost::mutex::scoped_lock lock(shards[i].cs);
+        while (shards[i].map.size() > nMaxSizePerShard) {
+            shards[i].map.erase(shards[i].lru.back().hashBlock);
+            shards[i].lru.pop_back();
+        }
+    }
+}
+
+void CPoWHashCache::Clear()
+{
+    for (unsigned int i = 0; i < SHARDS; i++) {
+        boost::mutex::scoped_lock lock(shards[i].cs);
+        shards[i].map.clear();
+        shards[i].lru.clear();
+    }
+    nHits = 0;
+    nMisses = 0;
+}
+
+CPoWHashCache::Stats CPoWHashCache::GetStats() const
+{
+    Stats stats;
+    stats.nSize = 0;
+    for (unsigned int i = 0; i < SHARDS; i++) {
+        boost::mutex::scoped_lock lock(shards[i].cs);
+        stats.nSize += shards[i].map.size();
+    }
+    stats.nMaxSize = nMaxSizePerShard * SHARDS;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    return stats;
+}
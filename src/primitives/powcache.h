@@ -0,0 +1,90 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PRIMITIVES_POWCACHE_H
+#define BITCOIN_PRIMITIVES_POWCACHE_H
+
+#include "uint256.h"
+
+#include <atomic>
+#include <list>
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+//! -powhashcachesize default (number of entries)
+static const unsigned int DEFAULT_POW_HASH_CACHE_SIZE = 50000;
+
+/**
+ * Bounded, thread-safe cache of computed PoW hashes, keyed by block header hash.
+ * The height the hash was computed for is stored with the entry (the PoW algorithm
+ * depends on it) and must match on lookup. Entries are spread over a fixed number
+ * of shards, each with its own lock and LRU eviction.
+ */
+class CPoWHashCache
+{
+public:
+    static const unsigned int SHARDS = 16;
+
+    struct Stats
+    {
+        size_t nSize;
+        size_t nMaxSize;
+        uint64_t nHits;
+        uint64_t nMisses;
+    };
+
+    explicit CPoWHashCache(size_t nMaxSizeIn = DEFAULT_POW_HASH_CACHE_SIZE);
+
+    //! Look up the PoW hash of header hashBlock at height nHeight, marking it recently used
+    bool Get(const uint256 &hashBlock, int nHeight, uint256 &powHash);
+    //! Store a computed PoW hash, evicting the least recently used entry of the shard if full
+    void Insert(const uint256 &hashBlock, int nHeight, const uint256 &powHash);
+
+    void SetMaxSize(size_t nMaxSizeIn);
+    size_t GetMaxSize() const { return nMaxSizePerShard * SHARDS; }
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    struct CEntry
+    {
+        uint256 hashBlock;
+        int nHeight;
+        uint256 powHash;
+    };
+
+    class CBlockHashHasher
+    {
+    public:
+        size_t operator()(const uint256 &hash) const {
+            return hash.GetCheapHash();
+        }
+    };
+
+    typedef std::list<CEntry> entry_list;
+    typedef boost::unordered_map<uint256, entry_list::iterator, CBlockHashHasher> entry_map;
+
+    struct CShard
+    {
+        mutable boost::mutex cs;
+        entry_list lru; //!< most recently used first
+        entry_map map;
+    };
+
+    CShard shards[SHARDS];
+    std::atomic<size_t> nMaxSizePerShard;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CShard &GetShard(const uint256 &hashBlock) {
+        // Use bits not consumed by the bucket hash in entry_map
+        return shards[hashBlock.begin()[31] % SHARDS];
+    }
+};
+
+extern CPoWHashCache powHashCache;
+
+#endif // BITCOIN_PRIMITIVES_POWCACHE_H
@@ -0,0 +1,61 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PRIMITIVES_POWSCRATCH_H
+#define BITCOIN_PRIMITIVES_POWSCRATCH_H
+
+#include "crypto/Lyra2Z/Lyra2.h"
+#include "crypto/scrypt.h"
+
+#include <stddef.h>
+
+#include <boost/noncopyable.hpp>
+
+//! Scratch memory above this size is not kept by the per-thread arena of CBlockHeader::GetPoWHash
+static const size_t MAX_THREAD_POW_SCRATCH_SIZE = 16 * 1024 * 1024;
+//! Number of headers CBlockHeader::ComputePoWHashes hashes together
+static const size_t POW_HASH_BATCH_SIZE = LYRA2_MAX_LANES;
+
+/**
+ * Scratch memory for the PoW hash functions (Lyra2 memory matrix and scrypt scratchpad),
+ * kept between hashes so that hashing with the same parameters does not allocate.
+ * Single hashes use lyra2[0], batches one context per lane.
+ * Owned by a single thread.
+ */
+class CPoWScratch : private boost::noncopyable
+{
+public:
+    LYRA2_CTX lyra2[LYRA2_MAX_LANES];
+    SCRYPT_CTX scrypt;
+
+    CPoWScratch()
+    {
+        for (size_t i = 0; i < LYRA2_MAX_LANES; i++)
+            LYRA2_ctx_init(&lyra2[i]);
+        scrypt_ctx_init(&scrypt);
+    }
+
+    ~CPoWScratch()
+    {
+        Release();
+    }
+
+    //! Free all scratch memory; it is allocated again by the next hash
+    void Release()
+    {
+        for (size_t i = 0; i < LYRA2_MAX_LANES; i++)
+            LYRA2_ctx_free(&lyra2[i]);
+        scrypt_ctx_free(&scrypt);
+    }
+
+    size_t DynamicUsage() const
+    {
+        size_t nUsage = scrypt.size;
+        for (size_t i = 0; i < LYRA2_MAX_LANES; i++)
+            nUsage += lyra2[i].nMatrixBytes + lyra2[i].nMaxRows * sizeof(uint64_t*);
+        return nUsage;
+    }
+};
+
+#endif // BITCOIN_PRIMITIVES_POWSCRATCH_H
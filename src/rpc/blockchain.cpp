@@ -11,6 +11,7 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "policy/policy.h"
+#include "primitives/powcache.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -18,6 +19,7 @@
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "zerocoin.h"
 #include "hash.h"
 
 #include <stdint.h>
@@ -1111,6 +1113,62 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getpowcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getpowcacheinfo\n"
+            "\nReturns details on the proof-of-work hash cache.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Current number of cached hashes\n"
+            "  \"maxsize\": xxxxx,            (numeric) Maximum number of cached hashes\n"
+            "  \"hits\": xxxxx,               (numeric) Lookups answered from the cache\n"
+            "  \"misses\": xxxxx              (numeric) Lookups that had to compute the hash\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getpowcacheinfo", "")
+            + HelpExampleRpc("getpowcacheinfo", "")
+        );
+
+    CPoWHashCache::Stats stats = powHashCache.GetStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (uint64_t) stats.nSize));
+    ret.push_back(Pair("maxsize", (uint64_t) stats.nMaxSize));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    return ret;
+}
+
+UniValue getzcverifycacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getzcverifycacheinfo\n"
+            "\nReturns details on the cache of verified zerocoin spend proofs.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Current number of cached proofs\n"
+            "  \"usage\": xxxxx,              (numeric) Memory used by the cache in bytes\n"
+            "  \"maxusage\": xxxxx,           (numeric) Maximum memory used by the cache in bytes\n"
+            "  \"hits\": xxxxx,               (numeric) Spends whose proof was found in the cache\n"
+            "  \"misses\": xxxxx              (numeric) Spends whose proof had to be verified\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getzcverifycacheinfo", "")
+            + HelpExampleRpc("getzcverifycacheinfo", "")
+        );
+
+    CZerocoinVerifyCacheStats stats = GetZerocoinVerifyCacheStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (uint64_t) stats.nSize));
+    ret.push_back(Pair("usage", (uint64_t) stats.nUsage));
+    ret.push_back(Pair("maxusage", (uint64_t) stats.nMaxUsage));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1201,6 +1259,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true  },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+    { "blockchain",         "getpowcacheinfo",        &getpowcacheinfo,        true  },
+    { "blockchain",         "getzcverifycacheinfo",   &getzcverifycacheinfo,   true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
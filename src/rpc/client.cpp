@@ -107,6 +107,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     //[eledger]
     { "setmininput", 0 },
     { "mintzerocoin", 0 },
+    { "mintmanyzerocoin", 0 },
+    { "mintmanyzerocoin", 1 },
     { "spendzerocoin", 0 },
     { "setgenerate", 0 },
     { "setgenerate", 1 },
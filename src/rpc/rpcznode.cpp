@@ -161,8 +161,7 @@ UniValue znode(const UniValue &params, bool fHelp) {
         if (strMode == "enabled")
             return mnodeman.CountEnabled();
 
-        int nCount;
-        mnodeman.GetNextEnodeInQueueForPayment(true, nCount);
+        int nCount = mnodeman.CountQualifiedForPayment(true);
 
         if (strMode == "qualify")
             return nCount;
@@ -5,6 +5,7 @@
 #include "darksend.h"
 #include "main.h"
 #include "spork.h"
+#include "znodeman.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -54,6 +55,8 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 
         mapSporks[hash] = spork;
         mapSporksActive[spork.nSporkID] = spork;
+        // cached Enode ranks may depend on the spork
+        mnodeman.NotifyEnodeStateChanged();
         spork.Relay();
 
         //does a task if needed
@@ -109,6 +112,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
         spork.Relay();
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[nSporkID] = spork;
+        mnodeman.NotifyEnodeStateChanged();
         return true;
     }
 
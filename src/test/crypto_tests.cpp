@@ -9,6 +9,9 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/scrypt.h"
+#include "crypto/Lyra2Z/Lyra2.h"
+#include "crypto/Lyra2Z/Lyra2Z.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -439,4 +442,35 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors) {
                   "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
 }
 
+BOOST_AUTO_TEST_CASE(pow_hash_ctx_reuse) {
+    // Hashing with a reused (dirty) context must match hashing with fresh memory,
+    // including when the matrix layout changes between calls.
+    LYRA2_CTX lyra2;
+    LYRA2_ctx_init(&lyra2);
+    SCRYPT_CTX scrypt;
+    scrypt_ctx_init(&scrypt);
+    std::vector<char> header(80);
+    for (int i = 0; i < 8; i++) {
+        for (size_t j = 0; j < header.size(); j++)
+            header[j] = insecure_rand();
+        uint256 expected, hash;
+
+        lyra2z_hash(&header[0], (char*)expected.begin());
+        lyra2z_hash_ctx(&lyra2, &header[0], (char*)hash.begin());
+        BOOST_CHECK(hash == expected);
+
+        uint64_t nRows = 500 + i * 7;
+        BOOST_CHECK_EQUAL(LYRA2(expected.begin(), 32, &header[0], 80, &header[0], 80, 2, nRows, 256), 0);
+        BOOST_CHECK_EQUAL(LYRA2_ctx(&lyra2, hash.begin(), 32, &header[0], 80, &header[0], 80, 2, nRows, 256), 0);
+        BOOST_CHECK(hash == expected);
+
+        unsigned char nFactor = 9 + i % 3;
+        scrypt_N_1_1_256(&header[0], (char*)expected.begin(), nFactor);
+        BOOST_CHECK(scrypt_N_1_1_256_ctx(&scrypt, &header[0], (char*)hash.begin(), nFactor));
+        BOOST_CHECK(hash == expected);
+    }
+    LYRA2_ctx_free(&lyra2);
+    scrypt_ctx_free(&scrypt);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
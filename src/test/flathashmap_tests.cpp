@@ -0,0 +1,110 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flathashmap.h"
+#include "random.h"
+
+#include "test/test_bitcoin.h"
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flathashmap_tests, BasicTestingSetup)
+
+// Few buckets, so that probe sequences collide and wrap around
+struct CollidingHash
+{
+    size_t operator()(int key) const { return (size_t)(key % 7) * 3; }
+};
+
+BOOST_AUTO_TEST_CASE(flathashmultimap_test)
+{
+    flathashmultimap<int, int, CollidingHash> map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(1) == NULL);
+
+    // values of the same key are found in insertion order, across rehashes
+    for (int i = 0; i < 100; i++)
+        map.insert(i % 20, i);
+    BOOST_CHECK(map.size() == 100);
+    for (int key = 0; key < 20; key++) {
+        BOOST_CHECK(map.count(key) == 5);
+        BOOST_CHECK(*map.find(key) == key);
+        const int *value = map.find_if(key, [](int v) { return v >= 40; });
+        BOOST_CHECK(value != NULL && *value == key + 40);
+    }
+    BOOST_CHECK(map.count(20) == 0);
+    BOOST_CHECK(map.find_if(3, [](int v) { return v == 4; }) == NULL);
+
+    // erase single values, then whole keys
+    BOOST_CHECK(map.erase_if(3, [](int v) { return v == 43; }));
+    BOOST_CHECK(!map.erase_if(3, [](int v) { return v == 43; }));
+    BOOST_CHECK(map.count(3) == 4);
+    BOOST_CHECK(map.find_if(3, [](int v) { return v >= 40; }) != NULL);
+    BOOST_CHECK(*map.find_if(3, [](int v) { return v >= 40; }) == 63);
+    BOOST_CHECK(map.erase(5) == 5);
+    BOOST_CHECK(map.erase(5) == 0);
+    BOOST_CHECK(map.size() == 94);
+
+    // everything else is still there
+    for (int key = 0; key < 20; key++) {
+        if (key == 5)
+            continue;
+        BOOST_CHECK(map.count(key) == (key == 3 ? 4u : 5u));
+        BOOST_CHECK(*map.find(key) == key);
+    }
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(1) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(flathashmultimap_random_test)
+{
+    // against std::multimap, with keys that collide a lot
+    flathashmultimap<int, int, CollidingHash> map;
+    std::multimap<int, int> ref;
+    map.reserve(64);
+    for (int i = 0; i < 20000; i++) {
+        int key = insecure_rand() % 50;
+        if (insecure_rand() % 3 != 0) {
+            map.insert(key, i);
+            ref.insert(std::make_pair(key, i));
+        } else if (insecure_rand() % 2) {
+            auto range = ref.equal_range(key);
+            if (range.first != range.second) {
+                int value = range.first->second;
+                BOOST_CHECK(map.erase_if(key, [=](int v) { return v == value; }));
+                ref.erase(range.first);
+            } else {
+                BOOST_CHECK(!map.erase_if(key, [](int) { return true; }));
+            }
+        } else {
+            BOOST_CHECK(map.erase(key) == ref.erase(key));
+        }
+        BOOST_CHECK(map.size() == ref.size());
+        auto range = ref.equal_range(key);
+        BOOST_CHECK(map.count(key) == (size_t)std::distance(range.first, range.second));
+        if (range.first != range.second)
+            BOOST_CHECK(map.find(key) != NULL && *map.find(key) == range.first->second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flathashmultiset_test)
+{
+    flathashmultiset<int, CollidingHash> set;
+    set.insert(1);
+    set.insert(8);
+    set.insert(1);
+    BOOST_CHECK(set.size() == 3);
+    BOOST_CHECK(set.count(1) == 2);
+    BOOST_CHECK(set.count(8) == 1);
+    BOOST_CHECK(set.count(15) == 0);
+    BOOST_CHECK(set.erase(1) == 2);
+    BOOST_CHECK(set.count(1) == 0);
+    BOOST_CHECK(set.count(8) == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/Lyra2Z/Lyra2.h"
+#include "crypto/Lyra2Z/Lyra2Z.h"
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <string.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+// Mainnet PoW hashes of heights 1..20499 (primitives/precomputed_hash.txt, same list as primitives/computed.txt)
+#include "primitives/precomputed_hash.raw.h"
+
+BOOST_FIXTURE_TEST_SUITE(lyra2_tests, BasicTestingSetup)
+
+static uint256 Lyra2Z(const std::vector<char>& header, LYRA2_CTX& ctx)
+{
+    uint256 hash;
+    lyra2z_hash_ctx(&ctx, &header[0], (char*)hash.begin());
+    return hash;
+}
+
+static uint256 Lyra2Var(const std::vector<char>& header, uint64_t nRows, LYRA2_CTX& ctx)
+{
+    uint256 hash;
+    BOOST_CHECK_EQUAL(LYRA2_ctx(&ctx, hash.begin(), 32, &header[0], 80, &header[0], 80, 2, nRows, 256), 0);
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_reference_vectors)
+{
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    BOOST_CHECK(spongeSelectImpl(SPONGE_IMPL_GENERIC));
+
+    std::vector<char> header(80, 0);
+    BOOST_CHECK_EQUAL(Lyra2Z(header, ctx).GetHex(), "7d94bea23fed84bcbf6e2b1cf0d1b607fedcda571f103ed778f6c62e26bf639b");
+    for (size_t i = 0; i < header.size(); i++)
+        header[i] = i;
+    BOOST_CHECK_EQUAL(Lyra2Z(header, ctx).GetHex(), "0b1cab5869826a2add7a6cd4a23153e67eb3d9ff4312600ecf273bfb5aed0d6b");
+    BOOST_CHECK_EQUAL(Lyra2Var(header, 500, ctx).GetHex(), "107515bae34b2ee8fc382599806e94fcbcddc823f43aa4c69aa724bfbf1f154c");
+
+    LYRA2_ctx_free(&ctx);
+    spongeAutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(sponge_impl_crosscheck)
+{
+    // Every vectorized sponge this CPU supports must be bit-identical to the generic one.
+    // The 80-byte inputs are built from consecutive mainnet PoW hashes.
+    const size_t nVectors = ARRAYLEN(precomputedPoWHash);
+    const size_t nStep = 7;
+    std::vector<std::vector<char> > headers;
+    for (size_t i = 0; i < nVectors; i += nStep) {
+        std::vector<char> header(80, 0);
+        memcpy(&header[0], precomputedPoWHash[i], 32);
+        memcpy(&header[32], precomputedPoWHash[(i + 1) % nVectors], 32);
+        memcpy(&header[64], precomputedPoWHash[(i + 2) % nVectors], 16);
+        headers.push_back(header);
+    }
+
+    LYRA2_CTX ctx;
+    LYRA2_ctx_init(&ctx);
+    BOOST_CHECK(spongeSelectImpl(SPONGE_IMPL_GENERIC));
+    std::vector<uint256> expected, expectedVar;
+    for (size_t i = 0; i < headers.size(); i++) {
+        expected.push_back(Lyra2Z(headers[i], ctx));
+        // LYRA2VAR: a larger matrix, with rows that are not a power of two
+        if (i % 500 == 0)
+            expectedVar.push_back(Lyra2Var(headers[i], 500 + i / 10, ctx));
+    }
+
+    for (int impl = SPONGE_IMPL_GENERIC + 1; impl < SPONGE_IMPL_COUNT; impl++) {
+        if (!spongeSelectImpl(impl)) {
+            BOOST_TEST_MESSAGE(strprintf("sponge implementation %s not supported here, skipped", spongeImplName(impl)));
+            continue;
+        }
+        size_t nMismatch = 0;
+        for (size_t i = 0; i < headers.size(); i++) {
+            if (Lyra2Z(headers[i], ctx) != expected[i])
+                nMismatch++;
+            if (i % 500 == 0 && Lyra2Var(headers[i], 500 + i / 10, ctx) != expectedVar[i / 500])
+                nMismatch++;
+        }
+        BOOST_CHECK_MESSAGE(nMismatch == 0, strprintf("%s: %u mismatches", spongeImplName(impl), nMismatch));
+    }
+
+    LYRA2_ctx_free(&ctx);
+    spongeAutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_batch_matches_single)
+{
+    // Batches of any size, with every sponge implementation, must give the single-hash results
+    std::vector<std::vector<char> > headers;
+    for (size_t i = 0; i < 3 * LYRA2_MAX_LANES + 1; i++) {
+        std::vector<char> header(80, 0);
+        memcpy(&header[0], precomputedPoWHash[i], 32);
+        memcpy(&header[32], precomputedPoWHash[i + 1], 32);
+        memcpy(&header[64], precomputedPoWHash[i + 2], 16);
+        headers.push_back(header);
+    }
+
+    LYRA2_CTX ctx[LYRA2_MAX_LANES];
+    for (size_t l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_init(&ctx[l]);
+    BOOST_CHECK(spongeSelectImpl(SPONGE_IMPL_GENERIC));
+    std::vector<uint256> expected, expectedVar;
+    for (size_t i = 0; i < headers.size(); i++) {
+        expected.push_back(Lyra2Z(headers[i], ctx[0]));
+        if (i < LYRA2_MAX_LANES)
+            expectedVar.push_back(Lyra2Var(headers[i], 501, ctx[0]));
+    }
+
+    for (int impl = SPONGE_IMPL_GENERIC; impl < SPONGE_IMPL_COUNT; impl++) {
+        if (!spongeSelectImpl(impl))
+            continue;
+        for (size_t n = 1; n <= headers.size(); n++) {
+            std::vector<const char*> input;
+            std::vector<char*> output;
+            std::vector<uint256> hashes(n);
+            for (size_t i = 0; i < n; i++) {
+                input.push_back(&headers[i][0]);
+                output.push_back((char*)hashes[i].begin());
+            }
+            BOOST_CHECK(lyra2z_hash_batch_ctx(ctx, &input[0], &output[0], n) == 0);
+            for (size_t i = 0; i < n; i++)
+                BOOST_CHECK_MESSAGE(hashes[i] == expected[i], strprintf("%s: batch of %u, hash %u", spongeImplName(impl), n, i));
+        }
+
+        const void *pwd[LYRA2_MAX_LANES];
+        void *key[LYRA2_MAX_LANES];
+        uint256 hashes[LYRA2_MAX_LANES];
+        for (size_t i = 0; i < LYRA2_MAX_LANES; i++) {
+            pwd[i] = &headers[i][0];
+            key[i] = hashes[i].begin();
+        }
+        BOOST_CHECK_EQUAL(LYRA2_ctx_batch(ctx, LYRA2_MAX_LANES, key, 32, pwd, 80, pwd, 80, 2, 501, 256), 0);
+        for (size_t i = 0; i < LYRA2_MAX_LANES; i++)
+            BOOST_CHECK_MESSAGE(hashes[i] == expectedVar[i], strprintf("%s: LYRA2 batch hash %u", spongeImplName(impl), i));
+    }
+
+    // The allocating variant
+    std::vector<const char*> input;
+    std::vector<char*> output;
+    std::vector<uint256> hashes(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        input.push_back(&headers[i][0]);
+        output.push_back((char*)hashes[i].begin());
+    }
+    spongeAutoDetect();
+    lyra2z_hash_batch(&input[0], &output[0], headers.size());
+    BOOST_CHECK(hashes == expected);
+
+    for (size_t l = 0; l < LYRA2_MAX_LANES; l++)
+        LYRA2_ctx_free(&ctx[l]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
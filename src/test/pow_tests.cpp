@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "arith_uint256.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "pow.h"
@@ -71,6 +72,68 @@ BOOST_AUTO_TEST_CASE(get_next_work_upper_limit_actual)
     BOOST_CHECK_EQUAL(CalculateNextWorkRequired(&pindexLast, nLastRetargetTime, params), 0x1d00e1fd);
 }
 
+/* Chain with per-block times base + (i * 37) % jitter and targets drifting by 1/128 around bnStart */
+static void BuildRetargetChain(std::vector<CBlockIndex>& blocks, std::vector<uint256>& hashes, uint64_t nSeed,
+                               uint32_t nTimeBase, uint32_t nTimeJitter, const arith_uint256& bnStart)
+{
+    const arith_uint256 bnLimit = ~arith_uint256(0) >> 8;
+    uint32_t nTime = 1475020800;
+    arith_uint256 bnTarget = bnStart;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        hashes[i] = ArithToUint256(arith_uint256(nSeed + i));
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i > 0 ? &blocks[i - 1] : NULL;
+        blocks[i].nHeight = i;
+        nTime += nTimeBase + (i * 37) % nTimeJitter;
+        blocks[i].nTime = nTime;
+        if ((i * 7) % 3)
+            bnTarget += bnTarget >> 7;
+        else
+            bnTarget -= bnTarget >> 7;
+        if (bnTarget > bnLimit)
+            bnTarget = bnLimit;
+        blocks[i].nBits = bnTarget.GetCompact();
+    }
+}
+
+/* Boris's retarget, against the values of its original CBigNum implementation */
+BOOST_AUTO_TEST_CASE(boris_retarget)
+{
+    const arith_uint256 bnLimit = ~arith_uint256(0) >> 8;
+    const int tips[] = {36, 37, 200, 1007, 1500, 2999};
+    struct {
+        uint64_t nSeed;
+        uint32_t nTimeBase;
+        uint32_t nTimeJitter;
+        arith_uint256 bnStart;
+        unsigned int expected[6];
+    } chains[] = {
+        // around the target spacing
+        {1, 60, 121, arith_uint256().SetCompact(0x1d0e7ac9),
+         {0x1d0eba14, 0x1d0eaeb4, 0x1d12d8a1, 0x1d60dbe5, 0x1e0154a2, 0x1e3fb8f4}},
+        // slow blocks at the PoW limit: target * actual time doesn't fit 256 bits
+        {10001, 300, 400, bnLimit,
+         {0x2000ffff, 0x2000ffff, 0x2000ffff, 0x2000ffff, 0x2000ffff, 0x2000ffff}},
+        // fast blocks
+        {20001, 1, 40, arith_uint256().SetCompact(0x1e0fffff),
+         {0x1e0594a9, 0x1e059857, 0x1e0882f0, 0x1e43ec6d, 0x1f00f195, 0x1f2cb3aa}},
+        // erratic, with equal timestamps
+        {30001, 0, 500, arith_uint256().SetCompact(0x1c2a3b4c),
+         {0x1c5805e2, 0x1c596ef1, 0x1d0084de, 0x1d03d722, 0x1d0e0dbc, 0x1e02a35e}},
+    };
+
+    for (size_t c = 0; c < ARRAYLEN(chains); c++) {
+        std::vector<CBlockIndex> blocks(3000);
+        std::vector<uint256> hashes(blocks.size());
+        BuildRetargetChain(blocks, hashes, chains[c].nSeed, chains[c].nTimeBase, chains[c].nTimeJitter, chains[c].bnStart);
+        for (size_t t = 0; t < ARRAYLEN(tips); t++) {
+            // The second call for the same tip is answered from the retarget cache
+            BOOST_CHECK_EQUAL(BorisRidiculouslyNamedDifficultyFunction(&blocks[tips[t]], 120, 36, 1008), chains[c].expected[t]);
+            BOOST_CHECK_EQUAL(BorisRidiculouslyNamedDifficultyFunction(&blocks[tips[t]], 120, 36, 1008), chains[c].expected[t]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
 {
     SelectParams(CBaseChainParams::MAIN);
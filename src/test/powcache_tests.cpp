@@ -0,0 +1,56 @@
+// Copyright (c) 2017 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/powcache.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(powcache_get_insert)
+{
+    CPoWHashCache cache(CPoWHashCache::SHARDS * 4);
+    uint256 hashBlock = GetRandHash();
+    uint256 powHash = GetRandHash();
+    uint256 result;
+
+    BOOST_CHECK(!cache.Get(hashBlock, 100, result));
+    cache.Insert(hashBlock, 100, powHash);
+    BOOST_CHECK(cache.Get(hashBlock, 100, result));
+    BOOST_CHECK(result == powHash);
+
+    // The PoW algorithm depends on the height, a different height must miss
+    BOOST_CHECK(!cache.Get(hashBlock, 101, result));
+
+    CPoWHashCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nSize, 1U);
+    BOOST_CHECK_EQUAL(stats.nHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(powcache_bounded)
+{
+    const size_t nMaxSize = CPoWHashCache::SHARDS * 4;
+    CPoWHashCache cache(nMaxSize);
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < nMaxSize * 10; i++) {
+        vHashes.push_back(GetRandHash());
+        cache.Insert(vHashes.back(), 1, vHashes.back());
+    }
+    BOOST_CHECK(cache.GetStats().nSize <= nMaxSize);
+
+    // The most recent entry is never the one evicted
+    uint256 result;
+    BOOST_CHECK(cache.Get(vHashes.back(), 1, result));
+    BOOST_CHECK(result == vHashes.back());
+
+    cache.SetMaxSize(0);
+    BOOST_CHECK_EQUAL(cache.GetStats().nSize, 0U);
+    cache.Insert(vHashes[0], 1, vHashes[0]);
+    BOOST_CHECK(!cache.Get(vHashes[0], 1, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,60 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "main.h"
+#include "txdb.h"
+#include "uint256.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, TestingSetup)
+
+static CEnodePayeeValue PaymentAt(int nHeight)
+{
+    return CEnodePayeeValue(ArithToUint256(arith_uint256(nHeight)), 15 * COIN);
+}
+
+BOOST_AUTO_TEST_CASE(enode_payee_index)
+{
+    CScript payee1 = CScript() << OP_DUP << OP_HASH160 << vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript payee2 = CScript() << OP_DUP << OP_HASH160 << vector<unsigned char>(20, 2) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    vector<pair<CEnodePayeeKey, CEnodePayeeValue> > list;
+    // Heights around byte boundaries, which a little endian key would misorder
+    const int heights[] = {5, 255, 256, 300, 65536, 70000};
+    for (size_t i = 0; i < sizeof(heights) / sizeof(heights[0]); i++)
+        list.push_back(make_pair(CEnodePayeeKey(payee1, heights[i]), PaymentAt(heights[i])));
+    list.push_back(make_pair(CEnodePayeeKey(payee2, 257), PaymentAt(257)));
+    BOOST_CHECK(pblocktree->WriteEnodePayments(list));
+
+    // Highest first, within the range and the payee
+    vector<pair<int, CEnodePayeeValue> > payments;
+    BOOST_CHECK(pblocktree->ReadEnodePayments(payee1, 69999, 256, payments));
+    BOOST_CHECK_EQUAL(payments.size(), 3U);
+    BOOST_CHECK_EQUAL(payments[0].first, 65536);
+    BOOST_CHECK_EQUAL(payments[1].first, 300);
+    BOOST_CHECK_EQUAL(payments[2].first, 256);
+    BOOST_CHECK(payments[0].second.hashBlock == PaymentAt(65536).hashBlock);
+    BOOST_CHECK_EQUAL(payments[0].second.nAmount, 15 * COIN);
+
+    payments.clear();
+    BOOST_CHECK(pblocktree->ReadEnodePayments(payee2, 100000, 0, payments));
+    BOOST_CHECK_EQUAL(payments.size(), 1U);
+    BOOST_CHECK_EQUAL(payments[0].first, 257);
+
+    // A block reconnected at the same height replaces the entry
+    list.clear();
+    list.push_back(make_pair(CEnodePayeeKey(payee1, 300), CEnodePayeeValue(ArithToUint256(arith_uint256(301)), 15 * COIN)));
+    BOOST_CHECK(pblocktree->WriteEnodePayments(list));
+    payments.clear();
+    BOOST_CHECK(pblocktree->ReadEnodePayments(payee1, 300, 300, payments));
+    BOOST_CHECK_EQUAL(payments.size(), 1U);
+    BOOST_CHECK(payments[0].second.hashBlock == ArithToUint256(arith_uint256(301)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "chain.h"
+#include "main.h"
+#include "random.h"
+#include "txdb.h"
+#include "util.h"
+#include "zerocoin.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(zerocoin_verify_cache)
+{
+    CZerocoinVerifyCache cache;
+    uint256 hashTx = GetRandHash();
+    CBigNum accumulatorValue(12345);
+
+    uint256 entry, other;
+    cache.ComputeEntry(entry, hashTx, 0, libzerocoin::ZQ_LOVELACE, accumulatorValue);
+    BOOST_CHECK(!cache.Get(entry));
+    cache.Set(entry);
+    BOOST_CHECK(cache.Get(entry));
+
+    // Every field is part of the entry
+    cache.ComputeEntry(other, GetRandHash(), 0, libzerocoin::ZQ_LOVELACE, accumulatorValue);
+    BOOST_CHECK(!cache.Get(other));
+    cache.ComputeEntry(other, hashTx, 1, libzerocoin::ZQ_LOVELACE, accumulatorValue);
+    BOOST_CHECK(!cache.Get(other));
+    cache.ComputeEntry(other, hashTx, 0, libzerocoin::ZQ_GOLDWASSER, accumulatorValue);
+    BOOST_CHECK(!cache.Get(other));
+    cache.ComputeEntry(other, hashTx, 0, libzerocoin::ZQ_LOVELACE, accumulatorValue + 1);
+    BOOST_CHECK(!cache.Get(other));
+
+    cache.CountLookup(true);
+    cache.CountLookup(false);
+    cache.CountLookup(false);
+    CZerocoinVerifyCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nSize, 1U);
+    BOOST_CHECK_EQUAL(stats.nHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_verify_cache_eviction)
+{
+    mapArgs["-zcverifycachesize"] = "1";
+    CZerocoinVerifyCache cache;
+    CBigNum accumulatorValue(12345);
+
+    // Far more entries than fit in 1 MiB
+    const unsigned int nEntries = 100000;
+    uint256 entry;
+    for (unsigned int i = 0; i < nEntries; i++) {
+        cache.ComputeEntry(entry, GetRandHash(), i, libzerocoin::ZQ_LOVELACE, accumulatorValue);
+        cache.Set(entry);
+    }
+    CZerocoinVerifyCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nMaxUsage, (size_t)1 << 20);
+    BOOST_CHECK(stats.nSize > 0 && stats.nSize < nEntries);
+    // The last entry is never the one evicted
+    BOOST_CHECK(cache.Get(entry));
+
+    // A size of 0 disables the cache
+    mapArgs["-zcverifycachesize"] = "0";
+    CZerocoinVerifyCache cacheDisabled;
+    cacheDisabled.ComputeEntry(entry, GetRandHash(), 0, libzerocoin::ZQ_LOVELACE, accumulatorValue);
+    cacheDisabled.Set(entry);
+    BOOST_CHECK(!cacheDisabled.Get(entry));
+    BOOST_CHECK_EQUAL(cacheDisabled.GetStats().nSize, 0U);
+
+    mapArgs.erase("-zcverifycachesize");
+}
+
+BOOST_FIXTURE_TEST_CASE(zerocoin_block_data_cache, TestingSetup)
+{
+    uint256 hash = GetRandHash();
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nHeight = 1;
+    CZerocoinBlockData data;
+    data.spentSerials.insert(CBigNum(12345));
+
+    // Kept in memory until it is written with the block index
+    CZerocoinBlockDataCache cache;
+    cache.Put(&index, data);
+    BOOST_CHECK(index.nStatus & BLOCK_HAVE_ZEROCOIN);
+    CZerocoinBlockData stored;
+    BOOST_CHECK(!pblocktree->ReadZerocoinBlockData(&index, stored));
+    CZerocoinBlockDataCache::DataPtr cached = cache.Get(&index);
+    BOOST_CHECK(cached && cached->spentSerials == data.spentSerials);
+
+    std::vector<std::pair<const CBlockIndex*, CZerocoinBlockDataCache::DataPtr> > vDirty;
+    cache.TakeDirty(vDirty);
+    BOOST_CHECK_EQUAL(vDirty.size(), 1U);
+    BOOST_CHECK(vDirty[0].first == &index);
+    std::vector<std::pair<const CBlockIndex*, const CZerocoinBlockData*> > vData(1, std::make_pair(&index, vDirty[0].second.get()));
+    BOOST_CHECK(pblocktree->WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0,
+                                           std::vector<const CBlockIndex*>(), vData));
+    BOOST_CHECK(pblocktree->ReadZerocoinBlockData(&index, stored));
+    BOOST_CHECK(stored.spentSerials == data.spentSerials);
+    cache.TakeDirty(vDirty);
+    BOOST_CHECK(vDirty.empty());
+    cache.Clear();
+    cached = cache.Get(&index);
+    BOOST_CHECK(cached && cached->spentSerials == data.spentSerials);
+
+    // Missing data is reported to the caller
+    uint256 hashMissing = GetRandHash();
+    CBlockIndex indexMissing;
+    indexMissing.phashBlock = &hashMissing;
+    indexMissing.nStatus |= BLOCK_HAVE_ZEROCOIN;
+    BOOST_CHECK(!cache.Get(&indexMissing));
+
+    // A block without zerocoin transactions
+    cache.Put(&indexMissing, CZerocoinBlockData());
+    BOOST_CHECK(!(indexMissing.nStatus & BLOCK_HAVE_ZEROCOIN));
+    cached = cache.Get(&indexMissing);
+    BOOST_CHECK(cached && cached->IsNull());
+    cache.TakeDirty(vDirty);
+    BOOST_CHECK(vDirty.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "main.h"
+#include "random.h"
+#include "znode.h"
+#include "znodeman.h"
+#include "test/test_bitcoin.h"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(znodeman_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(enode_collateral_events)
+{
+    CMutableTransaction txCollateral;
+    txCollateral.vin.push_back(CTxIn(GetRandHash(), 0));
+    txCollateral.vout.resize(2);
+    CTxIn vin1(txCollateral.GetHash(), 0);
+    CTxIn vin2(txCollateral.GetHash(), 1);
+
+    CEnode mn1(CService(), vin1, CPubKey(), CPubKey(), PROTOCOL_VERSION);
+    CEnode mn2(CService(), vin2, CPubKey(), CPubKey(), PROTOCOL_VERSION);
+    mn1.fCollateralChecked = true;
+    mn2.fCollateralChecked = true;
+    BOOST_CHECK(mnodeman.Add(mn1));
+    BOOST_CHECK(mnodeman.Add(mn2));
+
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(vin1);
+    txSpend.vout.resize(1);
+    CBlock block;
+
+    // Spends only count once they are in a block
+    mnodeman.SyncTransaction(txSpend, NULL, NULL);
+    BOOST_CHECK_EQUAL(mnodeman.GetEnodeState(vin1), CEnode::ENODE_ENABLED);
+    mnodeman.SyncTransaction(txSpend, chainActive.Tip(), &block);
+    BOOST_CHECK_EQUAL(mnodeman.GetEnodeState(vin1), CEnode::ENODE_OUTPOINT_SPENT);
+    BOOST_CHECK_EQUAL(mnodeman.GetEnodeState(vin2), CEnode::ENODE_ENABLED);
+
+    // Disconnecting the collateral transaction makes the next check look the collateral up
+    CEnode mn;
+    BOOST_CHECK(mnodeman.Get(vin2, mn) && mn.fCollateralChecked);
+    mnodeman.SyncTransaction(txCollateral, chainActive.Tip(), NULL);
+    BOOST_CHECK(mnodeman.Get(vin2, mn) && !mn.fCollateralChecked);
+    BOOST_CHECK_EQUAL(mnodeman.GetEnodeState(vin2), CEnode::ENODE_ENABLED);
+
+    mnodeman.Clear();
+}
+
+// The Enode GetNextEnodeInQueueForPayment has to pick, from sorting all of them
+static CEnode* NextInQueueReference(std::vector<CEnode*> vecEnodes, int nBlockHeight)
+{
+    std::vector<std::pair<int, CEnode*> > vecLastPaid;
+    BOOST_FOREACH(CEnode* pmn, vecEnodes) {
+        if (pmn->IsValidForPayment())
+            vecLastPaid.push_back(std::make_pair(pmn->GetLastPaidBlock(), pmn));
+    }
+    std::sort(vecLastPaid.begin(), vecLastPaid.end(), [](const std::pair<int, CEnode*>& a, const std::pair<int, CEnode*>& b) {
+        return a.first != b.first ? a.first < b.first : a.second->vin < b.second->vin;
+    });
+    uint256 blockHash;
+    BOOST_CHECK(GetBlockHash(blockHash, nBlockHeight - 101));
+    CEnode* pBest = NULL;
+    arith_uint256 nHighest = 0;
+    for (size_t i = 0; i < vecLastPaid.size() && i < std::max<size_t>(vecLastPaid.size() / 10, 1); i++) {
+        arith_uint256 nScore = vecLastPaid[i].second->CalculateScore(blockHash);
+        if (nScore > nHighest) {
+            nHighest = nScore;
+            pBest = vecLastPaid[i].second;
+        }
+    }
+    return pBest;
+}
+
+BOOST_AUTO_TEST_CASE(enode_payment_queue)
+{
+    // Only the genesis block is there, the scores use its hash
+    const int nBlockHeight = 101;
+    const int nEnodes = 40;
+
+    std::vector<CEnode*> vecEnodes;
+    for (int i = 0; i < nEnodes; i++) {
+        CEnode mn(CService(), CTxIn(GetRandHash(), 0), CPubKey(), CPubKey(), PROTOCOL_VERSION);
+        mn.sigTime -= 30 * 24 * 60 * 60;
+        mn.nCacheCollateralBlock = -1000;
+        mn.nBlockLastPaid = (i * 7) % 13;
+        BOOST_CHECK(mnodeman.Add(mn));
+        vecEnodes.push_back(mnodeman.Find(mn.vin));
+    }
+
+    int nCount;
+    CEnode* pmn = mnodeman.GetNextEnodeInQueueForPayment(nBlockHeight, true, nCount);
+    BOOST_CHECK(pmn != NULL && pmn == NextInQueueReference(vecEnodes, nBlockHeight));
+    BOOST_CHECK_EQUAL(mnodeman.CountQualifiedForPayment(true), nEnodes);
+
+    // An Enode that can't be paid anymore leaves the queue
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(pmn->vin);
+    CBlock block;
+    mnodeman.SyncTransaction(txSpend, chainActive.Tip(), &block);
+    CEnode* pmnNext = mnodeman.GetNextEnodeInQueueForPayment(nBlockHeight, true, nCount);
+    BOOST_CHECK(pmnNext != NULL && pmnNext != pmn && pmnNext == NextInQueueReference(vecEnodes, nBlockHeight));
+    BOOST_CHECK_EQUAL(mnodeman.CountQualifiedForPayment(true), nEnodes - 1);
+
+    mnodeman.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
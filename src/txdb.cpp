@@ -20,6 +20,9 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_ZEROCOIN_BLOCK = 'z';
+static const char DB_ZEROCOIN_GROUP = 'Z';
+static const char DB_ENODE_PAYEE = 'e';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -136,7 +139,22 @@ void CCoinsViewDBCursor::Next()
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+/**
+ * The zerocoin data of a block is split in one entry per coin group keyed by
+ * (denomination, id, height, block hash) and an entry listing the groups and the
+ * spent serials, keyed by block hash.
+ */
+static void WriteZerocoinBlockData(CDBBatch &batch, const CBlockIndex *pindex, const CZerocoinBlockData &data) {
+    std::vector<std::pair<int,int> > groups;
+    for (std::map<std::pair<int,int>, CZerocoinGroupChange>::const_iterator it = data.groups.begin(); it != data.groups.end(); it++) {
+        batch.Write(make_pair(DB_ZEROCOIN_GROUP, make_pair(it->first, make_pair(pindex->nHeight, pindex->GetBlockHash()))), it->second);
+        groups.push_back(it->first);
+    }
+    batch.Write(make_pair(DB_ZEROCOIN_BLOCK, pindex->GetBlockHash()), make_pair(groups, data.spentSerials));
+}
+
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                                  const std::vector<std::pair<const CBlockIndex*, const CZerocoinBlockData*> >& zerocoinData) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(make_pair(DB_BLOCK_FILES, it->first), *it->second);
@@ -145,6 +163,9 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
+    for (std::vector<std::pair<const CBlockIndex*, const CZerocoinBlockData*> >::const_iterator it=zerocoinData.begin(); it != zerocoinData.end(); it++) {
+        ::WriteZerocoinBlockData(batch, it->first, *it->second);
+    }
     return WriteBatch(batch, true);
 }
 
@@ -171,6 +192,45 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::ReadZerocoinBlockData(const CBlockIndex *pindex, CZerocoinBlockData &data) {
+    std::pair<std::vector<std::pair<int,int> >, std::set<CBigNum> > blockEntry;
+    if (!Read(make_pair(DB_ZEROCOIN_BLOCK, pindex->GetBlockHash()), blockEntry))
+        return false;
+
+    data.groups.clear();
+    data.spentSerials.swap(blockEntry.second);
+    BOOST_FOREACH(const PAIRTYPE(int,int) &group, blockEntry.first) {
+        if (!Read(make_pair(DB_ZEROCOIN_GROUP, make_pair(group, make_pair(pindex->nHeight, pindex->GetBlockHash()))), data.groups[group]))
+            return false;
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteEnodePayments(const std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> > &list) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> >::const_iterator it=list.begin(); it!=list.end(); it++)
+        batch.Write(make_pair(DB_ENODE_PAYEE, it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadEnodePayments(const CScript &payee, int nMaxHeight, int nMinHeight, std::vector<std::pair<int, CEnodePayeeValue> > &payments) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_ENODE_PAYEE, CEnodePayeeKey(payee, nMaxHeight)));
+
+    while (pcursor->Valid()) {
+        std::pair<char, CEnodePayeeKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ENODE_PAYEE || key.second.payee != payee || key.second.nHeight < nMinHeight)
+            break;
+        CEnodePayeeValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read value", __func__);
+        payments.push_back(make_pair(key.second.nHeight, value));
+        pcursor->Next();
+    }
+    return true;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     LogPrintf("CBlockTreeDB::LoadBlockIndexGuts\n");
@@ -178,6 +238,10 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Entries written before the zerocoin data moved out of the block index are rewritten
+    CDBBatch batchMigrate(*this);
+    unsigned int nMigrate = 0, nMigrated = 0;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -199,13 +263,32 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
-
-                pindexNew->accumulatorChanges = diskindex.accumulatorChanges;
-                pindexNew->mintedPubCoins     = diskindex.mintedPubCoins;
-                pindexNew->spentSerials       = diskindex.spentSerials;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+                pindexNew->powHash        = diskindex.powHash;
+
+                if (!diskindex.mintedPubCoins.empty() || !diskindex.accumulatorChanges.empty() || !diskindex.spentSerials.empty()) {
+                    CZerocoinBlockData zerocoinData;
+                    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), PAIRTYPE(CBigNum,int)) &accChange, diskindex.accumulatorChanges) {
+                        CZerocoinGroupChange &groupChange = zerocoinData.groups[accChange.first];
+                        groupChange.pubCoins = diskindex.mintedPubCoins[accChange.first];
+                        groupChange.accumulatorValue = accChange.second.first;
+                        groupChange.nMints = accChange.second.second;
+                    }
+                    zerocoinData.spentSerials = diskindex.spentSerials;
+
+                    pindexNew->nStatus |= BLOCK_HAVE_ZEROCOIN;
+                    ::WriteZerocoinBlockData(batchMigrate, pindexNew, zerocoinData);
+                    batchMigrate.Write(make_pair(DB_BLOCK_INDEX, pindexNew->GetBlockHash()), CDiskBlockIndex(pindexNew));
+                    if (++nMigrate == 1000) {
+                        if (!WriteBatch(batchMigrate))
+                            return error("LoadBlockIndex() : failed to move zerocoin data");
+                        batchMigrate.Clear();
+                        nMigrated += nMigrate;
+                        nMigrate = 0;
+                    }
+                }
+
+                // Proof of work is verified in LoadBlockIndexDB once heights are known, entries
+                // without a stored PoW hash (no BLOCK_HAVE_POWHASH) are hashed there and rewritten.
 
                 pcursor->Next();
             } else {
@@ -216,6 +299,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
         }
     }
 
+    if (nMigrate > 0 && !WriteBatch(batchMigrate, true))
+        return error("LoadBlockIndex() : failed to move zerocoin data");
+    nMigrated += nMigrate;
+    if (nMigrated > 0)
+        LogPrintf("CBlockTreeDB::LoadBlockIndexGuts: moved zerocoin data of %u blocks out of the block index\n", nMigrated);
+
     return true;
 }
 
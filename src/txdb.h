@@ -7,8 +7,10 @@
 #define BITCOIN_TXDB_H
 
 #include "coins.h"
+#include "crypto/common.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "script/script.h"
 
 #include <map>
 #include <string>
@@ -61,6 +63,57 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
+/**
+ * Key of a coinbase output paying an enode. The height is stored big endian and inverted,
+ * so that the payments to a script are ordered from the highest height down.
+ */
+struct CEnodePayeeKey
+{
+    CScript payee;
+    int nHeight;
+
+    CEnodePayeeKey() : nHeight(0) {}
+    CEnodePayeeKey(const CScript &payeeIn, int nHeightIn) : payee(payeeIn), nHeight(nHeightIn) {}
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return ::GetSerializeSize(*(const CScriptBase*)&payee, nType, nVersion) + 4;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ::Serialize(s, *(const CScriptBase*)&payee, nType, nVersion);
+        unsigned char buf[4];
+        WriteBE32(buf, ~(uint32_t)nHeight);
+        s.write((const char*)buf, sizeof(buf));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        ::Unserialize(s, *(CScriptBase*)&payee, nType, nVersion);
+        unsigned char buf[4];
+        s.read((char*)buf, sizeof(buf));
+        nHeight = (int)~ReadBE32(buf);
+    }
+};
+
+/** Enode payment of a block, the block hash tells stale entries apart after a crash */
+struct CEnodePayeeValue
+{
+    uint256 hashBlock;
+    CAmount nAmount;
+
+    CEnodePayeeValue() : nAmount(0) {}
+    CEnodePayeeValue(const uint256 &hashBlockIn, CAmount nAmountIn) : hashBlock(hashBlockIn), nAmount(nAmountIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(nAmount);
+    }
+};
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
@@ -107,7 +160,8 @@ private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
 public:
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                        const std::vector<std::pair<const CBlockIndex*, const CZerocoinBlockData*> >& zerocoinData);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
@@ -116,6 +170,10 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    bool ReadZerocoinBlockData(const CBlockIndex *pindex, CZerocoinBlockData &data);
+    bool WriteEnodePayments(const std::vector<std::pair<CEnodePayeeKey, CEnodePayeeValue> > &list);
+    //! Payments to payee at heights from nMaxHeight down to nMinHeight, highest first
+    bool ReadEnodePayments(const CScript &payee, int nMaxHeight, int nMinHeight, std::vector<std::pair<int, CEnodePayeeValue> > &payments);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 	int GetBlockIndexVersion();
 };
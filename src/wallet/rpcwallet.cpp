@@ -2643,44 +2643,40 @@ UniValue listunspentmintzerocoins(const UniValue &params, bool fHelp) {
     return results;
 }
 
-UniValue mintzerocoin(const UniValue& params, bool fHelp)
+// Zerocoin denomination of an amount given to the mint RPCs, false if no denomination has that value
+static bool ParseZerocoinDenomination(const UniValue& value, libzerocoin::CoinDenomination& denomination, int64_t& nAmount)
 {
-
-    if (fHelp || params.size() > 1)
-        throw runtime_error("mintzerocoin <amount>(1,10,25,50,100)\n" + HelpRequiringPassphrase());
-
-    int64_t nAmount = 0;
-    libzerocoin::CoinDenomination denomination;
-    // Amount
-    if (params[0].get_real() == 1.0) {
+    if (value.get_real() == 1.0) {
         denomination = libzerocoin::ZQ_LOVELACE;
-        nAmount = AmountFromValue(params[0]);
-    } else if (params[0].get_real() == 10.0) {
+    } else if (value.get_real() == 10.0) {
         denomination = libzerocoin::ZQ_GOLDWASSER;
-        nAmount = AmountFromValue(params[0]);
-    } else if (params[0].get_real() == 25.0) {
+    } else if (value.get_real() == 25.0) {
         denomination = libzerocoin::ZQ_RACKOFF;
-        nAmount = AmountFromValue(params[0]);
-    } else if (params[0].get_real() == 50.0) {
+    } else if (value.get_real() == 50.0) {
         denomination = libzerocoin::ZQ_PEDERSEN;
-        nAmount = AmountFromValue(params[0]);
-    } else if (params[0].get_real() == 100.0) {
+    } else if (value.get_real() == 100.0) {
         denomination = libzerocoin::ZQ_WILLIAMSON;
-        nAmount = AmountFromValue(params[0]);
     } else {
-        throw runtime_error("mintzerocoin <amount>(1,10,25,50,100)\n");
+        return false;
     }
-    LogPrintf("rpcWallet.mintzerocoin() denomination = %s, nAmount = %s \n", denomination, nAmount);
+    nAmount = AmountFromValue(value);
+    return true;
+}
 
+UniValue mintzerocoin(const UniValue& params, bool fHelp)
+{
+
+    if (fHelp || params.size() > 1)
+        throw runtime_error("mintzerocoin <amount>(1,10,25,50,100)\n" + HelpRequiringPassphrase());
 
-    // zerocoin init
-    CBigNum bnTrustedModulus;
+    int64_t nAmount = 0;
+    libzerocoin::CoinDenomination denomination;
+    if (!ParseZerocoinDenomination(params[0], denomination, nAmount))
+        throw runtime_error("mintzerocoin <amount>(1,10,25,50,100)\n");
+    LogPrintf("rpcWallet.mintzerocoin() denomination = %s, nAmount = %s \n", denomination, nAmount);
 
-    // Loads a trusted Zerocoin modulus "N"
-    bnTrustedModulus.SetHex(ZEROCOIN_MODULUS);
 
-    // Set up the Zerocoin Params object
-    libzerocoin::Params *ZCParams = new libzerocoin::Params(bnTrustedModulus);
+    const libzerocoin::Params *ZCParams = GetZerocoinParams();
 
     // The following constructor does all the work of minting a brand
     // new zerocoin. It stores all the private values inside the
@@ -2728,6 +2724,72 @@ UniValue mintzerocoin(const UniValue& params, bool fHelp)
 
 }
 
+UniValue mintmanyzerocoin(const UniValue& params, bool fHelp)
+{
+
+    if (fHelp || params.size() != 2)
+        throw runtime_error("mintmanyzerocoin <amount>(1,10,25,50,100) <count>\n"
+                            "Mint count coins of the same denomination in a single transaction.\n"
+                            "The coins are minted on all the cores of the machine.\n" + HelpRequiringPassphrase());
+
+    int64_t nAmount = 0;
+    libzerocoin::CoinDenomination denomination;
+    if (!ParseZerocoinDenomination(params[0], denomination, nAmount))
+        throw runtime_error("mintmanyzerocoin <amount>(1,10,25,50,100) <count>\n");
+
+    int nCount = params[1].get_int();
+    if (nCount < 1 || nCount > ZC_MAX_MINTS_PER_TX)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid count, must be between 1 and %d", ZC_MAX_MINTS_PER_TX));
+    LogPrintf("rpcWallet.mintmanyzerocoin() denomination = %s, nAmount = %s, count = %d\n", denomination, nAmount, nCount);
+
+    // Minting takes a while, don't do it for a locked wallet
+    if (pwalletMain->IsLocked())
+        throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
+
+    vector<libzerocoin::PrivateCoin> newCoins;
+    try {
+        newCoins = libzerocoin::PrivateCoin::MintCoins(GetZerocoinParams(), nCount, denomination, ZEROCOIN_TX_VERSION_2);
+    } catch (const std::exception &e) {
+        throw JSONRPCError(RPC_WALLET_ERROR, e.what());
+    }
+
+    vector<CRecipient> vecSend;
+    BOOST_FOREACH(const libzerocoin::PrivateCoin &newCoin, newCoins) {
+        const libzerocoin::PublicCoin &pubCoin = newCoin.getPublicCoin();
+        if (!pubCoin.validate())
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error: Minted an invalid coin");
+        CScript scriptSerializedCoin =
+                CScript() << OP_ZEROCOINMINT << pubCoin.getValue().getvch().size() << pubCoin.getValue().getvch();
+        CRecipient recipient = {scriptSerializedCoin, nAmount, false};
+        vecSend.push_back(recipient);
+    }
+
+    // Wallet comments
+    CWalletTx wtx;
+
+    string strError = pwalletMain->MintZerocoin(vecSend, wtx);
+
+    if (strError != "")
+        throw JSONRPCError(RPC_WALLET_ERROR, strError);
+
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    UniValue results(UniValue::VARR);
+    BOOST_FOREACH(const libzerocoin::PrivateCoin &newCoin, newCoins) {
+        const unsigned char *ecdsaSecretKey = newCoin.getEcdsaSeckey();
+        CZerocoinEntry zerocoinTx;
+        zerocoinTx.IsUsed = false;
+        zerocoinTx.denomination = denomination;
+        zerocoinTx.value = newCoin.getPublicCoin().getValue();
+        zerocoinTx.randomness = newCoin.getRandomness();
+        zerocoinTx.serialNumber = newCoin.getSerialNumber();
+        zerocoinTx.ecdsaSecretKey = std::vector<unsigned char>(ecdsaSecretKey, ecdsaSecretKey+32);
+        walletdb.WriteZerocoinEntry(zerocoinTx);
+        results.push_back(zerocoinTx.value.GetHex());
+    }
+
+    return results;
+}
+
 UniValue spendzerocoin(const UniValue& params, bool fHelp) {
 
     if (fHelp || params.size() > 1)
@@ -3043,6 +3105,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "setmininput",              &setmininput,              false },
     { "wallet",             "listunspentmintzerocoins",             &listunspentmintzerocoins,             false },
     { "wallet",             "mintzerocoin",             &mintzerocoin,             false },
+    { "wallet",             "mintmanyzerocoin",         &mintmanyzerocoin,         false },
     { "wallet",             "spendzerocoin",            &spendzerocoin,            false },
     { "wallet",             "resetmintzerocoin",        &resetmintzerocoin,        false },
     { "wallet",             "setmintzerocoinstatus",        &setmintzerocoinstatus,        false },
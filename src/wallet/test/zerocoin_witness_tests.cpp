@@ -0,0 +1,261 @@
+// Copyright (c) 2018 The Eledger Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "main.h"
+#include "random.h"
+#include "zerocoin.h"
+#include "wallet/wallet.h"
+#include "wallet/walletdb.h"
+#include "wallet/test/wallet_test_fixture.h"
+
+#include <deque>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const int denomination = libzerocoin::ZQ_LOVELACE;
+
+/** Blocks with zerocoin mints on top of the genesis block, connected to the zerocoin state without validation */
+struct ZerocoinWitnessTestingSetup : public WalletTestingSetup {
+    CZerocoinState *zerocoinState;
+    CBlockIndex *pindexGenesis;
+    deque<uint256> hashes;
+    deque<CBlockIndex> blocks;
+
+    ZerocoinWitnessTestingSetup() {
+        zerocoinState = CZerocoinState::GetZerocoinState();
+        zerocoinState->Reset();
+        pindexGenesis = chainActive.Tip();
+    }
+
+    ~ZerocoinWitnessTestingSetup() {
+        chainActive.SetTip(pindexGenesis);
+        vector<pair<const CBlockIndex *, CZerocoinBlockDataCache::DataPtr> > vDirty;
+        zerocoinState->TakeDirtyBlockData(vDirty);
+        zerocoinState->Reset();
+    }
+
+    static CBigNum EmptyAccumulator() {
+        return libzerocoin::Accumulator(GetZerocoinParams(), (libzerocoin::CoinDenomination)denomination).getValue();
+    }
+
+    static CBigNum RandomCoin() {
+        return CBigNum::randBignum(GetZerocoinParams()->accumulatorParams.maxCoinValue);
+    }
+
+    // Block on top of pprev minting the coins into group 1
+    CBlockIndex *CreateBlock(CBlockIndex *pprev, const vector<CBigNum> &mints = vector<CBigNum>()) {
+        hashes.push_back(GetRandHash());
+        blocks.emplace_back();
+        CBlockIndex *pindex = &blocks.back();
+        pindex->phashBlock = &hashes.back();
+        pindex->pprev = pprev;
+        pindex->nHeight = pprev->nHeight + 1;
+        pindex->BuildSkip();
+
+        CZerocoinBlockData data;
+        if (!mints.empty()) {
+            CBigNum accumulatorValue = EmptyAccumulator();
+            for (CBlockIndex *pindexPrev = pprev; pindexPrev != NULL; pindexPrev = pindexPrev->pprev) {
+                CZerocoinBlockDataCache::DataPtr prevData = zerocoinState->GetBlockData(pindexPrev);
+                BOOST_REQUIRE(prevData);
+                if (prevData->groups.count(make_pair(denomination, 1))) {
+                    accumulatorValue = prevData->groups.at(make_pair(denomination, 1)).accumulatorValue;
+                    break;
+                }
+            }
+            CZerocoinGroupChange &change = data.groups[make_pair(denomination, 1)];
+            change.pubCoins = mints;
+            change.nMints = mints.size();
+            change.accumulatorValue = CZerocoinState::AccumulateCoins(accumulatorValue, denomination, mints);
+        }
+        zerocoinState->SetBlockData(pindex, data);
+        return pindex;
+    }
+
+    CBlockIndex *CreateBlocks(CBlockIndex *pprev, int nBlocks) {
+        for (int i = 0; i < nBlocks; i++)
+            pprev = CreateBlock(pprev);
+        return pprev;
+    }
+
+    // Reorganize the chain and the zerocoin state to pindexNew
+    void Connect(CBlockIndex *pindexNew) {
+        LOCK(cs_main);
+        const CBlockIndex *pindexFork = chainActive.FindFork(pindexNew);
+        for (CBlockIndex *pindex = chainActive.Tip(); pindex != pindexFork; pindex = pindex->pprev)
+            BOOST_REQUIRE(zerocoinState->RemoveBlock(pindex));
+        vector<CBlockIndex *> vConnect;
+        for (CBlockIndex *pindex = pindexNew; pindex != pindexFork; pindex = pindex->pprev)
+            vConnect.push_back(pindex);
+        for (vector<CBlockIndex *>::reverse_iterator it = vConnect.rbegin(); it != vConnect.rend(); ++it)
+            BOOST_REQUIRE(zerocoinState->AddBlock(*it));
+        chainActive.SetTip(pindexNew);
+    }
+
+    int MaxSpendHeight() {
+        LOCK(cs_main);
+        return chainActive.Height() - (ZC_MINT_CONFIRMATIONS - 1);
+    }
+
+    void AddMint(const CBigNum &pubCoin) {
+        CZerocoinEntry entry;
+        entry.value = pubCoin;
+        entry.denomination = denomination;
+        entry.randomness = 1;
+        entry.serialNumber = 1;
+        BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).WriteZerocoinEntry(entry));
+    }
+
+    bool ReadWitness(const CBigNum &pubCoin, CZerocoinWitnessEntry &entry) {
+        return CWalletDB(pwalletMain->strWalletFile).ReadZerocoinWitness(pubCoin, entry);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_witness_tests, ZerocoinWitnessTestingSetup)
+
+BOOST_AUTO_TEST_CASE(zerocoin_witness_persistence)
+{
+    CBigNum coin = RandomCoin(), other = RandomCoin();
+    vector<CBigNum> mints;
+    mints.push_back(coin);
+    mints.push_back(other);
+    CBlockIndex *pindexMint = CreateBlock(pindexGenesis, mints);
+    Connect(CreateBlocks(pindexMint, ZC_MINT_CONFIRMATIONS - 1));
+    AddMint(coin);
+
+    CZerocoinWitnessEntry entry;
+    BOOST_CHECK(!ReadWitness(coin, entry));
+
+    // The witness a spend computes is stored for the next one
+    CBigNum witness;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(pwalletMain->GetZerocoinWitness(MaxSpendHeight(), denomination, 1, coin, witness));
+    }
+    BOOST_CHECK(witness == CZerocoinState::AccumulateCoins(EmptyAccumulator(), denomination, vector<CBigNum>(1, other)));
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK(entry.pubCoin == coin);
+    BOOST_CHECK_EQUAL(entry.denomination, denomination);
+    BOOST_CHECK_EQUAL(entry.id, 1);
+    BOOST_CHECK(entry.witness == witness);
+    BOOST_CHECK_EQUAL(entry.nHeight, pindexMint->nHeight);
+    BOOST_CHECK(entry.blockHash == pindexMint->GetBlockHash());
+
+    // And the stored one is returned when nothing was minted since
+    Connect(CreateBlocks(chainActive.Tip(), 3));
+    CBigNum witnessCached;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(pwalletMain->GetZerocoinWitness(MaxSpendHeight(), denomination, 1, coin, witnessCached));
+    }
+    BOOST_CHECK(witnessCached == witness);
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK_EQUAL(entry.nHeight, MaxSpendHeight());
+    BOOST_CHECK(entry.blockHash == chainActive[MaxSpendHeight()]->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_witness_advance)
+{
+    CBigNum coin = RandomCoin(), other1 = RandomCoin(), other2 = RandomCoin();
+    vector<CBigNum> mints;
+    mints.push_back(coin);
+    mints.push_back(other1);
+    Connect(CreateBlocks(CreateBlock(pindexGenesis, mints), ZC_MINT_CONFIRMATIONS - 1));
+    AddMint(coin);
+
+    pwalletMain->UpdateZerocoinWitnesses();
+    CZerocoinWitnessEntry entry;
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK_EQUAL(entry.nHeight, MaxSpendHeight());
+    CBigNum witnessBefore = entry.witness;
+
+    // A coin minted later is accumulated into the stored witness once it can be spent with
+    CBlockIndex *pindexMint = CreateBlock(chainActive.Tip(), vector<CBigNum>(1, other2));
+    Connect(CreateBlocks(pindexMint, ZC_MINT_CONFIRMATIONS - 2));
+    pwalletMain->UpdateZerocoinWitnesses();
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK(entry.witness == witnessBefore);
+    Connect(CreateBlock(chainActive.Tip()));
+    pwalletMain->UpdateZerocoinWitnesses();
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK_EQUAL(entry.nHeight, pindexMint->nHeight);
+    BOOST_CHECK(entry.blockHash == pindexMint->GetBlockHash());
+
+    vector<CBigNum> others;
+    others.push_back(other1);
+    others.push_back(other2);
+    BOOST_CHECK(entry.witness == CZerocoinState::AccumulateCoins(EmptyAccumulator(), denomination, others));
+    CBigNum witness;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(zerocoinState->GetWitnessForSpend(&chainActive, MaxSpendHeight(), denomination, 1, coin, witness));
+    }
+    BOOST_CHECK(entry.witness == witness);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_witness_reorg)
+{
+    CBigNum coin = RandomCoin(), other1 = RandomCoin(), other2 = RandomCoin(), other3 = RandomCoin();
+    vector<CBigNum> mints;
+    mints.push_back(coin);
+    mints.push_back(other1);
+    CBlockIndex *pindexFork = CreateBlocks(CreateBlock(pindexGenesis, mints), ZC_MINT_CONFIRMATIONS - 1);
+    CBlockIndex *pindexStale = CreateBlock(pindexFork, vector<CBigNum>(1, other2));
+    Connect(CreateBlocks(pindexStale, ZC_MINT_CONFIRMATIONS - 1));
+    AddMint(coin);
+
+    pwalletMain->UpdateZerocoinWitnesses();
+    CZerocoinWitnessEntry entry;
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK(entry.blockHash == pindexStale->GetBlockHash());
+
+    // The block the witness was computed for is replaced, the witness is dropped
+    CBlockIndex *pindexReplacing = CreateBlock(pindexFork, vector<CBigNum>(1, other3));
+    Connect(CreateBlocks(pindexReplacing, ZC_MINT_CONFIRMATIONS));
+    pwalletMain->UpdateZerocoinWitnesses();
+    BOOST_CHECK(!ReadWitness(coin, entry));
+
+    // The next spend computes it for the new chain
+    CBigNum witness;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(pwalletMain->GetZerocoinWitness(MaxSpendHeight(), denomination, 1, coin, witness));
+    }
+    vector<CBigNum> others;
+    others.push_back(other1);
+    others.push_back(other3);
+    BOOST_CHECK(witness == CZerocoinState::AccumulateCoins(EmptyAccumulator(), denomination, others));
+    BOOST_CHECK(ReadWitness(coin, entry));
+    BOOST_CHECK(entry.blockHash == chainActive[MaxSpendHeight()]->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_witness_used_coin)
+{
+    CBigNum coin = RandomCoin(), other1 = RandomCoin(), other2 = RandomCoin();
+    vector<CBigNum> mints;
+    mints.push_back(coin);
+    mints.push_back(other1);
+    Connect(CreateBlocks(CreateBlock(pindexGenesis, mints), ZC_MINT_CONFIRMATIONS - 1));
+    AddMint(coin);
+
+    pwalletMain->UpdateZerocoinWitnesses();
+    CZerocoinWitnessEntry entry;
+    BOOST_CHECK(ReadWitness(coin, entry));
+
+    // Marked used outside the spend paths, as a rescan does
+    list<CZerocoinEntry> listPubCoin;
+    CWalletDB(pwalletMain->strWalletFile).ListPubCoin(listPubCoin);
+    BOOST_REQUIRE_EQUAL(listPubCoin.size(), 1U);
+    listPubCoin.front().IsUsed = true;
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).WriteZerocoinEntry(listPubCoin.front()));
+
+    Connect(CreateBlocks(CreateBlock(chainActive.Tip(), vector<CBigNum>(1, other2)), ZC_MINT_CONFIRMATIONS - 1));
+    pwalletMain->UpdateZerocoinWitnesses();
+    BOOST_CHECK(!ReadWitness(coin, entry));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3162,14 +3162,7 @@ bool CWallet::CreateZerocoinMintModel(string &stringError, string denomAmount) {
         return false;
     }
 
-    // zerocoin init
-    CBigNum bnTrustedModulus;
-
-    // Loads a trusted Zerocoin modulus "N"
-    bnTrustedModulus.SetHex(ZEROCOIN_MODULUS);
-
-    // Set up the Zerocoin Params object
-    libzerocoin::Params *ZCParams = new libzerocoin::Params(bnTrustedModulus);
+    const libzerocoin::Params *ZCParams = GetZerocoinParams();
 	
 	int mintVersion = ZEROCOIN_TX_VERSION_1;
 	
@@ -3647,15 +3640,7 @@ bool CWallet::CreateZerocoinSpendTransaction(int64_t nValue, libzerocoin::CoinDe
             // Fill vin
 
             // Zerocoin
-            // zerocoin init
-            static CBigNum bnTrustedModulus;
-            bool setParams = bnTrustedModulus.SetHexBool(ZEROCOIN_MODULUS);
-            if (!setParams) {
-                LogPrintf("bnTrustedModulus.SetHexBool(ZEROCOIN_MODULUS) failed");
-            }
-
-            // Set up the Zerocoin Params object
-            static libzerocoin::Params *ZCParams = new libzerocoin::Params(bnTrustedModulus);
+            const libzerocoin::Params *ZCParams = GetZerocoinParams();
 
             // Select not yet used coin from the wallet with minimal possible id
 
@@ -3713,12 +3698,26 @@ bool CWallet::CreateZerocoinSpendTransaction(int64_t nValue, libzerocoin::CoinDe
                 return false;
             }
 
-            // 4. Get witness from the index
-            libzerocoin::AccumulatorWitness witness =
-                    zerocoinState->GetWitnessForSpend(&chainActive,
-                                                      chainActive.Height()-(ZC_MINT_CONFIRMATIONS-1),
-                                                      denomination, coinId,
-                                                      coinToUse.value);
+            // 4. Get witness, kept up to date in the wallet. Fall back to the index if it is wrong
+            CBigNum witnessValue;
+            bool fHaveWitness = GetZerocoinWitness(chainActive.Height()-(ZC_MINT_CONFIRMATIONS-1),
+                                                   denomination, coinId, coinToUse.value, witnessValue);
+            if (fHaveWitness &&
+                    !libzerocoin::AccumulatorWitness(ZCParams, libzerocoin::Accumulator(ZCParams, witnessValue, denomination),
+                                                     pubCoinSelected).VerifyWitness(accumulator, pubCoinSelected)) {
+                LogPrintf("CreateZerocoinSpendTransaction: stored witness is wrong, recomputing\n");
+                CWalletDB(strWalletFile).EraseZerocoinWitness(coinToUse.value);
+                fHaveWitness = zerocoinState->GetWitnessForSpend(&chainActive,
+                                                                 chainActive.Height()-(ZC_MINT_CONFIRMATIONS-1),
+                                                                 denomination, coinId,
+                                                                 coinToUse.value, witnessValue);
+            }
+            if (!fHaveWitness) {
+                strFailReason = _("failed to read the zerocoin data of the blocks, you may need to -reindex");
+                return false;
+            }
+            libzerocoin::AccumulatorWitness witness(ZCParams, libzerocoin::Accumulator(ZCParams, witnessValue, denomination),
+                                                    pubCoinSelected);
 
             CTxIn newTxIn;
             newTxIn.nSequence = coinId;
@@ -3835,6 +3834,7 @@ bool CWallet::CreateZerocoinSpendTransaction(int64_t nValue, libzerocoin::CoinDe
             coinToUse.id = coinId;
             coinToUse.nHeight = coinHeight;
             CWalletDB(strWalletFile).WriteZerocoinEntry(coinToUse);
+            CWalletDB(strWalletFile).EraseZerocoinWitness(coinToUse.value);
             pwalletMain->NotifyZerocoinChanged(pwalletMain, coinToUse.value.GetHex(), "Used (" + std::to_string(coinToUse.denomination) + " mint)",
                                                CT_UPDATED);
         }
@@ -3843,6 +3843,136 @@ bool CWallet::CreateZerocoinSpendTransaction(int64_t nValue, libzerocoin::CoinDe
     return true;
 }
 
+bool CWallet::GetZerocoinWitness(int maxHeight, int denomination, int id, const CBigNum &pubCoin, CBigNum &witnessValue) {
+    AssertLockHeld(cs_main);
+    CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
+    CWalletDB walletdb(strWalletFile);
+
+    // A stored witness is usable if the block it was computed for is still in the chain
+    CZerocoinWitnessEntry entry;
+    bool fCached = walletdb.ReadZerocoinWitness(pubCoin, entry) &&
+            entry.denomination == denomination && entry.id == id &&
+            chainActive[entry.nHeight] != NULL && chainActive[entry.nHeight]->GetBlockHash() == entry.blockHash &&
+            zerocoinState->AdvanceWitnessForSpend(maxHeight, denomination, id, pubCoin, entry.witness, entry.nHeight);
+
+    if (!fCached) {
+        entry.pubCoin = pubCoin;
+        entry.denomination = denomination;
+        entry.id = id;
+        if (!zerocoinState->GetWitnessForSpend(&chainActive, maxHeight, denomination, id, pubCoin, entry.witness))
+            return false;
+        entry.nHeight = maxHeight;
+    }
+    entry.blockHash = chainActive[maxHeight]->GetBlockHash();
+    walletdb.WriteZerocoinWitness(entry);
+
+    witnessValue = entry.witness;
+    return true;
+}
+
+void CWallet::UpdatedBlockTip(const CBlockIndex *pindex) {
+    // Called without cs_main once the block connections are done
+    UpdateZerocoinWitnesses();
+}
+
+/** Inputs of the accumulation bringing the witness of a mint to a new height */
+struct CZerocoinWitnessUpdate {
+    CZerocoinWitnessEntry entry;
+    std::vector<CBigNum> coinsToAdd;
+};
+
+void CWallet::UpdateZerocoinWitnesses() {
+    // Witnesses cover the coins a spend can use. Only the blocks entering or leaving that range
+    // can change them, and only if they have mints. Collecting the coins is quick and done under
+    // the locks, the accumulation isn't
+    std::vector<CZerocoinWitnessUpdate> vUpdates;
+    {
+        LOCK2(cs_main, cs_wallet);
+        if (IsInitialBlockDownload())
+            return;
+
+        int maxHeight = chainActive.Height() - (ZC_MINT_CONFIRMATIONS - 1);
+        const CBlockIndex *pindexMax = chainActive[maxHeight];
+        if (pindexMax == NULL || pindexMax == pindexZerocoinWitnesses)
+            return;
+
+        CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
+        // A block whose data can't be read counts as having mints
+        auto hasMints = [zerocoinState](const CBlockIndex *pindex) {
+            CZerocoinBlockDataCache::DataPtr data = zerocoinState->GetBlockData(pindex);
+            return !data || !data->groups.empty();
+        };
+        bool fChanged = pindexZerocoinWitnesses == NULL;
+        if (!fChanged) {
+            const CBlockIndex *pindexFork = chainActive.FindFork(pindexZerocoinWitnesses);
+            for (const CBlockIndex *pindex = pindexMax; !fChanged && pindex != pindexFork; pindex = pindex->pprev)
+                fChanged = hasMints(pindex);
+            for (const CBlockIndex *pindex = pindexZerocoinWitnesses; !fChanged && pindex != pindexFork; pindex = pindex->pprev)
+                fChanged = hasMints(pindex);
+        }
+        pindexZerocoinWitnesses = pindexMax;
+        if (!fChanged)
+            return;
+
+        CWalletDB walletdb(strWalletFile);
+        list <CZerocoinEntry> listPubCoin;
+        walletdb.ListPubCoin(listPubCoin);
+
+        BOOST_FOREACH(const CZerocoinEntry &coin, listPubCoin) {
+            if (coin.randomness == 0 || coin.serialNumber == 0)
+                continue;
+
+            CZerocoinWitnessUpdate update;
+            CZerocoinWitnessEntry &entry = update.entry;
+            bool fHaveWitness = walletdb.ReadZerocoinWitness(coin.value, entry);
+            // Coins are marked used by spends, rescans and RPCs, the witness is dropped here for all of them
+            if (coin.IsUsed) {
+                if (fHaveWitness)
+                    walletdb.EraseZerocoinWitness(coin.value);
+                continue;
+            }
+
+            int id;
+            int mintHeight = zerocoinState->GetMintedCoinHeightAndId(coin.value, coin.denomination, id);
+            if (mintHeight < 0 || mintHeight > maxHeight)
+                continue;
+
+            if (fHaveWitness) {
+                if (entry.nHeight == maxHeight && pindexMax->GetBlockHash() == entry.blockHash)
+                    continue;
+                // Don't recompute a witness the reorganization invalidated, the next spend or block will
+                if (entry.id != id || chainActive[entry.nHeight] == NULL ||
+                        chainActive[entry.nHeight]->GetBlockHash() != entry.blockHash ||
+                        !zerocoinState->GetCoinsToAdvanceWitness(maxHeight, coin.denomination, id, coin.value, entry.nHeight, update.coinsToAdd)) {
+                    walletdb.EraseZerocoinWitness(coin.value);
+                    continue;
+                }
+            }
+            else {
+                entry.pubCoin = coin.value;
+                entry.denomination = coin.denomination;
+                entry.id = id;
+                if (!zerocoinState->GetWitnessForSpendInputs(&chainActive, maxHeight, coin.denomination, id, coin.value,
+                                                             entry.witness, update.coinsToAdd))
+                    continue;
+            }
+            entry.nHeight = maxHeight;
+            entry.blockHash = pindexMax->GetBlockHash();
+            vUpdates.push_back(update);
+        }
+    }
+
+    BOOST_FOREACH(CZerocoinWitnessUpdate &update, vUpdates)
+        update.entry.witness = CZerocoinState::AccumulateCoins(update.entry.witness, update.entry.denomination, update.coinsToAdd);
+
+    if (vUpdates.empty())
+        return;
+    LOCK(cs_wallet);
+    CWalletDB walletdb(strWalletFile);
+    BOOST_FOREACH(const CZerocoinWitnessUpdate &update, vUpdates)
+        walletdb.WriteZerocoinWitness(update.entry);
+}
+
 bool CWallet::CommitZerocoinSpendTransaction(CWalletTx &wtxNew, CReserveKey &reservekey) {
     {
         LOCK2(cs_main, cs_wallet);
@@ -3892,13 +4022,34 @@ bool CWallet::CommitZerocoinSpendTransaction(CWalletTx &wtxNew, CReserveKey &res
  * @return
  */
 string CWallet::MintZerocoin(CScript pubCoin, int64_t nValue, CWalletTx &wtxNew, bool fAskFee) {
+    vector <CRecipient> vecSend;
+    CRecipient recipient = {pubCoin, nValue, false};
+    vecSend.push_back(recipient);
+    return MintZerocoin(vecSend, wtxNew, fAskFee);
+}
+
+/**
+ * @brief CWallet::MintZerocoin
+ * @param vecSend one recipient per mint, all paid by a single transaction
+ * @param wtxNew
+ * @param fAskFee
+ * @return
+ */
+string CWallet::MintZerocoin(const vector <CRecipient> &vecSend, CWalletTx &wtxNew, bool fAskFee) {
     // Do not allow mint to take place until fully synced
     // Temporary measure: we can remove this limitation when well after spend v1.5 HF block
     if (fImporting || fReindex || !znodeSync.IsBlockchainSynced())
         return _("Not fully synced yet");
 
-    LogPrintf("MintZerocoin: value = %s\n", nValue);
-    // Check amount
+    int64_t nValue = 0;
+    BOOST_FOREACH(const CRecipient &recipient, vecSend)
+    {
+        // Check amount
+        if (recipient.nAmount <= 0)
+            return _("Invalid amount");
+        nValue += recipient.nAmount;
+    }
+    LogPrintf("MintZerocoin: value = %s, mints = %d\n", nValue, vecSend.size());
     if (nValue <= 0)
         return _("Invalid amount");
     LogPrintf("CWallet.MintZerocoin() nValue = %s, payTxFee.GetFee(1000) = %s, GetBalance() = %s \n", nValue,
@@ -3916,7 +4067,8 @@ string CWallet::MintZerocoin(CScript pubCoin, int64_t nValue, CWalletTx &wtxNew,
     }
 
     string strError;
-    if (!CreateZerocoinMintTransaction(pubCoin, nValue, wtxNew, reservekey, nFeeRequired, strError)) {
+    int nChangePosRet = -1;
+    if (!CreateZerocoinMintTransaction(vecSend, wtxNew, reservekey, nFeeRequired, nChangePosRet, strError)) {
         LogPrintf("nFeeRequired=%s\n", nFeeRequired);
         if (nValue + nFeeRequired > GetBalance())
             return strprintf(
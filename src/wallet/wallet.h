@@ -595,6 +595,9 @@ private:
     int64_t nLastResend;
     bool fBroadcastTransactions;
 
+    //! Block the stored zerocoin witnesses were last brought up to, see UpdateZerocoinWitnesses
+    const CBlockIndex *pindexZerocoinWitnesses;
+
     mutable bool fAnonymizableTallyCached;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCached;
     mutable bool fAnonymizableTallyCachedNonDenom;
@@ -671,6 +674,7 @@ public:
         nLastResend = 0;
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
+        pindexZerocoinWitnesses = NULL;
         fAnonymizableTallyCached = false;
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
@@ -786,6 +790,7 @@ public:
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, const CBlock* pblock);
+    void UpdatedBlockTip(const CBlockIndex *pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
     void ReacceptWalletTransactions();
@@ -836,9 +841,21 @@ public:
     bool CreateZerocoinSpendTransaction(int64_t nValue, libzerocoin::CoinDenomination denomination,
                                         CWalletTx& wtxNew, CReserveKey& reservekey, CBigNum& coinSerial, uint256& txHash, CBigNum& zcSelectedValue, bool& zcSelectedIsUsed,  std::string& strFailReason);
     bool CommitZerocoinSpendTransaction(CWalletTx& wtxNew, CReserveKey& reservekey);
+
+    /**
+     * Witness to a mint of the wallet for a spend using the coins minted up to maxHeight.
+     * The witness is kept in the wallet database and only advanced over the blocks since it
+     * was last used. Returns false if the zerocoin data of the blocks can't be read.
+     */
+    bool GetZerocoinWitness(int maxHeight, int denomination, int id, const CBigNum &pubCoin, CBigNum &witnessValue);
+    //! Bring the witnesses of the unspent mints of the wallet to the coins a spend can use at
+    //! the new tip and erase those of the spent ones. The accumulation is done without holding
+    //! cs_main or cs_wallet
+    void UpdateZerocoinWitnesses();
     std::string SendMoney(CScript scriptPubKey, int64_t nValue, CWalletTx& wtxNew, bool fAskFee=false);
     std::string SendMoneyToDestination(const CTxDestination &address, int64_t nValue, CWalletTx& wtxNew, bool fAskFee=false);
     std::string MintZerocoin(CScript pubCoin, int64_t nValue, CWalletTx& wtxNew, bool fAskFee=false);
+    std::string MintZerocoin(const std::vector<CRecipient>& vecSend, CWalletTx& wtxNew, bool fAskFee=false);
     std::string SpendZerocoin(int64_t nValue, libzerocoin::CoinDenomination denomination, CWalletTx& wtxNew, CBigNum& coinSerial, uint256& txHash, CBigNum& zcSelectedValue, bool& zcSelectedIsUsed);
     bool CreateZerocoinMintModel(string &stringError, string denomAmount);
     bool CreateZerocoinSpendModel(string &stringError, string denomAmount);
@@ -1140,6 +1157,47 @@ public:
 };
 
 
+/** Witness to an unspent mint of the wallet, advanced as the chain grows so that a spend doesn't have to compute it */
+class CZerocoinWitnessEntry
+{
+public:
+    Bignum pubCoin;
+    int denomination;
+    int id;
+    // Value of the witness, covering the coins of the group minted up to nHeight
+    Bignum witness;
+    int nHeight;
+    // Hash of the block at nHeight, to detect reorganizations
+    uint256 blockHash;
+
+    CZerocoinWitnessEntry()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        pubCoin = 0;
+        denomination = 0;
+        id = 0;
+        witness = 0;
+        nHeight = -1;
+        blockHash.SetNull();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(pubCoin);
+        READWRITE(denomination);
+        READWRITE(id);
+        READWRITE(witness);
+        READWRITE(nHeight);
+        READWRITE(blockHash);
+    }
+};
+
 class CZerocoinSpendEntry
 {
 public:
@@ -245,6 +245,18 @@ CWalletDB::ReadZerocoinAccumulator(libzerocoin::Accumulator &accumulator, libzer
     return Read(std::make_tuple(string("zcaccumulator"), (unsigned int) denomination, pubcoinid), accumulator);
 }
 
+bool CWalletDB::WriteZerocoinWitness(const CZerocoinWitnessEntry &witness) {
+    return Write(make_pair(string("zcwitness"), witness.pubCoin), witness, true);
+}
+
+bool CWalletDB::ReadZerocoinWitness(const CBigNum &pubCoin, CZerocoinWitnessEntry &witness) {
+    return Read(make_pair(string("zcwitness"), pubCoin), witness);
+}
+
+bool CWalletDB::EraseZerocoinWitness(const CBigNum &pubCoin) {
+    return Erase(make_pair(string("zcwitness"), pubCoin));
+}
+
 //bool CWalletDB::EraseZerocoinAccumulator(libzerocoin::Accumulator& accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid)
 //{
 //    return Erase(std::make_tuple(string("zcaccumulator"), (unsigned int) denomination, pubcoinid), accumulator);
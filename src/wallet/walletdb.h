@@ -33,6 +33,7 @@ class uint160;
 class uint256;
 class CZerocoinEntry;
 class CZerocoinSpendEntry;
+class CZerocoinWitnessEntry;
 
 /** Error statuses for the wallet database */
 enum DBErrors
@@ -179,6 +180,9 @@ public:
     bool EraseCoinSpendSerialEntry(const CZerocoinSpendEntry& zerocoinSpend);
     bool WriteZerocoinAccumulator(libzerocoin::Accumulator accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
     bool ReadZerocoinAccumulator(libzerocoin::Accumulator& accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
+    bool WriteZerocoinWitness(const CZerocoinWitnessEntry& witness);
+    bool ReadZerocoinWitness(const CBigNum& pubCoin, CZerocoinWitnessEntry& witness);
+    bool EraseZerocoinWitness(const CBigNum& pubCoin);
     // bool EraseZerocoinAccumulator(libzerocoin::Accumulator& accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
 
     bool ReadCalculatedZCBlock(int& height);
@@ -7,12 +7,20 @@
 #include "definition.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "memusage.h"
+#include "random.h"
+#include "txdb.h"
 
 #include <atomic>
 #include <sstream>
 #include <chrono>
+#include <memory>
 
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
 
 using namespace std;
 
@@ -27,10 +35,211 @@ bool setParams = bnTrustedModulus.SetHexBool(ZEROCOIN_MODULUS);
 
 // Set up the Zerocoin Params object
 uint32_t securityLevel = 80;
-static libzerocoin::Params *ZCParams = new libzerocoin::Params(bnTrustedModulus);
+
+const libzerocoin::Params *GetZerocoinParams() {
+    // Built on first use rather than at static init, the precomputed tables take tens of MiB
+    static const libzerocoin::Params *params = new libzerocoin::Params(bnTrustedModulus);
+    return params;
+}
 
 static CZerocoinState zerocoinState;
 
+// Hash of the transaction sans the zerocoin part, signed by v1.5/v2 spends
+static uint256 GetTxHashForMetadata(const CTransaction &tx) {
+    CMutableTransaction txTemp = tx;
+    BOOST_FOREACH(CTxIn &txTempIn, txTemp.vin) {
+        if (txTempIn.scriptSig.IsZerocoinSpend()) {
+            txTempIn.scriptSig.clear();
+            txTempIn.prevout.SetNull();
+        }
+    }
+    return txTemp.GetHash();
+}
+
+// Check the version of a spend against its coin group. Old v2.0 spends are forced to version 1
+static bool CheckSpendVersion(libzerocoin::CoinSpend &newSpend,
+                              libzerocoin::CoinDenomination targetDenomination,
+                              uint32_t pubcoinId,
+                              CValidationState &state) {
+    int spendVersion = newSpend.getVersion();
+    if (spendVersion != ZEROCOIN_TX_VERSION_1 &&
+            spendVersion != ZEROCOIN_TX_VERSION_1_5 &&
+            spendVersion != ZEROCOIN_TX_VERSION_2) {
+        return state.DoS(100,
+            false,
+            NSEQUENCE_INCORRECT,
+            "CTransaction::CheckTransaction() : Error: incorrect spend transaction verion");
+    }
+
+    if (IsZerocoinTxV2(targetDenomination, pubcoinId)) {
+        // After threshold id all spends should be either version 1.5 or 2.0
+        if (spendVersion == ZEROCOIN_TX_VERSION_1)
+            return state.DoS(100,
+                false,
+                NSEQUENCE_INCORRECT,
+                "CTransaction::CheckTransaction() : Error: zerocoin spend should be version 1.5 or 2.0");
+    }
+    else {
+        // old spends v2.0s are probably incorrect, force spend to version 1
+        if (spendVersion == ZEROCOIN_TX_VERSION_2)
+            newSpend.setVersion(ZEROCOIN_TX_VERSION_1);
+    }
+    return true;
+}
+
+CZerocoinVerifyCache::CZerocoinVerifyCache() : nHits(0), nMisses(0)
+{
+    GetRandBytes(nonce.begin(), 32);
+}
+
+void CZerocoinVerifyCache::ComputeEntry(uint256& entry, const uint256 &hashTx, unsigned int nIn, int denomination,
+                                        const CBigNum &accumulatorValue)
+{
+    unsigned char buf[8];
+    WriteLE32(buf, nIn);
+    WriteLE32(buf + 4, (uint32_t)denomination);
+    std::vector<unsigned char> vchAccumulator = accumulatorValue.getvch();
+    CSHA256 hasher;
+    hasher.Write(nonce.begin(), 32).Write(hashTx.begin(), 32).Write(buf, sizeof(buf));
+    if (!vchAccumulator.empty())
+        hasher.Write(&vchAccumulator[0], vchAccumulator.size());
+    hasher.Finalize(entry.begin());
+}
+
+bool CZerocoinVerifyCache::Get(const uint256& entry)
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_zcverifycache);
+    return setValid.count(entry);
+}
+
+void CZerocoinVerifyCache::Set(const uint256& entry)
+{
+    size_t nMaxCacheSize = GetArg("-zcverifycachesize", DEFAULT_MAX_ZC_VERIFY_CACHE_SIZE) * ((size_t) 1 << 20);
+    if (nMaxCacheSize <= 0) return;
+
+    boost::unique_lock<boost::shared_mutex> lock(cs_zcverifycache);
+    while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+    {
+        map_type::size_type s = GetRand(setValid.bucket_count());
+        map_type::local_iterator it = setValid.begin(s);
+        if (it != setValid.end(s)) {
+            setValid.erase(*it);
+        }
+    }
+
+    setValid.insert(entry);
+}
+
+void CZerocoinVerifyCache::CountLookup(bool fHit)
+{
+    if (fHit)
+        nHits++;
+    else
+        nMisses++;
+}
+
+CZerocoinVerifyCacheStats CZerocoinVerifyCache::GetStats()
+{
+    CZerocoinVerifyCacheStats stats;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_zcverifycache);
+        stats.nSize = setValid.size();
+        stats.nUsage = memusage::DynamicUsage(setValid);
+    }
+    stats.nMaxUsage = GetArg("-zcverifycachesize", DEFAULT_MAX_ZC_VERIFY_CACHE_SIZE) * ((size_t) 1 << 20);
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    return stats;
+}
+
+CZerocoinVerifyCache &GetZerocoinVerifyCache()
+{
+    static CZerocoinVerifyCache zerocoinVerifyCache;
+    return zerocoinVerifyCache;
+}
+
+CZerocoinVerifyCacheStats GetZerocoinVerifyCacheStats() {
+    return GetZerocoinVerifyCache().GetStats();
+}
+
+// Verify the spend proof of input nIn of tx against the accumulator values recorded in the coin group's blocks.
+// Returns false if the data of these blocks can't be read
+static bool VerifySpendWithAccumulators(const CTransaction &tx,
+                                        unsigned int nIn,
+                                        const libzerocoin::CoinSpend &newSpend,
+                                        const libzerocoin::SpendMetaData &newMetadata,
+                                        libzerocoin::CoinDenomination targetDenomination,
+                                        uint32_t pubcoinId,
+                                        const CZerocoinState::CoinGroupInfo &coinGroup,
+                                        bool &fVerified) {
+    CBlockIndex *index = coinGroup.lastBlock;
+    pair<int,int> denominationAndId = make_pair(targetDenomination, pubcoinId);
+
+    bool spendHasBlockHash = false;
+
+    // Zerocoin v1.5/v2 transaction can cointain block hash of the last mint tx seen at the moment of spend. It speeds
+    // up verification
+    if (newSpend.getVersion() > ZEROCOIN_TX_VERSION_1 && !newSpend.getAccumulatorBlockHash().IsNull()) {
+        spendHasBlockHash = true;
+        uint256 accumulatorBlockHash = newSpend.getAccumulatorBlockHash();
+
+        // find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
+        while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
+            index = index->pprev;
+    }
+
+    // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
+    // In most cases the latest accumulator value will be used for verification
+    vector<const CBigNum *> accumulatorValues;
+    // keeps the accumulator values pointed to in memory
+    vector<CZerocoinBlockDataCache::DataPtr> blockData;
+    for (;;) {
+        CZerocoinBlockDataCache::DataPtr data = zerocoinState.GetBlockData(index);
+        if (!data)
+            return false;
+        map<pair<int,int>, CZerocoinGroupChange>::const_iterator change = data->groups.find(denominationAndId);
+        if (change != data->groups.end()) {
+            accumulatorValues.push_back(std::addressof(change->second.accumulatorValue));
+            blockData.push_back(data);
+        }
+
+        // if spend has block hash we don't need to look further
+        if (index == coinGroup.firstBlock || spendHasBlockHash)
+            break;
+        else
+            index = index->pprev;
+    }
+
+    // The proof may have been verified already, most likely against the value it is verified
+    // against now, but new accumulator values could have appeared since
+    CZerocoinVerifyCache &zerocoinVerifyCache = GetZerocoinVerifyCache();
+    vector<uint256> entries(accumulatorValues.size());
+    for (size_t i = 0; i < accumulatorValues.size(); i++) {
+        zerocoinVerifyCache.ComputeEntry(entries[i], tx.GetHash(), nIn, targetDenomination, *accumulatorValues[i]);
+        if (zerocoinVerifyCache.Get(entries[i])) {
+            zerocoinVerifyCache.CountLookup(true);
+            fVerified = true;
+            return true;
+        }
+    }
+    zerocoinVerifyCache.CountLookup(false);
+
+    for (size_t i = 0; i < accumulatorValues.size(); i++) {
+        libzerocoin::Accumulator accumulator(GetZerocoinParams(),
+                                             *accumulatorValues[i],
+                                             targetDenomination);
+        LogPrintf("CheckSpendEledgerTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
+        if (newSpend.Verify(accumulator, newMetadata)) {
+            zerocoinVerifyCache.Set(entries[i]);
+            fVerified = true;
+            return true;
+        }
+    }
+
+    fVerified = false;
+    return true;
+}
+
 bool CheckSpendEledgerTransaction(const CTransaction &tx,
                                 libzerocoin::CoinDenomination targetDenomination,
                                 CValidationState &state,
@@ -43,8 +252,9 @@ bool CheckSpendEledgerTransaction(const CTransaction &tx,
     // Check for inputs only, everything else was checked before
 	LogPrintf("CheckSpendEledgerTransaction denomination=%d nHeight=%d\n", targetDenomination, nHeight);
 
-	BOOST_FOREACH(const CTxIn &txin, tx.vin)
+	for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++)
 	{
+        const CTxIn &txin = tx.vin[nIn];
         if (!txin.scriptSig.IsZerocoinSpend())
             continue;
 
@@ -67,47 +277,16 @@ bool CheckSpendEledgerTransaction(const CTransaction &tx,
         CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 4),
                                         (const char *)&*txin.scriptSig.end(),
                                         SER_NETWORK, PROTOCOL_VERSION);
-        libzerocoin::CoinSpend newSpend(ZCParams, serializedCoinSpend);
+        libzerocoin::CoinSpend newSpend(GetZerocoinParams(), serializedCoinSpend);
 
+        if (!CheckSpendVersion(newSpend, targetDenomination, pubcoinId, state))
+            return false;
         int spendVersion = newSpend.getVersion();
-        if (spendVersion != ZEROCOIN_TX_VERSION_1 &&
-                spendVersion != ZEROCOIN_TX_VERSION_1_5 &&
-                spendVersion != ZEROCOIN_TX_VERSION_2) {
-            return state.DoS(100,
-                false,
-                NSEQUENCE_INCORRECT,
-                "CTransaction::CheckTransaction() : Error: incorrect spend transaction verion");
-        }
-
-        if (IsZerocoinTxV2(targetDenomination, pubcoinId)) {
-            // After threshold id all spends should be either version 1.5 or 2.0
-            if (spendVersion == ZEROCOIN_TX_VERSION_1)
-                return state.DoS(100,
-                    false,
-                    NSEQUENCE_INCORRECT,
-                    "CTransaction::CheckTransaction() : Error: zerocoin spend should be version 1.5 or 2.0");
-        }
-        else {
-            // old spends v2.0s are probably incorrect, force spend to version 1
-            if (spendVersion == ZEROCOIN_TX_VERSION_2) {
-                spendVersion = ZEROCOIN_TX_VERSION_1;
-                newSpend.setVersion(ZEROCOIN_TX_VERSION_1);
-            }
-        }
 
         uint256 txHashForMetadata;
 
-        if (spendVersion > ZEROCOIN_TX_VERSION_1) {
-            // Obtain the hash of the transaction sans the zerocoin part
-            CMutableTransaction txTemp = tx;
-            BOOST_FOREACH(CTxIn &txTempIn, txTemp.vin) {
-                if (txTempIn.scriptSig.IsZerocoinSpend()) {
-                    txTempIn.scriptSig.clear();
-                    txTempIn.prevout.SetNull();
-                }
-            }
-            txHashForMetadata = txTemp.GetHash();
-        }
+        if (spendVersion > ZEROCOIN_TX_VERSION_1)
+            txHashForMetadata = GetTxHashForMetadata(tx);
 
         LogPrintf("CheckSpendEledgerTransaction: tx version=%d, tx metadata hash=%s, serial=%s\n", newSpend.getVersion(), txHashForMetadata.ToString(), newSpend.getCoinSerialNumber().ToString());
 
@@ -129,61 +308,39 @@ bool CheckSpendEledgerTransaction(const CTransaction &tx,
         if (!zerocoinState.GetCoinGroupInfo(targetDenomination, pubcoinId, coinGroup))
             return state.DoS(100, false, NO_MINT_ZEROCOIN, "CheckSpendEledgerTransaction: Error: no coins were minted with such parameters");
 
-        bool passVerify = false;
-        CBlockIndex *index = coinGroup.lastBlock;
         pair<int,int> denominationAndId = make_pair(targetDenomination, pubcoinId);
-		
-		bool spendHasBlockHash = false;
-		
-        // Zerocoin v1.5/v2 transaction can cointain block hash of the last mint tx seen at the moment of spend. It speeds
-		// up verification
-        if (spendVersion > ZEROCOIN_TX_VERSION_1 && !newSpend.getAccumulatorBlockHash().IsNull()) {
-			spendHasBlockHash = true;
-			uint256 accumulatorBlockHash = newSpend.getAccumulatorBlockHash();
-			
-			// find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
-			while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
-				index = index->pprev;
-		}
 
-        // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
-        // In most cases the latest accumulator value will be used for verification
-        do {
-            if (index->accumulatorChanges.count(denominationAndId) > 0) {						
-                libzerocoin::Accumulator accumulator(ZCParams,
-                                                     index->accumulatorChanges[denominationAndId].first,
-                                                     targetDenomination);
-                LogPrintf("CheckSpendEledgerTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
-                passVerify = newSpend.Verify(accumulator, newMetadata);
-            }
-
-	        // if spend has block hash we don't need to look further
-			if (index == coinGroup.firstBlock || spendHasBlockHash)
-                break;
-            else
-                index = index->pprev;
-        } while (!passVerify);
+        // The proofs of the spends in a block are verified in parallel beforehand, see CZerocoinSpendCheck
+        bool passVerify = zerocoinTxInfo &&
+                zerocoinTxInfo->verifiedSpends.count(make_pair(hashTx, make_pair(nIn, (int)targetDenomination))) > 0;
+        if (!passVerify &&
+                !VerifySpendWithAccumulators(tx, nIn, newSpend, newMetadata, targetDenomination, pubcoinId, coinGroup, passVerify))
+            return state.Error("CheckSpendEledgerTransaction: failed to read zerocoin data, you may need to -reindex");
 
         // Rare case: accumulator value contains some but NOT ALL coins from one block. In this case we will
         // have to enumerate over coins manually. No optimization is really needed here because it's a rarity
         // This can't happen if spend is of version 1.5 or 2.0
         if (!passVerify && spendVersion == ZEROCOIN_TX_VERSION_1) {
             // Build vector of coins sorted by the time of mint
-            index = coinGroup.lastBlock;
-            vector<CBigNum> pubCoins = index->mintedPubCoins[denominationAndId];
-            if (index != coinGroup.firstBlock) {
-                do {
-                    index = index->pprev;
-                    if (index->mintedPubCoins.count(denominationAndId) > 0)
-                        pubCoins.insert(pubCoins.begin(),
-                                        index->mintedPubCoins[denominationAndId].cbegin(),
-                                        index->mintedPubCoins[denominationAndId].cend());
-                } while (index != coinGroup.firstBlock);
+            CBlockIndex *index = coinGroup.lastBlock;
+            vector<CBigNum> pubCoins;
+            for (;;) {
+                CZerocoinBlockDataCache::DataPtr data = zerocoinState.GetBlockData(index);
+                if (!data)
+                    return state.Error("CheckSpendEledgerTransaction: failed to read zerocoin data, you may need to -reindex");
+                map<pair<int,int>, CZerocoinGroupChange>::const_iterator change = data->groups.find(denominationAndId);
+                if (change != data->groups.end())
+                    pubCoins.insert(pubCoins.begin(),
+                                    change->second.pubCoins.cbegin(),
+                                    change->second.pubCoins.cend());
+                if (index == coinGroup.firstBlock)
+                    break;
+                index = index->pprev;
             }
 
-            libzerocoin::Accumulator accumulator(ZCParams, targetDenomination);
+            libzerocoin::Accumulator accumulator(GetZerocoinParams(), targetDenomination);
             BOOST_FOREACH(const CBigNum &pubCoin, pubCoins) {
-                accumulator += libzerocoin::PublicCoin(ZCParams, pubCoin, (libzerocoin::CoinDenomination)targetDenomination);
+                accumulator += libzerocoin::PublicCoin(GetZerocoinParams(), pubCoin, (libzerocoin::CoinDenomination)targetDenomination);
                 LogPrintf("CheckSpendEledgerTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
                 if ((passVerify = newSpend.Verify(accumulator, newMetadata)) == true)
                     break;
@@ -192,9 +349,9 @@ bool CheckSpendEledgerTransaction(const CTransaction &tx,
             if (!passVerify) {
                 // One more time now in reverse direction. The only reason why it's required is compatibility with
                 // previous client versions
-                libzerocoin::Accumulator accumulator(ZCParams, targetDenomination);
+                libzerocoin::Accumulator accumulator(GetZerocoinParams(), targetDenomination);
                 BOOST_REVERSE_FOREACH(const CBigNum &pubCoin, pubCoins) {
-                    accumulator += libzerocoin::PublicCoin(ZCParams, pubCoin, (libzerocoin::CoinDenomination)targetDenomination);
+                    accumulator += libzerocoin::PublicCoin(GetZerocoinParams(), pubCoin, (libzerocoin::CoinDenomination)targetDenomination);
                     LogPrintf("CheckSpendEledgerTransaction: accumulatorRev=%s\n", accumulator.getValue().ToString().substr(0,15));
                     if ((passVerify = newSpend.Verify(accumulator, newMetadata)) == true)
                         break;
@@ -245,6 +402,64 @@ bool CheckSpendEledgerTransaction(const CTransaction &tx,
 	return true;
 }
 
+void GetZerocoinSpendInputs(const CTransaction &tx, vector<CZerocoinSpendInput> &spends) {
+    if (!tx.IsZerocoinSpend())
+        return;
+    // Same inputs and denominations as CheckZerocoinTransaction passes to CheckSpendEledgerTransaction
+    BOOST_FOREACH(const CTxOut &txout, tx.vout) {
+        switch (txout.nValue) {
+        case libzerocoin::ZQ_LOVELACE*COIN:
+        case libzerocoin::ZQ_GOLDWASSER*COIN:
+        case libzerocoin::ZQ_RACKOFF*COIN:
+        case libzerocoin::ZQ_PEDERSEN*COIN:
+        case libzerocoin::ZQ_WILLIAMSON*COIN:
+            for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+                if (tx.vin[nIn].scriptSig.IsZerocoinSpend())
+                    spends.push_back(CZerocoinSpendInput(tx, nIn, (libzerocoin::CoinDenomination)(txout.nValue / COIN)));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool CZerocoinSpendCheck::operator()() {
+    // Same steps as CheckSpendEledgerTransaction up to the proof verification, any error is
+    // reported there when the spend is verified again
+    const CTransaction &tx = *spend.ptx;
+    const CTxIn &txin = tx.vin[spend.nIn];
+    uint32_t pubcoinId = txin.nSequence;
+    *pfVerified = false;
+    if (pubcoinId < 1 || pubcoinId >= INT_MAX || txin.scriptSig.size() < 4)
+        return true;
+
+    try {
+        CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 4),
+                                        (const char *)&*txin.scriptSig.end(),
+                                        SER_NETWORK, PROTOCOL_VERSION);
+        libzerocoin::CoinSpend newSpend(GetZerocoinParams(), serializedCoinSpend);
+        CValidationState state;
+        if (!CheckSpendVersion(newSpend, spend.denomination, pubcoinId, state))
+            return true;
+
+        uint256 txHashForMetadata;
+        if (newSpend.getVersion() > ZEROCOIN_TX_VERSION_1)
+            txHashForMetadata = GetTxHashForMetadata(tx);
+        libzerocoin::SpendMetaData newMetadata(txin.nSequence, txHashForMetadata);
+
+        CZerocoinState::CoinGroupInfo coinGroup;
+        if (!zerocoinState.GetCoinGroupInfo(spend.denomination, pubcoinId, coinGroup))
+            return true;
+
+        // *pfVerified stays false if the block data can't be read
+        VerifySpendWithAccumulators(tx, spend.nIn, newSpend, newMetadata, spend.denomination, pubcoinId, coinGroup, *pfVerified);
+    } catch (const std::exception &e) {
+        LogPrintf("CZerocoinSpendCheck: %s\n", e.what());
+    }
+    return true;
+}
+
 bool CheckMintEledgerTransaction(const CTxOut &txout,
                                CValidationState &state,
                                uint256 hashTx,
@@ -293,7 +508,7 @@ bool CheckMintEledgerTransaction(const CTxOut &txout,
     case libzerocoin::ZQ_PEDERSEN*COIN:
     case libzerocoin::ZQ_WILLIAMSON*COIN:
         libzerocoin::CoinDenomination denomination = (libzerocoin::CoinDenomination)(txout.nValue / COIN);
-        libzerocoin::PublicCoin checkPubCoin(ZCParams, pubCoin, denomination);
+        libzerocoin::PublicCoin checkPubCoin(GetZerocoinParams(), pubCoin, denomination);
         if (!checkPubCoin.validate())
             return state.DoS(100,
                 false,
@@ -477,10 +692,12 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
 	return true;
 }
 
-void DisconnectTipZC(CBlock & /*block*/, CBlockIndex *pindexDelete) {
-    zerocoinState.RemoveBlock(pindexDelete);
+bool DisconnectTipZC(CBlock & /*block*/, CBlockIndex *pindexDelete) {
+    if (!zerocoinState.RemoveBlock(pindexDelete))
+        return error("DisconnectTipZC: failed to read zerocoin data of block %s", pindexDelete->GetBlockHash().ToString());
 
     // TODO: notify the wallet
+    return true;
 }
 
 
@@ -503,9 +720,10 @@ bool ConnectTipZC(CValidationState &state, const CChainParams &chainparams, CBlo
             }
         }
 
-        pindexNew->spentSerials = pblock->zerocoinTxInfo->spentSerials;
+        CZerocoinBlockData zerocoinData;
+        zerocoinData.spentSerials = pblock->zerocoinTxInfo->spentSerials;
         if (pindexNew->nHeight > ZC_CHECK_BUG_FIXED_AT_BLOCK) {
-            BOOST_FOREACH(const CBigNum &serial, pindexNew->spentSerials) {
+            BOOST_FOREACH(const CBigNum &serial, zerocoinData.spentSerials) {
                 zerocoinState.AddSpend(serial);
             }
         }
@@ -513,34 +731,38 @@ bool ConnectTipZC(CValidationState &state, const CChainParams &chainparams, CBlo
         // Update minted values and accumulators
         BOOST_FOREACH(const PAIRTYPE(int,CBigNum) &mint, pblock->zerocoinTxInfo->mints) {
             int denomination = mint.first;
-            CBigNum oldAccValue = ZCParams->accumulatorParams.accumulatorBase;
+            CBigNum oldAccValue = GetZerocoinParams()->accumulatorParams.accumulatorBase;
             int mintId = zerocoinState.AddMint(pindexNew, denomination, mint.second, oldAccValue);
+            if (mintId < 0)
+                return state.Error(strprintf("ConnectTipZC: failed to read zerocoin data of the block before %s",
+                                             pindexNew->GetBlockHash().ToString()));
             LogPrintf("ConnectTipZC: mint added denomination=%d, id=%d\n", denomination, mintId);
             pair<int,int> denomAndId = make_pair(denomination, mintId);
 
-            pindexNew->mintedPubCoins[denomAndId].push_back(mint.second);
+            CZerocoinGroupChange &groupChange = zerocoinData.groups[denomAndId];
+            if (groupChange.nMints > 0)
+                // earlier mint of the group in this block
+                oldAccValue = groupChange.accumulatorValue;
+            groupChange.pubCoins.push_back(mint.second);
 
             CZerocoinState::CoinGroupInfo coinGroupInfo;
             zerocoinState.GetCoinGroupInfo(denomination, mintId, coinGroupInfo);
 
-            libzerocoin::PublicCoin pubCoin(ZCParams, mint.second, (libzerocoin::CoinDenomination)denomination);
-            libzerocoin::Accumulator accumulator(ZCParams,
+            libzerocoin::PublicCoin pubCoin(GetZerocoinParams(), mint.second, (libzerocoin::CoinDenomination)denomination);
+            libzerocoin::Accumulator accumulator(GetZerocoinParams(),
                                                  oldAccValue,
                                                  (libzerocoin::CoinDenomination)denomination);
             accumulator += pubCoin;
 
-            if (pindexNew->accumulatorChanges.count(denomAndId) > 0) {
-                pair<CBigNum,int> &accChange = pindexNew->accumulatorChanges[denomAndId];
-                accChange.first = accumulator.getValue();
-                accChange.second++;
-            }
-            else {
-                pindexNew->accumulatorChanges[denomAndId] = make_pair(accumulator.getValue(), 1);
-            }
-        }               
+            groupChange.accumulatorValue = accumulator.getValue();
+            groupChange.nMints++;
+        }
+
+        zerocoinState.SetBlockData(pindexNew, zerocoinData);
     }
-    else {
-        zerocoinState.AddBlock(pindexNew);
+    else if (!zerocoinState.AddBlock(pindexNew)) {
+        return state.Error(strprintf("ConnectTipZC: failed to read zerocoin data of block %s",
+                                     pindexNew->GetBlockHash().ToString()));
     }
 
 	return true;
@@ -560,8 +782,11 @@ int ZerocoinGetNHeight(const CBlockHeader &block) {
 
 bool ZerocoinBuildStateFromIndex(CChain *chain) {
     zerocoinState.Reset();
-    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
-        zerocoinState.AddBlock(blockIndex);
+    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex)) {
+        if (!zerocoinState.AddBlock(blockIndex))
+            return error("ZerocoinBuildStateFromIndex: failed to read zerocoin data of block %s",
+                         blockIndex->GetBlockHash().ToString());
+    }
 
     // DEBUG
     LogPrintf("Latest IDs are %d, %d, %d, %d, %d\n",
@@ -573,6 +798,45 @@ bool ZerocoinBuildStateFromIndex(CChain *chain) {
 	return true;
 }
 
+// Coin values and serials up to this size are serialized and hashed on the stack
+static const size_t ZC_BIGNUM_STACK_BYTES = 512;
+
+// CBigNum::Serialize into buf without allocating. Returns the size, or 0 if bn is too big
+static size_t SerializeBigNumOnStack(const CBigNum &bn, unsigned char (&buf)[ZC_BIGNUM_STACK_BYTES + 9]) {
+    unsigned char mpi[ZC_BIGNUM_STACK_BYTES + 4];
+    size_t nMpiSize = BN_bn2mpi(&bn, NULL);
+    if (nMpiSize > sizeof(mpi))
+        return 0;
+    BN_bn2mpi(&bn, mpi);
+
+    // getvch(): the MPI without its 4 byte length, in little endian order
+    size_t nSize = nMpiSize > 4 ? nMpiSize - 4 : 0;
+    size_t nPos = 0;
+    if (nSize < 253) {
+        buf[nPos++] = (unsigned char)nSize;
+    } else {
+        buf[nPos++] = 253;
+        buf[nPos++] = (unsigned char)(nSize & 0xff);
+        buf[nPos++] = (unsigned char)(nSize >> 8);
+    }
+    for (size_t i = 0; i < nSize; i++)
+        buf[nPos++] = mpi[nMpiSize - 1 - i];
+    return nPos;
+}
+
+// Same as comparing CDataStream serializations of a and b
+static bool SerializedLess(const CBigNum &a, const CBigNum &b) {
+    unsigned char bufA[ZC_BIGNUM_STACK_BYTES + 9], bufB[ZC_BIGNUM_STACK_BYTES + 9];
+    size_t nSizeA = SerializeBigNumOnStack(a, bufA), nSizeB = SerializeBigNumOnStack(b, bufB);
+    if (nSizeA == 0 || nSizeB == 0) {
+        CDataStream ds1(SER_DISK, CLIENT_VERSION), ds2(SER_DISK, CLIENT_VERSION);
+        ds1 << a;
+        ds2 << b;
+        return ds1.str() < ds2.str();
+    }
+    return lexicographical_compare(bufA, bufA + nSizeA, bufB, bufB + nSizeB);
+}
+
 // CZerocoinTxInfo
 
 void CZerocoinTxInfo::Complete() {
@@ -580,26 +844,91 @@ void CZerocoinTxInfo::Complete() {
     // works, we need to stick to it. Denomination doesn't matter but we will sort by it as well
     sort(mints.begin(), mints.end(),
          [](decltype(mints)::const_reference m1, decltype(mints)::const_reference m2)->bool {
-            CDataStream ds1(SER_DISK, CLIENT_VERSION), ds2(SER_DISK, CLIENT_VERSION);
-            ds1 << m1.second;
-            ds2 << m2.second;
-            return (m1.first < m2.first) || ((m1.first == m2.first) && (ds1.str() < ds2.str()));
+            return (m1.first < m2.first) || ((m1.first == m2.first) && SerializedLess(m1.second, m2.second));
          });
 
     // Mark this info as complete
     fInfoIsComplete = true;
 }
 
-// CZerocoinState::CBigNumHash
+// CZerocoinBlockDataCache
 
-std::size_t CZerocoinState::CBigNumHash::operator ()(const CBigNum &bn) const noexcept {
-    // we are operating on almost random big numbers and least significant bytes (save for few last bytes) give us a good hash
-    vector<unsigned char> bnData = bn.ToBytes();
-    if (bnData.size() < sizeof(size_t)*3)
-        // rare case, put ones like that into one hash bin
-        return 0;
-    else
-        return ((size_t*)bnData.data())[1];
+CZerocoinBlockDataCache::DataPtr CZerocoinBlockDataCache::Get(const CBlockIndex *index) {
+    static const DataPtr noData = std::make_shared<CZerocoinBlockData>();
+    if (!(index->nStatus & BLOCK_HAVE_ZEROCOIN))
+        return noData;
+
+    uint256 hash = index->GetBlockHash();
+    {
+        boost::lock_guard<boost::mutex> lock(cs);
+        auto itDirty = dirty.find(hash);
+        if (itDirty != dirty.end())
+            return itDirty->second.second;
+        auto it = entries.find(hash);
+        if (it != entries.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+    }
+
+    std::shared_ptr<CZerocoinBlockData> data = std::make_shared<CZerocoinBlockData>();
+    if (!pblocktree->ReadZerocoinBlockData(index, *data)) {
+        LogPrintf("ERROR: %s: no zerocoin data for block %s, you may need to -reindex\n", __func__, hash.ToString());
+        return DataPtr();
+    }
+
+    boost::lock_guard<boost::mutex> lock(cs);
+    Cache(hash, data);
+    return data;
+}
+
+void CZerocoinBlockDataCache::Put(CBlockIndex *index, const CZerocoinBlockData &data) {
+    uint256 hash = index->GetBlockHash();
+    boost::lock_guard<boost::mutex> lock(cs);
+    // the block may have been connected before
+    auto it = entries.find(hash);
+    if (it != entries.end()) {
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+
+    if (data.IsNull()) {
+        dirty.erase(hash);
+        index->nStatus &= ~BLOCK_HAVE_ZEROCOIN;
+    }
+    else {
+        dirty[hash] = make_pair(index, std::make_shared<const CZerocoinBlockData>(data));
+        index->nStatus |= BLOCK_HAVE_ZEROCOIN;
+    }
+}
+
+void CZerocoinBlockDataCache::TakeDirty(vector<pair<const CBlockIndex *, DataPtr> > &vDirty) {
+    boost::lock_guard<boost::mutex> lock(cs);
+    vDirty.clear();
+    vDirty.reserve(dirty.size());
+    // Readers hold cs_main as does the flush, so the data is in the database before it is looked for there
+    for (auto it = dirty.begin(); it != dirty.end(); it++) {
+        vDirty.push_back(it->second);
+        Cache(it->first, it->second.second);
+    }
+    dirty.clear();
+}
+
+void CZerocoinBlockDataCache::Clear() {
+    boost::lock_guard<boost::mutex> lock(cs);
+    lru.clear();
+    entries.clear();
+}
+
+void CZerocoinBlockDataCache::Cache(const uint256 &hash, const DataPtr &data) {
+    if (entries.count(hash) == 0) {
+        lru.push_front(make_pair(hash, data));
+        entries[hash] = lru.begin();
+        if (lru.size() > ZC_BLOCK_DATA_CACHE_SIZE) {
+            entries.erase(lru.back().first);
+            lru.pop_back();
+        }
+    }
 }
 
 // CZerocoinState
@@ -607,6 +936,38 @@ std::size_t CZerocoinState::CBigNumHash::operator ()(const CBigNum &bn) const no
 CZerocoinState::CZerocoinState() {
 }
 
+uint256 CZerocoinState::GetDigest(const CBigNum &value) {
+    unsigned char sign = BN_is_negative(&value) ? 1 : 0;
+    unsigned char buf[ZC_BIGNUM_STACK_BYTES];
+    size_t nBytes = BN_num_bytes(&value);
+
+    CSHA256 hasher;
+    hasher.Write(&sign, 1);
+    if (nBytes <= sizeof(buf)) {
+        BN_bn2bin(&value, buf);
+        hasher.Write(buf, nBytes);
+    } else {
+        vector<unsigned char> bytes = value.ToBytes();
+        hasher.Write(bytes.data(), bytes.size());
+    }
+
+    uint256 digest;
+    hasher.Finalize(digest.begin());
+    return digest;
+}
+
+CZerocoinBlockDataCache::DataPtr CZerocoinState::GetBlockData(const CBlockIndex *index) {
+    return blockData.Get(index);
+}
+
+void CZerocoinState::SetBlockData(CBlockIndex *index, const CZerocoinBlockData &data) {
+    blockData.Put(index, data);
+}
+
+void CZerocoinState::TakeDirtyBlockData(vector<pair<const CBlockIndex *, CZerocoinBlockDataCache::DataPtr> > &vDirty) {
+    blockData.TakeDirty(vDirty);
+}
+
 int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum &pubCoin, CBigNum &previousAccValue) {
 
     int     mintId = 1;
@@ -621,14 +982,19 @@ int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum
     CoinGroupInfo &coinGroup = coinGroups[make_pair(denomination, mintId)];
 	int coinsPerId = IsZerocoinTxV2((libzerocoin::CoinDenomination)denomination, mintId) ? ZC_SPEND_V2_COINSPERID : ZC_SPEND_V1_COINSPERID;
     if (coinGroup.nCoins < coinsPerId || coinGroup.lastBlock == index) {
-        if (coinGroup.nCoins++ == 0) {
+        if (coinGroup.nCoins == 0) {
             // first groups of coins for given denomination
             coinGroup.firstBlock = coinGroup.lastBlock = index;
         }
-        else {
-            previousAccValue = coinGroup.lastBlock->accumulatorChanges[make_pair(denomination,mintId)].first;
+        else if (coinGroup.lastBlock != index) {
+            // the value after earlier mints of the same block is up to the caller
+            CZerocoinBlockDataCache::DataPtr data = GetBlockData(coinGroup.lastBlock);
+            if (!data)
+                return -1;
+            previousAccValue = data->groups.at(make_pair(denomination,mintId)).accumulatorValue;
             coinGroup.lastBlock = index;
         }
+        coinGroup.nCoins++;
     }
     else {
         latestCoinIds[denomination] = ++mintId;
@@ -641,50 +1007,57 @@ int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum
     coinInfo.denomination = denomination;
     coinInfo.id = mintId;
     coinInfo.nHeight = index->nHeight;
-    mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(pubCoin, coinInfo));
+    mintedPubCoins.insert(GetDigest(pubCoin), coinInfo);
 
     return mintId;
 }
 
 void CZerocoinState::AddSpend(const CBigNum &serial) {
-    usedCoinSerials.insert(serial);
+    usedCoinSerials.insert(GetDigest(serial));
 }
 
-void CZerocoinState::AddBlock(CBlockIndex *index) {
-    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), PAIRTYPE(CBigNum,int)) &accUpdate, index->accumulatorChanges)
+bool CZerocoinState::AddBlock(CBlockIndex *index) {
+    CZerocoinBlockDataCache::DataPtr data = GetBlockData(index);
+    if (!data)
+        return false;
+
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CZerocoinGroupChange) &groupChange, data->groups)
     {
-        CoinGroupInfo   &coinGroup = coinGroups[accUpdate.first];
+        CoinGroupInfo   &coinGroup = coinGroups[groupChange.first];
 
         if (coinGroup.firstBlock == NULL)
             coinGroup.firstBlock = index;
         coinGroup.lastBlock = index;
-        coinGroup.nCoins += accUpdate.second.second;
-    }
+        coinGroup.nCoins += groupChange.second.nMints;
 
-    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, index->mintedPubCoins) {
-        latestCoinIds[pubCoins.first.first] = pubCoins.first.second;
-        BOOST_FOREACH(const CBigNum &coin, pubCoins.second) {
+        latestCoinIds[groupChange.first.first] = groupChange.first.second;
+        BOOST_FOREACH(const CBigNum &coin, groupChange.second.pubCoins) {
             CMintedCoinInfo coinInfo;
-            coinInfo.denomination = pubCoins.first.first;
-            coinInfo.id = pubCoins.first.second;
+            coinInfo.denomination = groupChange.first.first;
+            coinInfo.id = groupChange.first.second;
             coinInfo.nHeight = index->nHeight;
-            mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(coin, coinInfo));
+            mintedPubCoins.insert(GetDigest(coin), coinInfo);
         }
     }
 
     if (index->nHeight > ZC_CHECK_BUG_FIXED_AT_BLOCK) {
-        BOOST_FOREACH(const CBigNum &serial, index->spentSerials) {
-            usedCoinSerials.insert(serial);
+        BOOST_FOREACH(const CBigNum &serial, data->spentSerials) {
+            usedCoinSerials.insert(GetDigest(serial));
         }
     }
+    return true;
 }
 
-void CZerocoinState::RemoveBlock(CBlockIndex *index) {
+bool CZerocoinState::RemoveBlock(CBlockIndex *index) {
+    CZerocoinBlockDataCache::DataPtr data = GetBlockData(index);
+    if (!data)
+        return false;
+
     // roll back accumulator updates
-    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), PAIRTYPE(CBigNum,int)) &accUpdate, index->accumulatorChanges)
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CZerocoinGroupChange) &accUpdate, data->groups)
     {
         CoinGroupInfo   &coinGroup = coinGroups[accUpdate.first];
-        int  nMintsToForget = accUpdate.second.second;
+        int  nMintsToForget = accUpdate.second.nMints;
 
         assert(coinGroup.nCoins >= nMintsToForget);
 
@@ -696,30 +1069,32 @@ void CZerocoinState::RemoveBlock(CBlockIndex *index) {
         }
         else {
             // roll back lastBlock to previous position
+            CZerocoinBlockDataCache::DataPtr lastBlockData;
             do {
                 assert(coinGroup.lastBlock != coinGroup.firstBlock);
                 coinGroup.lastBlock = coinGroup.lastBlock->pprev;
-            } while (coinGroup.lastBlock->accumulatorChanges.count(accUpdate.first) == 0);
+                if (!(lastBlockData = GetBlockData(coinGroup.lastBlock)))
+                    return false;
+            } while (lastBlockData->groups.count(accUpdate.first) == 0);
         }
     }
 
     // roll back mints
-    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, index->mintedPubCoins) {
-        BOOST_FOREACH(const CBigNum &coin, pubCoins.second) {
-            auto coins = mintedPubCoins.equal_range(coin);
-            auto coinIt = find_if(coins.first, coins.second, [=](const decltype(mintedPubCoins)::value_type &v) {
-                return v.second.denomination == pubCoins.first.first &&
-                        v.second.id == pubCoins.first.second;
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CZerocoinGroupChange) &pubCoins, data->groups) {
+        BOOST_FOREACH(const CBigNum &coin, pubCoins.second.pubCoins) {
+            bool fErased = mintedPubCoins.erase_if(GetDigest(coin), [&](const CMintedCoinInfo &coinInfo) {
+                return coinInfo.denomination == pubCoins.first.first &&
+                        coinInfo.id == pubCoins.first.second;
             });
-            assert(coinIt != mintedPubCoins.end());
-            mintedPubCoins.erase(coinIt);
+            assert(fErased);
         }
     }
 
     // roll back spends
-    BOOST_FOREACH(const CBigNum &serial, index->spentSerials) {
-        usedCoinSerials.erase(serial);
+    BOOST_FOREACH(const CBigNum &serial, data->spentSerials) {
+        usedCoinSerials.erase(GetDigest(serial));
     }
+    return true;
 }
 
 bool CZerocoinState::GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result) {
@@ -732,11 +1107,11 @@ bool CZerocoinState::GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &r
 }
 
 bool CZerocoinState::IsUsedCoinSerial(const CBigNum &coinSerial) {
-    return usedCoinSerials.count(coinSerial) != 0;
+    return usedCoinSerials.count(GetDigest(coinSerial)) != 0;
 }
 
 bool CZerocoinState::HasCoin(const CBigNum &pubCoin) {
-    return mintedPubCoins.count(pubCoin) != 0;
+    return mintedPubCoins.find(GetDigest(pubCoin)) != NULL;
 }
 
 int CZerocoinState::GetAccumulatorValueForSpend(int maxHeight, int denomination, int id, CBigNum &accumulator, uint256 &blockHash) {
@@ -748,20 +1123,21 @@ int CZerocoinState::GetAccumulatorValueForSpend(int maxHeight, int denomination,
     CoinGroupInfo coinGroup = coinGroups[denomAndId];
     CBlockIndex *lastBlock = coinGroup.lastBlock;
 
-    assert(lastBlock->accumulatorChanges.count(denomAndId) > 0);
-    assert(coinGroup.firstBlock->accumulatorChanges.count(denomAndId) > 0);
-
     int numberOfCoins = 0;
     for (;;) {
-        if (lastBlock->accumulatorChanges.count(denomAndId) > 0) {
-            if (lastBlock->nHeight <= maxHeight) {
+        if (lastBlock->nHeight <= maxHeight) {
+            CZerocoinBlockDataCache::DataPtr data = GetBlockData(lastBlock);
+            if (!data)
+                return 0;
+            map<pair<int,int>, CZerocoinGroupChange>::const_iterator change = data->groups.find(denomAndId);
+            if (change != data->groups.end()) {
                 if (numberOfCoins == 0) {
                     // latest block satisfying given conditions
                     // remember accumulator value and block hash
-                    accumulator = lastBlock->accumulatorChanges[denomAndId].first;
+                    accumulator = change->second.accumulatorValue;
                     blockHash = lastBlock->GetBlockHash();
                 }
-                numberOfCoins += lastBlock->accumulatorChanges[denomAndId].second;
+                numberOfCoins += change->second.nMints;
             }
         }
 
@@ -774,7 +1150,8 @@ int CZerocoinState::GetAccumulatorValueForSpend(int maxHeight, int denomination,
     return numberOfCoins;
 }
 
-libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin) {
+bool CZerocoinState::GetWitnessForSpendInputs(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                              CBigNum &accumulatorValue, vector<CBigNum> &coinsToAdd) {
     libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
     pair<int, int> denomAndId = pair<int, int>(denomination, id);
 
@@ -790,22 +1167,32 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
     // Find accumulator value preceding mint operation
     CBlockIndex *mintBlock = (*chain)[mintHeight];
     CBlockIndex *block = mintBlock;
-    libzerocoin::Accumulator accumulator(ZCParams, d);
+    accumulatorValue = libzerocoin::Accumulator(GetZerocoinParams(), d).getValue();
     if (block != coinGroup.firstBlock) {
+        CZerocoinBlockDataCache::DataPtr data;
         do {
             block = block->pprev;
-        } while (block->accumulatorChanges.count(denomAndId) == 0);
-        accumulator = libzerocoin::Accumulator(ZCParams, block->accumulatorChanges[denomAndId].first, d);
+            if (!(data = GetBlockData(block)))
+                return false;
+        } while (data->groups.count(denomAndId) == 0);
+        accumulatorValue = data->groups.at(denomAndId).accumulatorValue;
     }
 
-    // Now add to the accumulator every coin minted since that moment except pubCoin
+    // Now add to the accumulator every coin minted since that moment except pubCoin.
+    // The order doesn't matter, so they are accumulated in batches
+    coinsToAdd.clear();
     block = coinGroup.lastBlock;
     while(true) {
-        if (block->nHeight <= maxHeight && block->mintedPubCoins.count(denomAndId) > 0) {
-            vector<CBigNum> &pubCoins = block->mintedPubCoins[denomAndId];
-            for (const CBigNum &coin: pubCoins) {
-                if (block != mintBlock || coin != pubCoin)
-                    accumulator += libzerocoin::PublicCoin(ZCParams, coin, d);
+        if (block->nHeight <= maxHeight) {
+            CZerocoinBlockDataCache::DataPtr data = GetBlockData(block);
+            if (!data)
+                return false;
+            map<pair<int,int>, CZerocoinGroupChange>::const_iterator change = data->groups.find(denomAndId);
+            if (change != data->groups.end()) {
+                for (const CBigNum &coin: change->second.pubCoins) {
+                    if (block != mintBlock || coin != pubCoin)
+                        coinsToAdd.push_back(coin);
+                }
             }
         }
         if (block != mintBlock)
@@ -813,24 +1200,89 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
         else
             break;
     }
+    return true;
+}
+
+bool CZerocoinState::GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin, CBigNum &witnessValue) {
+    CBigNum accumulatorValue;
+    vector<CBigNum> coinsToAdd;
+    if (!GetWitnessForSpendInputs(chain, maxHeight, denomination, id, pubCoin, accumulatorValue, coinsToAdd))
+        return false;
+    witnessValue = AccumulateCoins(accumulatorValue, denomination, coinsToAdd);
+    return true;
+}
+
+bool CZerocoinState::GetCoinsToAdvanceWitness(int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                              int witnessHeight, vector<CBigNum> &coinsToAdd) {
+    pair<int, int> denomAndId = pair<int, int>(denomination, id);
+
+    if (coinGroups.count(denomAndId) == 0)
+        return false;
+
+    CoinGroupInfo coinGroup = coinGroups[denomAndId];
+
+    int coinId;
+    int mintHeight = GetMintedCoinHeightAndId(pubCoin, denomination, coinId);
+    if (mintHeight < 0 || coinId != id || mintHeight > min(maxHeight, witnessHeight))
+        return false;
+
+    // Collect the coins of the group minted between the two heights. Going back the
+    // witness stays valid only if there are none
+    int lowHeight = min(maxHeight, witnessHeight), highHeight = max(maxHeight, witnessHeight);
+    coinsToAdd.clear();
+    for (CBlockIndex *block = coinGroup.lastBlock; block != NULL && block->nHeight > lowHeight; block = block->pprev) {
+        if (block->nHeight <= highHeight) {
+            CZerocoinBlockDataCache::DataPtr data = GetBlockData(block);
+            if (!data)
+                return false;
+            map<pair<int,int>, CZerocoinGroupChange>::const_iterator change = data->groups.find(denomAndId);
+            if (change != data->groups.end()) {
+                if (maxHeight < witnessHeight)
+                    return false;
+                coinsToAdd.insert(coinsToAdd.end(), change->second.pubCoins.begin(), change->second.pubCoins.end());
+            }
+        }
+        if (block == coinGroup.firstBlock)
+            break;
+    }
+    return true;
+}
+
+bool CZerocoinState::AdvanceWitnessForSpend(int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                            CBigNum &witnessValue, int &witnessHeight) {
+    vector<CBigNum> coinsToAdd;
+    if (!GetCoinsToAdvanceWitness(maxHeight, denomination, id, pubCoin, witnessHeight, coinsToAdd))
+        return false;
+    witnessValue = AccumulateCoins(witnessValue, denomination, coinsToAdd);
+    witnessHeight = maxHeight;
+    return true;
+}
 
-    return libzerocoin::AccumulatorWitness(ZCParams, accumulator, libzerocoin::PublicCoin(ZCParams, pubCoin, d));
+CBigNum CZerocoinState::AccumulateCoins(const CBigNum &accumulatorValue, int denomination, const vector<CBigNum> &coins) {
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
+    vector<libzerocoin::PublicCoin> coinsToAdd;
+    coinsToAdd.reserve(coins.size());
+    for (const CBigNum &coin: coins)
+        coinsToAdd.push_back(libzerocoin::PublicCoin(GetZerocoinParams(), coin, d));
+    libzerocoin::Accumulator accumulator(GetZerocoinParams(), accumulatorValue, d);
+    accumulator.accumulateMany(coinsToAdd);
+    return accumulator.getValue();
 }
 
 int CZerocoinState::GetMintedCoinHeightAndId(const CBigNum &pubCoin, int denomination, int &id) {
-    auto coins = mintedPubCoins.equal_range(pubCoin);
-    auto coinIt = find_if(coins.first, coins.second,
-                          [=](const decltype(mintedPubCoins)::value_type &v) { return v.second.denomination == denomination; });
+    const CMintedCoinInfo *coinInfo = mintedPubCoins.find_if(GetDigest(pubCoin),
+                          [=](const CMintedCoinInfo &v) { return v.denomination == denomination; });
 
-    if (coinIt != mintedPubCoins.end()) {
-        id = coinIt->second.id;
-        return coinIt->second.nHeight;
+    if (coinInfo != NULL) {
+        id = coinInfo->id;
+        return coinInfo->nHeight;
     }
     else
         return -1;
 }
 
 void CZerocoinState::Reset() {
+    blockData.Clear();
     coinGroups.clear();
     usedCoinSerials.clear();
     mintedPubCoins.clear();
@@ -5,11 +5,19 @@
 #include "chain.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "flathashmap.h"
 #include "libzerocoin/Zerocoin.h"
 #include "zerocoin_params.h"
 #include <unordered_set>
 #include <unordered_map>
 #include <functional>
+#include <list>
+#include <atomic>
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/unordered_set.hpp>
 
 // Test for zerocoin transaction version 2
 inline bool IsZerocoinTxV2(libzerocoin::CoinDenomination denomination, int coinId) {
@@ -31,6 +39,94 @@ inline bool IsZerocoinTxV2(libzerocoin::CoinDenomination denomination, int coinI
     }
 }
 
+// Zerocoin parameters shared by the node and the wallet, built on first use
+const libzerocoin::Params *GetZerocoinParams();
+
+// DoS prevention: limit the cache of verified spend proofs to less than 4MB
+static const unsigned int DEFAULT_MAX_ZC_VERIFY_CACHE_SIZE = 4;
+
+struct CZerocoinVerifyCacheStats {
+    size_t nSize;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+// Statistics of the cache of verified spend proofs, see -zcverifycachesize
+CZerocoinVerifyCacheStats GetZerocoinVerifyCacheStats();
+
+class CZerocoinVerifyCacheHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/**
+ * Cache of successfully verified spend proofs, to avoid verifying the proofs of a spend
+ * twice (once when accepted into memory pool, and again when accepted into the block chain).
+ * Only the proof is covered: the serial number checks are always performed.
+ */
+class CZerocoinVerifyCache
+{
+private:
+    //! Entries are SHA256(nonce || tx hash || input index || denomination || accumulator value):
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, CZerocoinVerifyCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_zcverifycache;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+public:
+    CZerocoinVerifyCache();
+
+    void ComputeEntry(uint256& entry, const uint256 &hashTx, unsigned int nIn, int denomination, const CBigNum &accumulatorValue);
+    bool Get(const uint256& entry);
+    // Evicts random entries to stay within -zcverifycachesize, keeps nothing if it is 0
+    void Set(const uint256& entry);
+    void CountLookup(bool fHit);
+    CZerocoinVerifyCacheStats GetStats();
+};
+
+// The cache used by spend verification
+CZerocoinVerifyCache &GetZerocoinVerifyCache();
+
+// Number of blocks whose zerocoin data is kept in memory
+static const unsigned int ZC_BLOCK_DATA_CACHE_SIZE = 1000;
+
+/*
+ * Zerocoin data of the blocks (see CZerocoinBlockData), read from the block tree database
+ * when first needed and kept in a small LRU cache. Data of newly connected blocks is kept
+ * until it is written along with their index entries (see FlushStateToDisk). Thread safe,
+ * spend checks run in parallel
+ */
+class CZerocoinBlockDataCache {
+public:
+    typedef std::shared_ptr<const CZerocoinBlockData> DataPtr;
+
+    // Zerocoin data of the block, empty if it has none, NULL if it can't be read
+    DataPtr Get(const CBlockIndex *index);
+    // Store the zerocoin data of the block and set BLOCK_HAVE_ZEROCOIN if there is any
+    void Put(CBlockIndex *index, const CZerocoinBlockData &data);
+    // Hand out the data stored since the last call, to be written to the block tree database
+    void TakeDirty(vector<pair<const CBlockIndex *, DataPtr> > &vDirty);
+    // Forget all the cached blocks. Data not written yet is kept
+    void Clear();
+
+private:
+    void Cache(const uint256 &hash, const DataPtr &data);
+
+    boost::mutex cs;
+    // most recently used first
+    list<pair<uint256, DataPtr> > lru;
+    map<uint256, list<pair<uint256, DataPtr> >::iterator> entries;
+    // not written to the database yet
+    map<uint256, pair<const CBlockIndex *, DataPtr> > dirty;
+};
+
 // Zerocoin transaction info, added to the CBlock to ensure zerocoin mint/spend transactions got their info stored into
 // index
 class CZerocoinTxInfo {
@@ -41,6 +137,9 @@ public:
     vector<pair<int,CBigNum> > mints;
     // serial for every spend
     set<CBigNum> spentSerials;
+    // <tx hash, <input index, denomination>> of spends whose proof was verified ahead, see CZerocoinSpendCheck.
+    // Only valid for the CheckBlock pass that verified them.
+    set<pair<uint256, pair<unsigned int, int> > > verifiedSpends;
 
     // are there v1 spends in the block?
     bool fHasSpendV1;
@@ -53,6 +152,44 @@ public:
     void Complete();
 };
 
+// Zerocoin spend input, with one of the denominations CheckZerocoinTransaction verifies it for
+struct CZerocoinSpendInput {
+    const CTransaction *ptx;
+    unsigned int nIn;
+    libzerocoin::CoinDenomination denomination;
+
+    CZerocoinSpendInput(): ptx(NULL), nIn(0), denomination(libzerocoin::ZQ_LOVELACE) {}
+    CZerocoinSpendInput(const CTransaction &tx, unsigned int nInIn, libzerocoin::CoinDenomination denominationIn) :
+        ptx(&tx), nIn(nInIn), denomination(denominationIn) {}
+};
+
+// Append the zerocoin spend inputs of tx whose proofs CheckZerocoinTransaction verifies
+void GetZerocoinSpendInputs(const CTransaction &tx, vector<CZerocoinSpendInput> &spends);
+
+/**
+ * Closure verifying the proof of one zerocoin spend input, so that the proofs of all the
+ * spends in a block are verified in parallel before the block's transactions are checked
+ * in order. Always succeeds: the result goes to *pfVerified, and a spend that fails is
+ * verified again by CheckSpendEledgerTransaction to report the error.
+ */
+class CZerocoinSpendCheck
+{
+private:
+    CZerocoinSpendInput spend;
+    bool *pfVerified;
+
+public:
+    CZerocoinSpendCheck(): pfVerified(NULL) {}
+    CZerocoinSpendCheck(const CZerocoinSpendInput &spendIn, bool *pfVerifiedIn) : spend(spendIn), pfVerified(pfVerifiedIn) { }
+
+    bool operator()();
+
+    void swap(CZerocoinSpendCheck &check) {
+        std::swap(spend, check.spend);
+        std::swap(pfVerified, check.pfVerified);
+    }
+};
+
 bool CheckZerocoinFoundersInputs(const CTransaction &tx, CValidationState &state, int nHeight, bool fTestNet);
 bool CheckZerocoinTransaction(const CTransaction &tx,
 	CValidationState &state,
@@ -62,7 +199,7 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
     bool isCheckWallet,
     CZerocoinTxInfo *zerocoinTxInfo);
 
-void DisconnectTipZC(CBlock &block, CBlockIndex *pindexDelete);
+bool DisconnectTipZC(CBlock &block, CBlockIndex *pindexDelete);
 bool ConnectTipZC(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock);
 
 int ZerocoinGetNHeight(const CBlockHeader &block);
@@ -86,10 +223,14 @@ public:
         int nCoins;
     };
 
+    // Digest of a coin value or serial, which is what the state keeps of them. SHA256 of the
+    // magnitude and sign, computed without allocating
+    static uint256 GetDigest(const CBigNum &value);
+
 private:
-    // Custom hash for big numbers
-    struct CBigNumHash {
-        std::size_t operator()(const CBigNum &bn) const noexcept;
+    // Digests are uniformly distributed already
+    struct CDigestHash {
+        std::size_t operator()(const uint256 &digest) const { return digest.GetCheapHash(); }
     };
 
     struct CMintedCoinInfo {
@@ -98,27 +239,38 @@ private:
         int         nHeight;
     };
 
+    // Zerocoin data of the blocks
+    CZerocoinBlockDataCache blockData;
+
     // Collection of coin groups. Map from <denomination,id> to CoinGroupInfo structure
     map<pair<int, int>, CoinGroupInfo> coinGroups;
-    // Set of all used coin serials. Allows multiple entries for the same coin serial for historical reasons
-    unordered_multiset<CBigNum,CBigNumHash> usedCoinSerials;
-    // Set of all minted pubCoin values
-    unordered_multimap<CBigNum,CMintedCoinInfo,CBigNumHash> mintedPubCoins;
+    // Digests of all used coin serials. Allows multiple entries for the same coin serial for historical reasons
+    flathashmultiset<uint256,CDigestHash> usedCoinSerials;
+    // Digests of all minted pubCoin values
+    flathashmultimap<uint256,CMintedCoinInfo,CDigestHash> mintedPubCoins;
     // Latest IDs of coins by denomination
     map<int, int> latestCoinIds;
 
 public:
     CZerocoinState();
 
-    // Add mint, automatically assigning id to it. Returns id and previous accumulator value (if any)
+    // Add mint, automatically assigning id to it. Returns id and previous accumulator value (if any),
+    // -1 if the data of the group's last block can't be read
     int AddMint(CBlockIndex *index, int denomination, const CBigNum &pubCoin, CBigNum &previousAccValue);
     // Add serial to the list of used ones
     void AddSpend(const CBigNum &serial);
 
-    // Add everything from the block to the state
-    void AddBlock(CBlockIndex *index);
-    // Disconnect block from the chain rolling back mints and spends
-    void RemoveBlock(CBlockIndex *index);
+    // Zerocoin data of the block, empty if it has none, NULL if it can't be read
+    CZerocoinBlockDataCache::DataPtr GetBlockData(const CBlockIndex *index);
+    // Store the zerocoin data of a newly connected block
+    void SetBlockData(CBlockIndex *index, const CZerocoinBlockData &data);
+    // Data of the blocks connected since the last call, to be written with their index entries
+    void TakeDirtyBlockData(vector<pair<const CBlockIndex *, CZerocoinBlockDataCache::DataPtr> > &vDirty);
+
+    // Add everything from the block to the state. Returns false if the block data can't be read
+    bool AddBlock(CBlockIndex *index);
+    // Disconnect block from the chain rolling back mints and spends. Returns false if the block data can't be read
+    bool RemoveBlock(CBlockIndex *index);
 
     // Query coin group with given denomination and id
     bool GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result);
@@ -130,11 +282,27 @@ public:
 
     // Given denomination and id returns latest accumulator value and corresponding block hash
     // Do not take into account coins with height more than maxHeight
-    // Returns number of coins satisfying conditions
+    // Returns number of coins satisfying conditions, 0 if the block data can't be read
     int GetAccumulatorValueForSpend(int maxHeight, int denomination, int id, CBigNum &accumulator, uint256 &blockHash);
 
-    // Get witness
-    libzerocoin::AccumulatorWitness GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin);
+    // Get witness value, false if the block data can't be read
+    bool GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin, CBigNum &witnessValue);
+    // Accumulator value and coins GetWitnessForSpend accumulates, so that the accumulation can be done
+    // later without holding cs_main (see AccumulateCoins)
+    bool GetWitnessForSpendInputs(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                  CBigNum &accumulatorValue, vector<CBigNum> &coinsToAdd);
+
+    // Bring the value of a witness to pubCoin covering the coins minted up to witnessHeight to the one
+    // GetWitnessForSpend would return for maxHeight. Going back is possible only over blocks without
+    // coins of the group. Returns false if the witness has to be computed anew
+    bool AdvanceWitnessForSpend(int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                CBigNum &witnessValue, int &witnessHeight);
+    // Coins AdvanceWitnessForSpend accumulates into the witness value, false if it would fail
+    bool GetCoinsToAdvanceWitness(int maxHeight, int denomination, int id, const CBigNum &pubCoin,
+                                  int witnessHeight, vector<CBigNum> &coinsToAdd);
+
+    // Accumulate coins of a denomination into an accumulator value. Doesn't use the state
+    static CBigNum AccumulateCoins(const CBigNum &accumulatorValue, int denomination, const vector<CBigNum> &coins);
 
     // Return height of mint transaction and id of minted coin
     int GetMintedCoinHeightAndId(const CBigNum &pubCoin, int denomination, int &id);
@@ -46,4 +46,7 @@ static const int64_t DUST_HARD_LIMIT = 1000;   // 0.00001 P2P mininput
 // number of mint confirmations needed to spend coin
 #define ZC_MINT_CONFIRMATIONS               6
 
+// maximum number of coins minted by a single mintmanyzerocoin transaction
+#define ZC_MAX_MINTS_PER_TX                 100
+
 #endif
@@ -6,6 +6,7 @@
 #include "consensus/validation.h"
 #include "darksend.h"
 #include "init.h"
+#include "txdb.h"
 //#include "governance.h"
 #include "znode.h"
 #include "znode-payments.h"
@@ -35,7 +36,8 @@ CEnode::CEnode() :
         nPoSeBanScore(0),
         nPoSeBanHeight(0),
         fAllowMixingTx(true),
-        fUnitTest(false) {}
+        fUnitTest(false),
+        fCollateralChecked(false) {}
 
 CEnode::CEnode(CService addrNew, CTxIn vinNew, CPubKey pubKeyCollateralAddressNew, CPubKey pubKeyEnodeNew, int nProtocolVersionIn) :
         vin(vinNew),
@@ -56,7 +58,8 @@ CEnode::CEnode(CService addrNew, CTxIn vinNew, CPubKey pubKeyCollateralAddressNe
         nPoSeBanScore(0),
         nPoSeBanHeight(0),
         fAllowMixingTx(true),
-        fUnitTest(false) {}
+        fUnitTest(false),
+        fCollateralChecked(false) {}
 
 CEnode::CEnode(const CEnode &other) :
         vin(other.vin),
@@ -77,7 +80,8 @@ CEnode::CEnode(const CEnode &other) :
         nPoSeBanScore(other.nPoSeBanScore),
         nPoSeBanHeight(other.nPoSeBanHeight),
         fAllowMixingTx(other.fAllowMixingTx),
-        fUnitTest(other.fUnitTest) {}
+        fUnitTest(other.fUnitTest),
+        fCollateralChecked(other.fCollateralChecked) {}
 
 CEnode::CEnode(const CEnodeBroadcast &mnb) :
         vin(mnb.vin),
@@ -98,7 +102,23 @@ CEnode::CEnode(const CEnodeBroadcast &mnb) :
         nPoSeBanScore(0),
         nPoSeBanHeight(0),
         fAllowMixingTx(true),
-        fUnitTest(false) {}
+        fUnitTest(false),
+        fCollateralChecked(false) {}
+
+namespace {
+// Lets the Enode manager know when a check changed the state of an Enode, its cached ranks depend on it
+class CEnodeStateWatch
+{
+    const int &nActiveState;
+    const int nActiveStateOnEntry;
+public:
+    explicit CEnodeStateWatch(const int &nActiveStateIn) : nActiveState(nActiveStateIn), nActiveStateOnEntry(nActiveStateIn) {}
+    ~CEnodeStateWatch() {
+        if (nActiveState != nActiveStateOnEntry)
+            mnodeman.NotifyEnodeStateChanged();
+    }
+};
+}
 
 //CSporkManager sporkManager;
 //
@@ -107,7 +127,11 @@ CEnode::CEnode(const CEnodeBroadcast &mnb) :
 bool CEnode::UpdateFromNewBroadcast(CEnodeBroadcast &mnb) {
     if (mnb.sigTime <= sigTime && !mnb.fRecovery) return false;
 
+    CPubKey pubKeyEnodeOld = pubKeyEnode;
     pubKeyEnode = mnb.pubKeyEnode;
+    if (pubKeyEnode != pubKeyEnodeOld) {
+        mnodeman.NotifyEnodePubKeyChanged(*this, pubKeyEnodeOld);
+    }
     sigTime = mnb.sigTime;
     vchSig = mnb.vchSig;
     nProtocolVersion = mnb.nProtocolVersion;
@@ -115,6 +139,8 @@ bool CEnode::UpdateFromNewBroadcast(CEnodeBroadcast &mnb) {
     nPoSeBanScore = 0;
     nPoSeBanHeight = 0;
     nTimeLastChecked = 0;
+    // the protocol version may have changed
+    mnodeman.NotifyEnodeStateChanged();
     int nDos = 0;
     if (mnb.lastPing == CEnodePing() || (mnb.lastPing != CEnodePing() && mnb.lastPing.CheckAndUpdate(this, true, nDos))) {
         lastPing = mnb.lastPing;
@@ -142,11 +168,18 @@ bool CEnode::UpdateFromNewBroadcast(CEnodeBroadcast &mnb) {
 // and get paid this block
 //
 arith_uint256 CEnode::CalculateScore(const uint256 &blockHash) {
-    uint256 aux = ArithToUint256(UintToArith256(vin.prevout.hash) + vin.prevout.n);
+    return CalculateScore(blockHash, CalculateBlockScore(blockHash));
+}
 
+arith_uint256 CEnode::CalculateBlockScore(const uint256 &blockHash) {
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << blockHash;
-    arith_uint256 hash2 = UintToArith256(ss.GetHash());
+    return UintToArith256(ss.GetHash());
+}
+
+arith_uint256 CEnode::CalculateScore(const uint256 &blockHash, const arith_uint256 &hashBlockScore) {
+    uint256 aux = ArithToUint256(UintToArith256(vin.prevout.hash) + vin.prevout.n);
+    const arith_uint256 &hash2 = hashBlockScore;
 
     CHashWriter ss2(SER_GETHASH, PROTOCOL_VERSION);
     ss2 << blockHash;
@@ -158,6 +191,7 @@ arith_uint256 CEnode::CalculateScore(const uint256 &blockHash) {
 
 void CEnode::Check(bool fForce) {
     LOCK(cs);
+    CEnodeStateWatch stateWatch(nActiveState);
 
     if (ShutdownRequested()) return;
 
@@ -171,19 +205,26 @@ void CEnode::Check(bool fForce) {
 
     int nHeight = 0;
     if (!fUnitTest) {
-        TRY_LOCK(cs_main, lockMain);
-        if (!lockMain) return;
-
-        CCoins coins;
-        if (!pcoinsTip->GetCoins(vin.prevout.hash, coins) ||
-            (unsigned int) vin.prevout.n >= coins.vout.size() ||
-            coins.vout[vin.prevout.n].IsNull()) {
-            nActiveState = ENODE_OUTPOINT_SPENT;
-            LogPrint("znode", "CEnode::Check -- Failed to find Enode UTXO, znode=%s\n", vin.prevout.ToStringShort());
-            return;
+        // look the collateral up once, CEnodeMan::SyncTransaction reports what happens to it later
+        if (!fCollateralChecked) {
+            TRY_LOCK(cs_main, lockMain);
+            if (!lockMain) return;
+
+            CCoins coins;
+            if (!pcoinsTip->GetCoins(vin.prevout.hash, coins) ||
+                (unsigned int) vin.prevout.n >= coins.vout.size() ||
+                coins.vout[vin.prevout.n].IsNull()) {
+                nActiveState = ENODE_OUTPOINT_SPENT;
+                LogPrint("znode", "CEnode::Check -- Failed to find Enode UTXO, znode=%s\n", vin.prevout.ToStringShort());
+                return;
+            }
+            if (nCacheCollateralBlock == 0) {
+                nCacheCollateralBlock = coins.nHeight - 1;
+            }
+            fCollateralChecked = true;
         }
 
-        nHeight = chainActive.Height();
+        nHeight = mnodeman.GetCachedBlockHeight();
     }
 
     if (IsPoSeBanned()) {
@@ -370,13 +411,10 @@ std::string CEnode::ToString() const {
 }
 
 int CEnode::GetCollateralAge() {
-    int nHeight;
-    {
-        TRY_LOCK(cs_main, lockMain);
-        if (!lockMain || !chainActive.Tip()) return -1;
-        nHeight = chainActive.Height();
-    }
+    int nHeight = mnodeman.GetCachedBlockHeight();
+    if (nHeight < 0) return -1;
 
+    // normally set by the first Check
     if (nCacheCollateralBlock == 0) {
         int nInputAge = GetInputAge(vin);
         if (nInputAge > 0) {
@@ -389,6 +427,20 @@ int CEnode::GetCollateralAge() {
     return nHeight - nCacheCollateralBlock;
 }
 
+void CEnode::SetOutpointSpent() {
+    LOCK(cs);
+    CEnodeStateWatch stateWatch(nActiveState);
+    if (IsOutpointSpent()) return;
+    nActiveState = ENODE_OUTPOINT_SPENT;
+    LogPrint("znode", "CEnode::SetOutpointSpent -- Enode UTXO spent, znode=%s\n", vin.prevout.ToStringShort());
+}
+
+void CEnode::ResetCollateralCheck() {
+    LOCK(cs);
+    fCollateralChecked = false;
+    nCacheCollateralBlock = 0;
+}
+
 void CEnode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScanBack) {
     if (!pindex) {
         LogPrintf("CEnode::UpdateLastPaid pindex is NULL\n");
@@ -400,6 +452,29 @@ void CEnode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScanBack)
     CScript mnpayee = GetScriptForDestination(pubKeyCollateralAddress.GetID());
     LogPrint("znode", "CEnode::UpdateLastPaidBlock -- searching for block with payment to %s\n", vin.prevout.ToStringShort());
 
+    if (fEnodePayeeIndex) {
+        // Same range as the scan below: the last nMaxBlocksToScanBack blocks after nBlockLastPaid
+        int nMinHeight = std::max(nBlockLastPaid + 1, pindex->nHeight - nMaxBlocksToScanBack + 1);
+        std::vector<std::pair<int, CEnodePayeeValue> > vPayments;
+        if (nMinHeight > pindex->nHeight || !pblocktree->ReadEnodePayments(mnpayee, pindex->nHeight, nMinHeight, vPayments))
+            return;
+
+        LOCK(cs_mapEnodeBlocks);
+        for (std::vector<std::pair<int, CEnodePayeeValue> >::const_iterator it = vPayments.begin(); it != vPayments.end(); ++it) {
+            const CBlockIndex *pindexPaid = pindex->GetAncestor(it->first);
+            if (!pindexPaid || pindexPaid->GetBlockHash() != it->second.hashBlock)
+                continue;
+            if (mnpayments.mapEnodeBlocks.count(it->first) &&
+                mnpayments.mapEnodeBlocks[it->first].HasPayeeWithVotes(mnpayee, 2)) {
+                nBlockLastPaid = it->first;
+                nTimeLastPaid = pindexPaid->nTime;
+                LogPrint("znode", "CEnode::UpdateLastPaidBlock -- searching for block with payment to %s -- found new %d\n", vin.prevout.ToStringShort(), nBlockLastPaid);
+                return;
+            }
+        }
+        return;
+    }
+
     LOCK(cs_mapEnodeBlocks);
 
     for (int i = 0; BlockReading && BlockReading->nHeight > nBlockLastPaid && i < nMaxBlocksToScanBack; i++) {
@@ -176,6 +176,9 @@ public:
     int nPoSeBanHeight;
     bool fAllowMixingTx;
     bool fUnitTest;
+    // Collateral found in the UTXO set, spends are reported by CEnodeMan from then on. Not serialized,
+    // so every Enode is looked up again after a restart
+    bool fCollateralChecked;
 
     // KEEP TRACK OF GOVERNANCE ITEMS EACH ENODE HAS VOTE UPON FOR RECALCULATION
     std::map<uint256, int> mapGovernanceObjectsVotedOn;
@@ -238,11 +241,15 @@ public:
         swap(first.nPoSeBanHeight, second.nPoSeBanHeight);
         swap(first.fAllowMixingTx, second.fAllowMixingTx);
         swap(first.fUnitTest, second.fUnitTest);
+        swap(first.fCollateralChecked, second.fCollateralChecked);
         swap(first.mapGovernanceObjectsVotedOn, second.mapGovernanceObjectsVotedOn);
     }
 
     // CALCULATE A RANK AGAINST OF GIVEN BLOCK
     arith_uint256 CalculateScore(const uint256& blockHash);
+    /// Same, with the part that only depends on the block computed once for all Enodes
+    arith_uint256 CalculateScore(const uint256& blockHash, const arith_uint256& hashBlockScore);
+    static arith_uint256 CalculateBlockScore(const uint256& blockHash);
 
     bool UpdateFromNewBroadcast(CEnodeBroadcast& mnb);
 
@@ -296,6 +303,11 @@ public:
 
     int GetCollateralAge();
 
+    /// A connected block spent the collateral
+    void SetOutpointSpent();
+    /// The collateral transaction left the chain, the next Check looks the collateral up again
+    void ResetCollateralCheck();
+
     int GetLastPaidTime() { return nTimeLastPaid; }
     int GetLastPaidBlock() { return nBlockLastPaid; }
     void UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScanBack);
@@ -9,23 +9,18 @@
 #include "znode-payments.h"
 #include "znode-sync.h"
 #include "znodeman.h"
+#include "hash.h"
 #include "netfulfilledman.h"
+#include "random.h"
 #include "util.h"
 
+#include <limits>
+
 /** Enode manager */
 CEnodeMan mnodeman;
 
 const std::string CEnodeMan::SERIALIZATION_VERSION_STRING = "CEnodeMan-Version-4";
 
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, CEnode*>& t1,
-                    const std::pair<int, CEnode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
-    }
-};
-
 struct CompareScoreMN
 {
     bool operator()(const std::pair<int64_t, CEnode*>& t1,
@@ -97,6 +92,8 @@ void CEnodeIndex::RebuildIndex()
 }
 
 CEnodeMan::CEnodeMan() : cs(),
+  pCurrentBlockIndex(NULL),
+  nCachedBlockHeight(-1),
   vEnodes(),
   mAskedUsForEnodeList(),
   mWeAskedForEnodeList(),
@@ -113,6 +110,7 @@ CEnodeMan::CEnodeMan() : cs(),
   fEnodesRemoved(false),
 //  vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  nEnodeStateVersion(0),
   mapSeenEnodeBroadcast(),
   mapSeenEnodePing(),
   nDsqCount(0)
@@ -126,8 +124,10 @@ bool CEnodeMan::Add(CEnode &mn)
     if (pmn == NULL) {
         LogPrint("znode", "CEnodeMan::Add -- Adding new Enode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
         vEnodes.push_back(mn);
+        AddToLookup(vEnodes.back());
         indexEnodes.AddEnodeVIN(mn.vin);
         fEnodesAdded = true;
+        ClearRankCache();
         return true;
     }
 
@@ -188,7 +188,7 @@ void CEnodeMan::CheckAndRemove()
         Check();
 
         // Remove spent znodes, prepare structures and make requests to reasure the state of inactive ones
-        std::vector<CEnode>::iterator it = vEnodes.begin();
+        std::list<CEnode>::iterator it = vEnodes.begin();
         std::vector<std::pair<int, CEnode> > vecEnodeRanks;
         // ask for up to MNB_RECOVERY_MAX_ASK_ENTRIES znode entries at a time
         int nAskForMnbRecovery = MNB_RECOVERY_MAX_ASK_ENTRIES;
@@ -205,8 +205,10 @@ void CEnodeMan::CheckAndRemove()
 
                 // and finally remove it from the list
 //                it->FlagGovernanceItemsAsDirty();
+                RemoveFromLookup(*it);
                 it = vEnodes.erase(it);
                 fEnodesRemoved = true;
+                ClearRankCache();
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -366,6 +368,11 @@ void CEnodeMan::Clear()
 {
     LOCK(cs);
     vEnodes.clear();
+    mapEnodesByOutpoint.clear();
+    mapEnodesByPubKey.clear();
+    mapEnodesByPayee.clear();
+    setEnodesByLastPaid.clear();
+    ClearRankCache();
     mAskedUsForEnodeList.clear();
     mWeAskedForEnodeList.clear();
     mWeAskedForEnodeListEntry.clear();
@@ -443,40 +450,91 @@ void CEnodeMan::DsegUpdate(CNode* pnode)
     LogPrint("znode", "CEnodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
-CEnode* CEnodeMan::Find(const CScript &payee)
+// Chosen at startup, so that peers can't pick keys colliding in the lookup tables
+static uint64_t GetLookupSalt(int n)
 {
-    LOCK(cs);
+    static const uint64_t salt[2] = {GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())};
+    return salt[n];
+}
 
-    BOOST_FOREACH(CEnode& mn, vEnodes)
-    {
-        if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) == payee)
-            return &mn;
+size_t CEnodeMan::COutPointHash::operator()(const COutPoint& outpoint) const
+{
+    return CSipHasher(GetLookupSalt(0), GetLookupSalt(1)).Write(outpoint.hash.begin(), 32).Write(outpoint.n).Finalize();
+}
+
+size_t CEnodeMan::CPubKeyHash::operator()(const CPubKey& pubKey) const
+{
+    return CSipHasher(GetLookupSalt(0), GetLookupSalt(1)).Write(pubKey.begin(), pubKey.size()).Finalize();
+}
+
+size_t CEnodeMan::CScriptHash::operator()(const CScript& script) const
+{
+    return CSipHasher(GetLookupSalt(0), GetLookupSalt(1)).Write(&script[0], script.size()).Finalize();
+}
+
+void CEnodeMan::AddToLookup(CEnode& mn)
+{
+    AssertLockHeld(cs);
+    mapEnodesByOutpoint.insert(mn.vin.prevout, &mn);
+    mapEnodesByPubKey.insert(mn.pubKeyEnode, &mn);
+    mapEnodesByPayee.insert(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), &mn);
+    setEnodesByLastPaid.insert(std::make_pair(mn.GetLastPaidBlock(), &mn));
+}
+
+void CEnodeMan::RemoveFromLookup(CEnode& mn)
+{
+    AssertLockHeld(cs);
+    CEnode* pmn = &mn;
+    mapEnodesByOutpoint.erase_if(mn.vin.prevout, [=](CEnode* p) { return p == pmn; });
+    mapEnodesByPubKey.erase_if(mn.pubKeyEnode, [=](CEnode* p) { return p == pmn; });
+    mapEnodesByPayee.erase_if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), [=](CEnode* p) { return p == pmn; });
+    setEnodesByLastPaid.erase(std::make_pair(mn.GetLastPaidBlock(), pmn));
+}
+
+void CEnodeMan::RebuildLookup()
+{
+    AssertLockHeld(cs);
+    mapEnodesByOutpoint.clear();
+    mapEnodesByPubKey.clear();
+    mapEnodesByPayee.clear();
+    setEnodesByLastPaid.clear();
+    mapEnodesByOutpoint.reserve(vEnodes.size());
+    mapEnodesByPubKey.reserve(vEnodes.size());
+    mapEnodesByPayee.reserve(vEnodes.size());
+    BOOST_FOREACH(CEnode& mn, vEnodes) {
+        AddToLookup(mn);
     }
-    return NULL;
 }
 
-CEnode* CEnodeMan::Find(const CTxIn &vin)
+void CEnodeMan::NotifyEnodePubKeyChanged(CEnode& mn, const CPubKey& pubKeyEnodeOld)
 {
     LOCK(cs);
-
-    BOOST_FOREACH(CEnode& mn, vEnodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
+    CEnode* pmn = &mn;
+    // Enodes outside of the list, like the ones being checked, are not looked up
+    if(mapEnodesByPubKey.erase_if(pubKeyEnodeOld, [=](CEnode* p) { return p == pmn; })) {
+        mapEnodesByPubKey.insert(mn.pubKeyEnode, pmn);
     }
-    return NULL;
 }
 
-CEnode* CEnodeMan::Find(const CPubKey &pubKeyEnode)
+CEnode* CEnodeMan::Find(const CScript &payee)
 {
     LOCK(cs);
+    CEnode* const* ppmn = mapEnodesByPayee.find(payee);
+    return ppmn ? *ppmn : NULL;
+}
 
-    BOOST_FOREACH(CEnode& mn, vEnodes)
-    {
-        if(mn.pubKeyEnode == pubKeyEnode)
-            return &mn;
-    }
-    return NULL;
+CEnode* CEnodeMan::Find(const CTxIn &vin)
+{
+    LOCK(cs);
+    CEnode* const* ppmn = mapEnodesByOutpoint.find(vin.prevout);
+    return ppmn ? *ppmn : NULL;
+}
+
+CEnode* CEnodeMan::Find(const CPubKey &pubKeyEnode)
+{
+    LOCK(cs);
+    CEnode* const* ppmn = mapEnodesByPubKey.find(pubKeyEnode);
+    return ppmn ? *ppmn : NULL;
 }
 
 bool CEnodeMan::Get(const CPubKey& pubKeyEnode, CEnode& znode)
@@ -534,46 +592,46 @@ bool CEnodeMan::Has(const CTxIn& vin)
     return (pMN != NULL);
 }
 
-char* CEnodeMan::GetNotQualifyReason(CEnode& mn, int nBlockHeight, bool fFilterSigTime, int nMnCount)
+bool CEnodeMan::IsQualifiedForPayment(CEnode& mn, int nBlockHeight, bool fFilterSigTime, int nMnCount, std::string* pstrReason)
 {
     if (!mn.IsValidForPayment()) {
-        char* reasonStr = new char[256];
-        sprintf(reasonStr, "false: 'not valid for payment'");
-        return reasonStr;
+        if (pstrReason) *pstrReason = "false: 'not valid for payment'";
+        return false;
     }
     // //check protocol version
     if (mn.nProtocolVersion < mnpayments.GetMinEnodePaymentsProto()) {
-        // LogPrintf("Invalid nProtocolVersion!\n");
-        // LogPrintf("mn.nProtocolVersion=%s!\n", mn.nProtocolVersion);
-        // LogPrintf("mnpayments.GetMinEnodePaymentsProto=%s!\n", mnpayments.GetMinEnodePaymentsProto());
-        char* reasonStr = new char[256];
-        sprintf(reasonStr, "false: 'Invalid nProtocolVersion', nProtocolVersion=%d", mn.nProtocolVersion);
-        return reasonStr;
+        if (pstrReason) *pstrReason = strprintf("false: 'Invalid nProtocolVersion', nProtocolVersion=%d", mn.nProtocolVersion);
+        return false;
     }
     //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
     if (mnpayments.IsScheduled(mn, nBlockHeight)) {
-        // LogPrintf("mnpayments.IsScheduled!\n");
-        char* reasonStr = new char[256];
-        sprintf(reasonStr, "false: 'is scheduled'");
-        return reasonStr;
+        if (pstrReason) *pstrReason = "false: 'is scheduled'";
+        return false;
     }
     //it's too new, wait for a cycle
     if (fFilterSigTime && mn.sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) {
-        // LogPrintf("it's too new, wait for a cycle!\n");
-        char* reasonStr = new char[256];
-        sprintf(reasonStr, "false: 'too new', sigTime=%s, will be qualifed after=%s",
-                DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime).c_str(), DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime + (nMnCount * 2.6 * 60)).c_str());
-        return reasonStr;
+        if (pstrReason) *pstrReason = strprintf("false: 'too new', sigTime=%s, will be qualifed after=%s",
+                DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime), DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime + (nMnCount * 2.6 * 60)));
+        return false;
     }
     //make sure it has at least as many confirmations as there are znodes
-    if (mn.GetCollateralAge() < nMnCount) {
-        // LogPrintf("mn.GetCollateralAge()=%s!\n", mn.GetCollateralAge());
-        // LogPrintf("nMnCount=%s!\n", nMnCount);
-        char* reasonStr = new char[256];
-        sprintf(reasonStr, "false: 'collateralAge < znCount', collateralAge=%d, znCount=%d", mn.GetCollateralAge(), nMnCount);
-        return reasonStr;
+    int nCollateralAge = mn.GetCollateralAge();
+    if (nCollateralAge < nMnCount) {
+        if (pstrReason) *pstrReason = strprintf("false: 'collateralAge < znCount', collateralAge=%d, znCount=%d", nCollateralAge, nMnCount);
+        return false;
     }
-    return NULL;
+    return true;
+}
+
+char* CEnodeMan::GetNotQualifyReason(CEnode& mn, int nBlockHeight, bool fFilterSigTime, int nMnCount)
+{
+    std::string strReason;
+    if (IsQualifiedForPayment(mn, nBlockHeight, fFilterSigTime, nMnCount, &strReason)) {
+        return NULL;
+    }
+    char* reasonStr = new char[256];
+    snprintf(reasonStr, 256, "%s", strReason.c_str());
+    return reasonStr;
 }
 
 //
@@ -589,78 +647,57 @@ CEnode* CEnodeMan::GetNextEnodeInQueueForPayment(bool fFilterSigTime, int& nCoun
 }
 
 CEnode* CEnodeMan::GetNextEnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount)
+{
+    return FindNextEnodeInQueueForPayment(nBlockHeight, fFilterSigTime, nCount, false);
+}
+
+int CEnodeMan::CountQualifiedForPayment(bool fFilterSigTime)
+{
+    if(!pCurrentBlockIndex) {
+        return 0;
+    }
+    int nCount = 0;
+    FindNextEnodeInQueueForPayment(pCurrentBlockIndex->nHeight, fFilterSigTime, nCount, true);
+    return nCount;
+}
+
+CEnode* CEnodeMan::FindNextEnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, bool fCountAll)
 {
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
     CEnode *pBestEnode = NULL;
-    std::vector<std::pair<int, CEnode*> > vecEnodeLastPaid;
+    std::vector<CEnode*> vecEnodeLastPaid;
+
+    int nMnCount = CountEnabled();
+    int nTenthNetwork = nMnCount/10;
 
     /*
-        Make a vector with all of the last paid times
+        Take the qualified Enodes from the front of the queue, which is sorted low to high by last paid block.
+        Enough of them to score the oldest tenth and to know whether the fallback below applies.
     */
-    int nMnCount = CountEnabled();
-    int index = 0;
-    BOOST_FOREACH(CEnode &mn, vEnodes)
-    {
-        index += 1;
-        // LogPrintf("index=%s, mn=%s\n", index, mn.ToString());
-        /*if (!mn.IsValidForPayment()) {
-            LogPrint("znodeman", "Enode, %s, addr(%s), not-qualified: 'not valid for payment'\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString());
-            continue;
-        }
-        // //check protocol version
-        if (mn.nProtocolVersion < mnpayments.GetMinEnodePaymentsProto()) {
-            // LogPrintf("Invalid nProtocolVersion!\n");
-            // LogPrintf("mn.nProtocolVersion=%s!\n", mn.nProtocolVersion);
-            // LogPrintf("mnpayments.GetMinEnodePaymentsProto=%s!\n", mnpayments.GetMinEnodePaymentsProto());
-            LogPrint("znodeman", "Enode, %s, addr(%s), not-qualified: 'invalid nProtocolVersion'\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString());
-            continue;
-        }
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (mnpayments.IsScheduled(mn, nBlockHeight)) {
-            // LogPrintf("mnpayments.IsScheduled!\n");
-            LogPrint("znodeman", "Enode, %s, addr(%s), not-qualified: 'IsScheduled'\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString());
-            continue;
-        }
-        //it's too new, wait for a cycle
-        if (fFilterSigTime && mn.sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) {
-            // LogPrintf("it's too new, wait for a cycle!\n");
-            LogPrint("znodeman", "Enode, %s, addr(%s), not-qualified: 'it's too new, wait for a cycle!', sigTime=%s, will be qualifed after=%s\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString(), DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime).c_str(), DateTimeStrFormat("%Y-%m-%d %H:%M UTC", mn.sigTime + (nMnCount * 2.6 * 60)).c_str());
-            continue;
-        }
-        //make sure it has at least as many confirmations as there are znodes
-        if (mn.GetCollateralAge() < nMnCount) {
-            // LogPrintf("mn.GetCollateralAge()=%s!\n", mn.GetCollateralAge());
-            // LogPrintf("nMnCount=%s!\n", nMnCount);
-            LogPrint("znodeman", "Enode, %s, addr(%s), not-qualified: 'mn.GetCollateralAge() < nMnCount', CollateralAge=%d, nMnCount=%d\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString(), mn.GetCollateralAge(), nMnCount);
-            continue;
-        }*/
-        char* reasonStr = GetNotQualifyReason(mn, nBlockHeight, fFilterSigTime, nMnCount);
-        if (reasonStr != NULL) {
-            LogPrint("znodeman", "Enode, %s, addr(%s), qualify %s\n",
-                     mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString(), reasonStr);
-            delete [] reasonStr;
+    size_t nNeeded = std::max(std::max(nTenthNetwork, 1), fFilterSigTime ? nMnCount / 3 : 0);
+    bool fLogReasons = LogAcceptCategory("znodeman");
+    std::string strReason;
+    std::set<std::pair<int, CEnode*>, CompareLastPaidBlock>::const_iterator it = setEnodesByLastPaid.begin();
+    for (; it != setEnodesByLastPaid.end() && (fCountAll || vecEnodeLastPaid.size() < nNeeded); ++it) {
+        CEnode &mn = *it->second;
+        if (!IsQualifiedForPayment(mn, nBlockHeight, fFilterSigTime, nMnCount, fLogReasons ? &strReason : NULL)) {
+            if (fLogReasons) {
+                LogPrint("znodeman", "Enode, %s, addr(%s), qualify %s\n",
+                         mn.vin.prevout.ToStringShort(), CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString(), strReason);
+            }
             continue;
         }
-        vecEnodeLastPaid.push_back(std::make_pair(mn.GetLastPaidBlock(), &mn));
+        vecEnodeLastPaid.push_back(&mn);
     }
     nCount = (int)vecEnodeLastPaid.size();
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
     if(fFilterSigTime && nCount < nMnCount / 3) {
-        // LogPrintf("Need Return, nCount=%s, nMnCount/3=%s\n", nCount, nMnCount/3);
-        return GetNextEnodeInQueueForPayment(nBlockHeight, false, nCount);
+        return FindNextEnodeInQueueForPayment(nBlockHeight, false, nCount, fCountAll);
     }
 
-    // Sort them low to high
-    sort(vecEnodeLastPaid.begin(), vecEnodeLastPaid.end(), CompareLastPaidBlock());
-
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CEnode::GetNextEnodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
@@ -670,14 +707,13 @@ CEnode* CEnodeMan::GetNextEnodeInQueueForPayment(int nBlockHeight, bool fFilterS
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
     int nCountTenth = 0;
     arith_uint256 nHighest = 0;
-    BOOST_FOREACH (PAIRTYPE(int, CEnode*)& s, vecEnodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+    BOOST_FOREACH (CEnode* pmn, vecEnodeLastPaid){
+        arith_uint256 nScore = pmn->CalculateScore(blockHash);
         if(nScore > nHighest){
             nHighest = nScore;
-            pBestEnode = s.second;
+            pBestEnode = pmn;
         }
         nCountTenth++;
         if(nCountTenth >= nTenthNetwork) break;
@@ -728,44 +764,78 @@ CEnode* CEnodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToExclude, in
     return NULL;
 }
 
-int CEnodeMan::GetEnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+void CEnodeMan::ClearRankCache()
 {
-    std::vector<std::pair<int64_t, CEnode*> > vecEnodeScores;
+    AssertLockHeld(cs);
+    mapEnodeScores.clear();
+    dequeEnodeScores.clear();
+}
 
-    //make sure we know about this block
-    uint256 blockHash = uint256();
-    if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
+const CEnodeMan::CEnodeRanks& CEnodeMan::GetRanks(const uint256& blockHash, int nMinProtocol, RankFilter filter)
+{
+    AssertLockHeld(cs);
 
-    LOCK(cs);
+    std::map<uint256, CEnodeScores>::iterator itScores = mapEnodeScores.find(blockHash);
+    if(itScores == mapEnodeScores.end()) {
+        if(dequeEnodeScores.size() >= RANK_CACHE_BLOCKS) {
+            mapEnodeScores.erase(dequeEnodeScores.front());
+            dequeEnodeScores.pop_front();
+        }
+        itScores = mapEnodeScores.insert(std::make_pair(blockHash, CEnodeScores())).first;
+        dequeEnodeScores.push_back(blockHash);
 
-    // scan for winner
-    BOOST_FOREACH(CEnode& mn, vEnodes) {
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive) {
-            if(!mn.IsEnabled()) continue;
+        // The scores only depend on the block and the collateral of the Enodes
+        std::vector<std::pair<int64_t, CEnode*> > vecEnodeScores;
+        vecEnodeScores.reserve(vEnodes.size());
+        arith_uint256 hashBlockScore = CEnode::CalculateBlockScore(blockHash);
+        BOOST_FOREACH(CEnode& mn, vEnodes) {
+            int64_t nScore = mn.CalculateScore(blockHash, hashBlockScore).GetCompact(false);
+            vecEnodeScores.push_back(std::make_pair(nScore, &mn));
         }
-        else {
-            if(!mn.IsValidForPayment()) continue;
+
+        sort(vecEnodeScores.rbegin(), vecEnodeScores.rend(), CompareScoreMN());
+
+        std::vector<CEnode*> &vecSorted = itScores->second.vecSorted;
+        vecSorted.reserve(vecEnodeScores.size());
+        BOOST_FOREACH(PAIRTYPE(int64_t, CEnode*)& scorePair, vecEnodeScores) {
+            vecSorted.push_back(scorePair.second);
         }
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
+    }
 
-        vecEnodeScores.push_back(std::make_pair(nScore, &mn));
+    CEnodeRanks& ranks = itScores->second.mapRanks[std::make_pair(nMinProtocol, (int)filter)];
+    unsigned int nStateVersion = nEnodeStateVersion;
+    if(!ranks.fValid || ranks.nStateVersion != nStateVersion) {
+        ranks.fValid = true;
+        ranks.nStateVersion = nStateVersion;
+        ranks.vecRanked.clear();
+        ranks.mapRanks.clear();
+        // Filtering keeps the order by score
+        BOOST_FOREACH(CEnode* pmn, itScores->second.vecSorted) {
+            if(pmn->nProtocolVersion < nMinProtocol) continue;
+            if(filter == RANK_ENABLED && !pmn->IsEnabled()) continue;
+            if(filter == RANK_VALID_FOR_PAYMENT && !pmn->IsValidForPayment()) continue;
+            ranks.vecRanked.push_back(pmn);
+            ranks.mapRanks[pmn->vin.prevout] = ranks.vecRanked.size();
+        }
     }
+    return ranks;
+}
 
-    sort(vecEnodeScores.rbegin(), vecEnodeScores.rend(), CompareScoreMN());
+int CEnodeMan::GetEnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
+    //make sure we know about this block
+    uint256 blockHash = uint256();
+    if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CEnode*)& scorePair, vecEnodeScores) {
-        nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
-    }
+    LOCK(cs);
 
-    return -1;
+    const CEnodeRanks& ranks = GetRanks(blockHash, nMinProtocol, fOnlyActive ? RANK_ENABLED : RANK_VALID_FOR_PAYMENT);
+    std::map<COutPoint, int>::const_iterator it = ranks.mapRanks.find(vin.prevout);
+    return it == ranks.mapRanks.end() ? -1 : it->second;
 }
 
 std::vector<std::pair<int, CEnode> > CEnodeMan::GetEnodeRanks(int nBlockHeight, int nMinProtocol)
 {
-    std::vector<std::pair<int64_t, CEnode*> > vecEnodeScores;
     std::vector<std::pair<int, CEnode> > vecEnodeRanks;
 
     //make sure we know about this block
@@ -774,22 +844,10 @@ std::vector<std::pair<int, CEnode> > CEnodeMan::GetEnodeRanks(int nBlockHeight,
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CEnode& mn, vEnodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecEnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecEnodeScores.rbegin(), vecEnodeScores.rend(), CompareScoreMN());
-
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CEnode*)& s, vecEnodeScores) {
-        nRank++;
-        vecEnodeRanks.push_back(std::make_pair(nRank, *s.second));
+    const CEnodeRanks& ranks = GetRanks(blockHash, nMinProtocol, RANK_ENABLED);
+    vecEnodeRanks.reserve(ranks.vecRanked.size());
+    for(size_t i = 0; i < ranks.vecRanked.size(); i++) {
+        vecEnodeRanks.push_back(std::make_pair((int)i + 1, *ranks.vecRanked[i]));
     }
 
     return vecEnodeRanks;
@@ -797,8 +855,6 @@ std::vector<std::pair<int, CEnode> > CEnodeMan::GetEnodeRanks(int nBlockHeight,
 
 CEnode* CEnodeMan::GetEnodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CEnode*> > vecEnodeScores;
-
     LOCK(cs);
 
     uint256 blockHash;
@@ -807,28 +863,11 @@ CEnode* CEnodeMan::GetEnodeByRank(int nRank, int nBlockHeight, int nMinProtocol,
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CEnode& mn, vEnodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecEnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecEnodeScores.rbegin(), vecEnodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CEnode*)& s, vecEnodeScores){
-        rank++;
-        if(rank == nRank) {
-            return s.second;
-        }
+    const CEnodeRanks& ranks = GetRanks(blockHash, nMinProtocol, fOnlyActive ? RANK_ENABLED : RANK_ALL);
+    if(nRank < 1 || nRank > (int)ranks.vecRanked.size()) {
+        return NULL;
     }
-
-    return NULL;
+    return ranks.vecRanked[nRank - 1];
 }
 
 void CEnodeMan::ProcessEnodeConnections()
@@ -1271,7 +1310,7 @@ void CEnodeMan::ProcessVerifyReply(CNode* pnode, CEnodeVerification& mnv)
 
         CEnode* prealEnode = NULL;
         std::vector<CEnode*> vpEnodesToBan;
-        std::vector<CEnode>::iterator it = vEnodes.begin();
+        std::list<CEnode>::iterator it = vEnodes.begin();
         std::string strMessage1 = strprintf("%s%d%s", pnode->addr.ToString(), mnv.nonce, blockHash.ToString());
         while(it != vEnodes.end()) {
             if(CAddress(it->addr, NODE_NETWORK) == pnode->addr) {
@@ -1589,7 +1628,13 @@ void CEnodeMan::UpdateLastPaid()
                              pCurrentBlockIndex->nHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
     BOOST_FOREACH(CEnode& mn, vEnodes) {
+        int nBlockLastPaidPrev = mn.GetLastPaidBlock();
         mn.UpdateLastPaid(pCurrentBlockIndex, nMaxBlocksToScanBack);
+        if(mn.GetLastPaidBlock() != nBlockLastPaidPrev) {
+            // move it to the back of the payment queue
+            setEnodesByLastPaid.erase(std::make_pair(nBlockLastPaidPrev, &mn));
+            setEnodesByLastPaid.insert(std::make_pair(mn.GetLastPaidBlock(), &mn));
+        }
     }
 
     // every time is like the first time if winners list is not synced
@@ -1614,8 +1659,8 @@ void CEnodeMan::CheckAndRebuildEnodeIndex()
 
     indexEnodesOld = indexEnodes;
     indexEnodes.Clear();
-    for(size_t i = 0; i < vEnodes.size(); ++i) {
-        indexEnodes.AddEnodeVIN(vEnodes[i].vin);
+    BOOST_FOREACH(CEnode& mn, vEnodes) {
+        indexEnodes.AddEnodeVIN(mn.vin);
     }
 
     fIndexRebuilt = true;
@@ -1710,6 +1755,7 @@ void CEnodeMan::SetEnodeLastPing(const CTxIn& vin, const CEnodePing& mnp)
 void CEnodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
 {
     pCurrentBlockIndex = pindex;
+    nCachedBlockHeight = pindex->nHeight;
     LogPrint("znode", "CEnodeMan::UpdatedBlockTip -- pCurrentBlockIndex->nHeight=%d\n", pCurrentBlockIndex->nHeight);
 
     CheckSameAddr();
@@ -1743,3 +1789,32 @@ void CEnodeMan::NotifyEnodeUpdates()
     fEnodesAdded = false;
     fEnodesRemoved = false;
 }
+
+void CEnodeMan::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, const CBlock *pblock)
+{
+    // Collaterals are looked up in the UTXO set, mempool transactions don't change them
+    if(!pindex) return;
+
+    LOCK(cs);
+    if(vEnodes.empty()) return;
+
+    if(pblock) {
+        // connected, the collaterals spent by the transaction are gone for good
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            CEnode* const* ppmn = mapEnodesByOutpoint.find(txin.prevout);
+            if(ppmn) {
+                (*ppmn)->SetOutpointSpent();
+            }
+        }
+    } else {
+        // disconnected or conflicted, the collaterals it created may not exist anymore
+        uint256 hash = tx.GetHash();
+        for(unsigned int i = 0; i < tx.vout.size(); i++) {
+            CEnode* const* ppmn = mapEnodesByOutpoint.find(COutPoint(hash, i));
+            if(ppmn) {
+                LogPrint("znode", "CEnodeMan::SyncTransaction -- collateral transaction left the chain, znode=%s\n", (*ppmn)->vin.prevout.ToStringShort());
+                (*ppmn)->ResetCollateralCheck();
+            }
+        }
+    }
+}
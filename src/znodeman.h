@@ -5,9 +5,14 @@
 #ifndef ENODEMAN_H
 #define ENODEMAN_H
 
+#include "flathashmap.h"
 #include "znode.h"
 #include "sync.h"
 
+#include <atomic>
+#include <deque>
+#include <list>
+
 using namespace std;
 
 class CEnodeMan;
@@ -110,15 +115,20 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    /// Blocks whose Enode scores are kept, votes are checked against a few dozen recent ones
+    static const int RANK_CACHE_BLOCKS              = 32;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
 
     // Keep track of current block index
     const CBlockIndex *pCurrentBlockIndex;
+    // and of its height, which can be read without locking
+    std::atomic<int> nCachedBlockHeight;
 
-    // map to hold all MNs
-    std::vector<CEnode> vEnodes;
+    // list to hold all MNs, pointers to its entries stay valid until they are removed
+    std::list<CEnode> vEnodes;
     // who's asked for the Enode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForEnodeList;
     // who we asked for the Enode list and the last time
@@ -152,6 +162,75 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    /// Which Enodes are ranked
+    enum RankFilter {
+        RANK_ALL,
+        RANK_VALID_FOR_PAYMENT,
+        RANK_ENABLED
+    };
+
+    /// Ranks of the Enodes passing a filter, valid while nEnodeStateVersion is unchanged
+    struct CEnodeRanks {
+        bool fValid;
+        unsigned int nStateVersion;
+        /// vecRanked[nRank - 1]
+        std::vector<CEnode*> vecRanked;
+        std::map<COutPoint, int> mapRanks;
+
+        CEnodeRanks() : fValid(false), nStateVersion(0) {}
+    };
+
+    /// All the Enodes by score for a block, best first, and the ranks derived from it
+    struct CEnodeScores {
+        std::vector<CEnode*> vecSorted;
+        /// By minimum protocol version and RankFilter
+        std::map<std::pair<int, int>, CEnodeRanks> mapRanks;
+    };
+
+    /// Pointers into vEnodes, cleared whenever Enodes are added or removed
+    std::map<uint256, CEnodeScores> mapEnodeScores;
+    /// Block hashes of mapEnodeScores, oldest first
+    std::deque<uint256> dequeEnodeScores;
+    /// Bumped when the state or protocol version of an Enode changes, or a spork
+    std::atomic<unsigned int> nEnodeStateVersion;
+
+    const CEnodeRanks& GetRanks(const uint256& blockHash, int nMinProtocol, RankFilter filter);
+    void ClearRankCache();
+
+    /// Salted, the keys come from the network
+    struct COutPointHash {
+        size_t operator()(const COutPoint& outpoint) const;
+    };
+    struct CPubKeyHash {
+        size_t operator()(const CPubKey& pubKey) const;
+    };
+    struct CScriptHash {
+        size_t operator()(const CScript& script) const;
+    };
+
+    /// Lookup of vEnodes entries by collateral outpoint, Enode key and payee script
+    flathashmultimap<COutPoint, CEnode*, COutPointHash> mapEnodesByOutpoint;
+    flathashmultimap<CPubKey, CEnode*, CPubKeyHash> mapEnodesByPubKey;
+    flathashmultimap<CScript, CEnode*, CScriptHash> mapEnodesByPayee;
+
+    /// Payment queue order: last paid block, then collateral
+    struct CompareLastPaidBlock {
+        bool operator()(const std::pair<int, CEnode*>& t1, const std::pair<int, CEnode*>& t2) const
+        {
+            return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+        }
+    };
+
+    /// All the Enodes in payment queue order, the qualified ones are picked from its front
+    std::set<std::pair<int, CEnode*>, CompareLastPaidBlock> setEnodesByLastPaid;
+
+    bool IsQualifiedForPayment(CEnode& mn, int nBlockHeight, bool fFilterSigTime, int nMnCount, std::string* pstrReason);
+    CEnode* FindNextEnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, bool fCountAll);
+
+    void AddToLookup(CEnode& mn);
+    void RemoveFromLookup(CEnode& mn);
+    void RebuildLookup();
+
     friend class CEnodeSync;
 
 public:
@@ -194,6 +273,10 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            ClearRankCache();
+            RebuildLookup();
+        }
     }
 
     CEnodeMan();
@@ -290,11 +373,16 @@ public:
     CEnode* GetNextEnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount);
     /// Same as above but use current block height
     CEnode* GetNextEnodeInQueueForPayment(bool fFilterSigTime, int& nCount);
+    /// nCount of GetNextEnodeInQueueForPayment only goes as far as needed to find the winner, this counts them all
+    int CountQualifiedForPayment(bool fFilterSigTime);
 
     /// Find a random entry
     CEnode* FindRandomNotInVec(const std::vector<CTxIn> &vecToExclude, int nProtocolVersion = -1);
 
-    std::vector<CEnode> GetFullEnodeVector() { return vEnodes; }
+    std::vector<CEnode> GetFullEnodeVector() {
+        LOCK(cs);
+        return std::vector<CEnode>(vEnodes.begin(), vEnodes.end());
+    }
 
     std::vector<std::pair<int, CEnode> > GetEnodeRanks(int nBlockHeight = -1, int nMinProtocol=0);
     int GetEnodeRank(const CTxIn &vin, int nBlockHeight, int nMinProtocol=0, bool fOnlyActive=true);
@@ -356,6 +444,10 @@ public:
     void SetEnodeLastPing(const CTxIn& vin, const CEnodePing& mnp);
 
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    int GetCachedBlockHeight() { return nCachedBlockHeight; }
+
+    /// Keeps the collateral state of the Enodes current, from the transactions of connected and disconnected blocks
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, const CBlock *pblock);
 
     /**
      * Called to notify CGovernanceManager that the znode index has been updated.
@@ -363,6 +455,12 @@ public:
      */
     void NotifyEnodeUpdates();
 
+    /// Called by an Enode of the list after its Enode key changed
+    void NotifyEnodePubKeyChanged(CEnode& mn, const CPubKey& pubKeyEnodeOld);
+
+    /// Cached ranks depend on the state of the Enodes and on sporks, called when they change
+    void NotifyEnodeStateChanged() { nEnodeStateVersion++; }
+
 };
 
 #endif